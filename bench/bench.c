@@ -0,0 +1,342 @@
+#include "../glvk/glvk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* headless microbenchmarks of the gl entry points.
+ * every benchmark prints one json object per line to stdout and a readable summary to stderr.
+ * run from the repository root so the shaders are found, e.g. with a software icd:
+ * VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./glvk_bench */
+
+#define BENCH_WIDTH 256
+#define BENCH_HEIGHT 256
+#define BENCH_MAX_BUFFER_SIZE (256ull << 20)
+
+typedef struct {
+	const char* name;
+	/* the parameter the benchmark was run with, e.g. a buffer size, 0 when it has none */
+	unsigned long long param;
+	/* ops per timed sample, latencies are reported per op */
+	unsigned int batch;
+	unsigned int sample_count;
+	unsigned long long* samples;
+	unsigned long long total_ns;
+} bench_t;
+
+static const char* filter = NULL;
+static unsigned long long max_size = BENCH_MAX_BUFFER_SIZE;
+static unsigned int scale = 1;
+
+static unsigned long long now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+static void debugFunc(const char* message, GLVKmessagetype type, GLVKmessageseverity severity) {
+	(void)type;
+	if (severity >= GLVK_SEVERITY_WARNING) {
+		fprintf(stderr, "glvk: %s\n", message);
+	}
+}
+
+static int compareSamples(const void* a, const void* b) {
+	unsigned long long x = *(const unsigned long long*)a;
+	unsigned long long y = *(const unsigned long long*)b;
+	return (x > y) - (x < y);
+}
+
+/* returns 0 when the benchmark is filtered out */
+static int benchBegin(bench_t* bench, const char* name, unsigned long long param, unsigned int batch, unsigned int sample_count) {
+	if (filter != NULL && strstr(name, filter) == NULL) {
+		return 0;
+	}
+
+	bench->name = name;
+	bench->param = param;
+	bench->batch = batch;
+	bench->sample_count = sample_count;
+	bench->samples = (unsigned long long*)malloc(sizeof(unsigned long long) * sample_count);
+	bench->total_ns = 0;
+	while (glGetError() != GL_NO_ERROR) {
+	}
+	return bench->samples != NULL;
+}
+
+static void benchSample(bench_t* bench, unsigned int i, unsigned long long start) {
+	unsigned long long elapsed = now() - start;
+	bench->samples[i] = elapsed;
+	bench->total_ns += elapsed;
+}
+
+static unsigned long long percentile(const bench_t* bench, double p) {
+	unsigned int index = (unsigned int)(p * (bench->sample_count - 1) + 0.5);
+	return bench->samples[index] / bench->batch;
+}
+
+static void benchEnd(bench_t* bench, const char* extra) {
+	unsigned int errors = 0;
+	while (glGetError() != GL_NO_ERROR) {
+		++errors;
+	}
+
+	qsort(bench->samples, bench->sample_count, sizeof(unsigned long long), compareSamples);
+
+	unsigned long long ops = (unsigned long long)bench->sample_count * bench->batch;
+	double ops_per_sec = bench->total_ns > 0 ? (double)ops * 1e9 / (double)bench->total_ns : 0.0;
+	unsigned long long mean = bench->total_ns / ops;
+
+	printf("{\"name\":\"%s\",\"param\":%llu,\"ops\":%llu,\"ops_per_sec\":%.1f,\"mean_ns\":%llu,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu,\"gl_errors\":%u%s}\n",
+		bench->name, bench->param, ops, ops_per_sec, mean,
+		percentile(bench, 0.5), percentile(bench, 0.9), percentile(bench, 0.99), bench->samples[bench->sample_count - 1] / bench->batch,
+		errors, extra != NULL ? extra : "");
+	fflush(stdout);
+
+	fprintf(stderr, "%-24s %12llu %14.1f ops/s  p50 %9llu ns  p99 %9llu ns%s\n",
+		bench->name, bench->param, ops_per_sec, percentile(bench, 0.5), percentile(bench, 0.99), errors != 0 ? "  (gl errors)" : "");
+
+	free(bench->samples);
+	bench->samples = NULL;
+}
+
+/* name churn of a single buffer, as done by code that creates buffers per object */
+static void benchGenDelete(void) {
+	bench_t bench;
+	if (!benchBegin(&bench, "gen_delete", 1, 1, 100000 * scale)) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < bench.sample_count; ++i) {
+		unsigned long long start = now();
+		GLuint buffer;
+		glGenBuffers(1, &buffer);
+		glDeleteBuffers(1, &buffer);
+		benchSample(&bench, i, start);
+	}
+
+	benchEnd(&bench, NULL);
+}
+
+/* the same churn in batches, names are handed out and freed 64 at a time */
+static void benchGenDeleteBatch(void) {
+	bench_t bench;
+	if (!benchBegin(&bench, "gen_delete_batch", 64, 64, 10000 * scale)) {
+		return;
+	}
+
+	GLuint buffers[64];
+	for (unsigned int i = 0; i < bench.sample_count; ++i) {
+		unsigned long long start = now();
+		glGenBuffers(64, buffers);
+		glDeleteBuffers(64, buffers);
+		benchSample(&bench, i, start);
+	}
+
+	benchEnd(&bench, NULL);
+}
+
+/* re-specification of one buffer, every iteration orphans the previous store */
+static void benchBufferData(unsigned long long size) {
+	/* large sizes run fewer iterations so each size takes a similar time */
+	unsigned long long iterations = (64ull << 20) / size;
+	if (iterations < 8) {
+		iterations = 8;
+	}
+	if (iterations > 20000) {
+		iterations = 20000;
+	}
+
+	bench_t bench;
+	if (!benchBegin(&bench, "buffer_data", size, 1, (unsigned int)iterations * scale)) {
+		return;
+	}
+
+	void* data = calloc(1, size);
+	if (data == NULL) {
+		free(bench.samples);
+		return;
+	}
+
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (unsigned int i = 0; i < bench.sample_count; ++i) {
+		unsigned long long start = now();
+		glBufferData(GL_ARRAY_BUFFER, (GLsizei)size, data, GL_DYNAMIC_DRAW);
+		benchSample(&bench, i, start);
+
+		/* retire frames regularly so orphaned stores are recycled as they would be in an application */
+		if (i % 16 == 15 || size >= (1ull << 20)) {
+			glvkDraw();
+		}
+	}
+	glvkDraw();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+	free(data);
+	benchEnd(&bench, NULL);
+}
+
+/* binding a different buffer to the same target, timed in batches since a bind is only a few ns */
+static void benchBindSwitch(void) {
+	bench_t bench;
+	if (!benchBegin(&bench, "bind_switch", 1024, 1000, 10000 * scale)) {
+		return;
+	}
+
+	GLuint buffers[1024];
+	glGenBuffers(1024, buffers);
+	for (unsigned int i = 0; i < bench.sample_count; ++i) {
+		unsigned long long start = now();
+		for (unsigned int j = 0; j < bench.batch; ++j) {
+			glBindBuffer(GL_ARRAY_BUFFER, buffers[(i * 7 + j * 13) & 1023]);
+		}
+		benchSample(&bench, i, start);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1024, buffers);
+	benchEnd(&bench, NULL);
+}
+
+static const float triangle[] = {
+	0.0f, -0.5f, 0.0f,
+	0.5f, 0.5f, 0.0f,
+	-0.5f, 0.5f, 0.0f,
+};
+
+/* recording of draw calls, buffers alternates between 1 and 2 vertex buffers bound before every draw */
+static void benchDraw(const char* name, unsigned int buffers) {
+	bench_t bench;
+	if (!benchBegin(&bench, name, buffers, 1, 200000 * scale)) {
+		return;
+	}
+
+	GLuint vbos[2];
+	glGenBuffers(2, vbos);
+	for (unsigned int i = 0; i < 2; ++i) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbos[0]);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glvkDraw();
+
+	GLVKstatestats before;
+	glvkGetStateStats(&before);
+
+	for (unsigned int i = 0; i < bench.sample_count; ++i) {
+		unsigned long long start = now();
+		if (buffers > 1) {
+			glBindBuffer(GL_ARRAY_BUFFER, vbos[i & 1]);
+		}
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		benchSample(&bench, i, start);
+
+		if (i % 1000 == 999) {
+			glvkDraw();
+		}
+	}
+	glvkDraw();
+
+	/* state commands recorded and redundant state dropped by the draws above */
+	GLVKstatestats after;
+	glvkGetStateStats(&after);
+	char extra[128];
+	snprintf(extra, sizeof(extra), ",\"state_commands\":%llu,\"redundant_state\":%llu", after.state_commands - before.state_commands, after.redundant_state - before.redundant_state);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(2, vbos);
+	benchEnd(&bench, extra);
+}
+
+/* whole frames of draws including submission, the frame statistics of the last one are attached */
+static void benchFrame(unsigned int draws) {
+	bench_t bench;
+	if (!benchBegin(&bench, "frame", draws, 1, 2000 * scale)) {
+		return;
+	}
+
+	GLuint vbo;
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
+
+	for (unsigned int i = 0; i < bench.sample_count; ++i) {
+		unsigned long long start = now();
+		for (unsigned int j = 0; j < draws; ++j) {
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+		glvkDraw();
+		benchSample(&bench, i, start);
+	}
+
+	GLVKframestats stats;
+	glvkGetFrameStats(&stats);
+	char extra[256];
+	snprintf(extra, sizeof(extra), ",\"cpu_ns\":%llu,\"submit_ns\":%llu,\"fence_ns\":%llu,\"gpu_ns\":%llu", stats.cpu_ns, stats.submit_ns, stats.fence_ns, stats.gpu_ns);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &vbo);
+	benchEnd(&bench, extra);
+}
+
+static void usage(const char* program) {
+	fprintf(stderr, "usage: %s [--filter name] [--max-size bytes] [--scale n] [--threaded] [--record-threads n] [--debug]\n", program);
+}
+
+int main(int argc, char** argv) {
+	int debug = 0;
+	int threaded = 0;
+	unsigned int record_threads = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+			max_size = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+			scale = (unsigned int)strtoul(argv[++i], NULL, 10);
+			if (scale == 0) {
+				scale = 1;
+			}
+		} else if (strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) {
+			record_threads = (unsigned int)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--threaded") == 0) {
+			threaded = 1;
+		} else if (strcmp(argv[i], "--debug") == 0) {
+			debug = 1;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	glvkSetDebug(debug);
+	glvkRegisterDebugFunc(debugFunc);
+	glvkSetThreaded(threaded);
+	glvkSetRecordThreads(record_threads);
+	/* every run starts from cold pipelines and does not leave a cache behind */
+	glvkSetPipelineCachePath(NULL);
+
+	if (glvkInitHeadless(BENCH_WIDTH, BENCH_HEIGHT) != 0) {
+		fprintf(stderr, "Failed to initialize glvk\n");
+		return 1;
+	}
+
+	benchGenDelete();
+	benchGenDeleteBatch();
+	for (unsigned long long size = 64; size <= max_size; size *= 4) {
+		benchBufferData(size);
+	}
+	benchBindSwitch();
+	benchDraw("draw", 1);
+	benchDraw("draw_bind_switch", 2);
+	benchFrame(100);
+	benchFrame(1000);
+
+	glvkDeinit();
+	return 0;
+}
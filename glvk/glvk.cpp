@@ -3,11 +3,29 @@
 #include <limits>
 #include <string>
 #include <cstring>
+#include <cstdio>
 #include <sstream>
 #include <fstream>
 #include <stack>
+#include <memory>
+#include <bit>
+#include <algorithm>
+#include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <new>
+#include <regex>
+#include <filesystem>
 #include <vulkan/vulkan_core.h>
 
+#ifdef GLVK_GLSLANG
+#include <glslang/Include/glslang_c_interface.h>
+#include <glslang/Public/resource_limits_c.h>
+#endif
+
 #ifdef GLVK_APPLE
 	#include <TargetConditionals.h>
 	
@@ -65,6 +83,491 @@ struct GLVKvkphysical {
 	VkPhysicalDeviceMemoryProperties memory_properties;
 };
 
+#define GLVK_MEMORY_BLOCK_SIZE (static_cast<VkDeviceSize>(64) << 20)
+#define GLVK_STAGING_SIZE (static_cast<VkDeviceSize>(32) << 20)
+#define GLVK_STAGING_ALIGNMENT 16
+#define GLVK_BUFFER_POOL_FRAMES 64
+#define GLVK_FRAME_QUERY_COUNT 256
+#define GLVK_RECORD_MIN_PACKETS 256
+#define GLVK_BINDLESS_UNIFORM_BUFFERS 1024
+#define GLVK_BINDLESS_STORAGE_BUFFERS 4096
+#define GLVK_BINDLESS_TEXTURES 4096
+#define GLVK_DESCRIPTOR_SLOT_BITS 28
+#define GLVK_DESCRIPTOR_POOL_SETS 256
+#define GLVK_FALLBACK_STORAGE_BINDING GLVK_MAX_UNIFORM_BUFFER_BINDINGS
+#define GLVK_FALLBACK_TEXTURE_BINDING (GLVK_FALLBACK_STORAGE_BINDING + GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS)
+#define GLVK_FALLBACK_BINDING_COUNT (GLVK_FALLBACK_TEXTURE_BINDING + GLVK_MAX_TEXTURE_UNITS)
+#define GLVK_NO_DESCRIPTOR std::numeric_limits<uint32_t>::max()
+#define GLVK_UNIFORM_BLOCK_SIZE (GLVK_MAX_UNIFORM_LOCATIONS * 16)
+#define GLVK_UNIFORM_CHUNK_SIZE (1u << 20)
+#define GLVK_MAX_UNIFORM_CHUNKS 64
+#define GLVK_RECORD_CHUNK_MASK 0xFFull
+#define GLVK_RECORD_STOP GLVK_RECORD_CHUNK_MASK
+#define GLVK_COMMAND_RING_SIZE (static_cast<uint64_t>(8) << 20)
+#define GLVK_COMMAND_ALIGNMENT 16
+/* part of every shader cache key, bumped whenever the glsl rewrite or the compiler options change */
+#define GLVK_SHADER_CACHE_VERSION 1
+#define GLVK_COMMAND_DATA_LIMIT (64 << 10)
+#define GLVK_BUFFER_USAGE (VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
+
+#define TLSF_SL_LOG2 4
+#define TLSF_SL_COUNT (1u << TLSF_SL_LOG2)
+#define TLSF_FL_COUNT 32
+#define TLSF_SMALL_SIZE (static_cast<VkDeviceSize>(1) << (TLSF_SL_LOG2 + 4))
+#define TLSF_MIN_SPLIT 64
+#define TLSF_NONE std::numeric_limits<uint32_t>::max()
+
+/* node of a two-level segregated fit heap, tracks both its physical neighbours and its free list neighbours */
+struct tlsfnode_t {
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint32_t prev_phys;
+	uint32_t next_phys;
+	uint32_t prev_free;
+	uint32_t next_free;
+	bool free;
+};
+
+/* one large VkDeviceMemory allocation that buffers are sub-allocated from */
+struct memblock_t {
+	VkDeviceMemory memory;
+	uint32_t memory_type;
+	VkDeviceSize size;
+	VkDeviceSize used;
+	uint32_t allocation_count;
+	void* mapped;
+
+	uint32_t fl_bitmap;
+	uint32_t sl_bitmaps[TLSF_FL_COUNT];
+	uint32_t heads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+	std::vector<tlsfnode_t> nodes;
+	std::vector<uint32_t> unused_nodes;
+};
+
+/* a sub-allocation, block is null for dedicated allocations that own their memory */
+struct allocation_t {
+	memblock_t* block;
+	uint32_t node;
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	void* mapped;
+};
+
+struct GLVKvkmemory {
+	std::vector<std::unique_ptr<memblock_t>> blocks;
+	uint32_t device_allocation_count;
+	uint32_t dedicated_count;
+	VkDeviceSize dedicated_bytes;
+};
+
+enum bufferplacement_t {
+	BUFFER_PLACEMENT_DEVICE = 0,
+	BUFFER_PLACEMENT_UPLOAD,
+	BUFFER_PLACEMENT_READBACK,
+};
+
+/* backing store of a gl buffer object, renamed on re-specification so frames in flight keep reading the old one */
+struct bufferstore_t {
+	VkBuffer buffer;
+	allocation_t memory;
+	VkDeviceSize capacity;
+	bufferplacement_t placement;
+	/* number of the last frame that accessed the store on the gpu, or the frame it was retired in while pooled */
+	uint64_t last_use;
+	/* number of the last frame whose draw commands (rather than uploads) read the store */
+	uint64_t last_draw;
+	/* number of the last frame whose commands wrote the store on the gpu, i.e. pixel pack readbacks */
+	uint64_t last_write;
+};
+
+/* the image behind a texture, renamed like a buffer store when it is written after a draw of the same frame read it */
+struct imagestore_t {
+	VkImage image;
+	VkImageView view;
+	allocation_t memory;
+	/* UNDEFINED until the first uploads of the image were made visible, SHADER_READ_ONLY_OPTIMAL between frames' uploads */
+	VkImageLayout layout;
+	/* number of the frame whose upload command buffer has the image in TRANSFER_DST_OPTIMAL */
+	uint64_t upload_frame;
+	uint64_t last_use;
+	uint64_t last_draw;
+};
+
+/* persistently mapped host buffer that uploads are copied through, head and tail count bytes ever reserved/released */
+struct GLVKvkstaging {
+	VkBuffer buffer;
+	allocation_t memory;
+	VkDeviceSize size;
+	VkDeviceSize head;
+	VkDeviceSize tail;
+};
+
+/* an image sub-allocated from the device memory blocks with its default view */
+struct GLVKvkattachment {
+	VkImage image;
+	VkImageView view;
+	VkFormat format;
+	allocation_t memory;
+};
+
+/* a timestamp written for a gl query object, copied into the query once the slot's results are read */
+struct timestampref_t {
+	uint32_t index;
+	GLuint query;
+	/* the query's serial when it was written, timestamps of an earlier use of the query are dropped */
+	uint32_t serial;
+	/* 0 for the begin timestamp of a time elapsed query or the only one of a counter, 1 for the end */
+	uint32_t which;
+};
+
+/* a glvkBeginScope/glvkEndScope pair, begin and end index the slot's query pool */
+struct framescope_t {
+	const char* name;
+	uint32_t depth;
+	uint32_t begin;
+	uint32_t end;
+	uint64_t cpu_begin;
+	uint64_t cpu_ns;
+};
+
+enum packettype_t {
+	PACKET_DRAW = 0,
+	PACKET_DRAW_INDEXED,
+	PACKET_BLEND_CONSTANTS,
+	PACKET_TIMESTAMP,
+	PACKET_PUSH_CONSTANTS,
+	PACKET_BIND_DESCRIPTOR_SET,
+	PACKET_BIND_UNIFORMS,
+	PACKET_VIEWPORT,
+	PACKET_VERTEX_BUFFERS,
+	PACKET_VERTEX_INPUT,
+};
+
+/* a command inside the render pass with everything it needs already resolved, so it can be recorded on any thread */
+struct drawpacket_t {
+	packettype_t type;
+	/* vertex or index count, the pipeline stage of a timestamp, the uniform chunk of the default block */
+	uint32_t count;
+	uint32_t instance_count;
+	/* first vertex or index, the query index of a timestamp, the frame's push_constants, descriptor_sets, viewports or
+	 * vertex_buffers entry, the dynamic offset of the default block, the vertex layout set as dynamic vertex input */
+	uint32_t first;
+	VkPipeline pipeline;
+	VkBuffer vertex_buffer;
+	VkBuffer index_buffer;
+	VkIndexType index_type;
+	GLfloat blend_color[4];
+};
+
+#define GLVK_HASH_SEED 0xCBF29CE484222325ull
+
+/* 64 bit FNV-1a */
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = GLVK_HASH_SEED) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+	}
+
+	return hash;
+}
+
+enum descriptortype_t {
+	DESCRIPTOR_UNIFORM_BUFFER = 0,
+	DESCRIPTOR_STORAGE_BUFFER,
+	DESCRIPTOR_TEXTURE,
+	DESCRIPTOR_TYPE_COUNT,
+};
+
+/* what a bindless descriptor points at, compared bytewise. a buffer range, or an image view with its sampler in offset and its layout in range */
+struct descriptorkey_t {
+	uint64_t handle;
+	uint64_t offset;
+	uint64_t range;
+};
+
+struct descriptorkeyhash_t {
+	size_t operator()(const descriptorkey_t& key) const {
+		return static_cast<size_t>(hashBytes(&key, sizeof(key)));
+	}
+};
+
+struct descriptorkeyequal_t {
+	bool operator()(const descriptorkey_t& a, const descriptorkey_t& b) const {
+		return memcmp(&a, &b, sizeof(a)) == 0;
+	}
+};
+
+/* contents of a descriptor set without descriptor indexing, in binding order. unbound entries are zero */
+struct descriptorsetkey_t {
+	descriptorkey_t uniform_buffers[GLVK_MAX_UNIFORM_BUFFER_BINDINGS];
+	descriptorkey_t storage_buffers[GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS];
+	descriptorkey_t textures[GLVK_MAX_TEXTURE_UNITS];
+};
+
+struct descriptorsetkeyhash_t {
+	size_t operator()(const descriptorsetkey_t& key) const {
+		return static_cast<size_t>(hashBytes(&key, sizeof(key)));
+	}
+};
+
+struct descriptorsetkeyequal_t {
+	bool operator()(const descriptorsetkey_t& a, const descriptorsetkey_t& b) const {
+		return memcmp(&a, &b, sizeof(a)) == 0;
+	}
+};
+
+/* gl sampling state of a sampler object or a texture. states are zeroed before being filled in and hashed whole */
+struct samplerstate_t {
+	GLenum min_filter;
+	GLenum mag_filter;
+	GLenum wrap_s;
+	GLenum wrap_t;
+	GLenum wrap_r;
+	GLenum compare_mode;
+	GLenum compare_func;
+	GLfloat min_lod;
+	GLfloat max_lod;
+	GLfloat lod_bias;
+	GLfloat max_anisotropy;
+};
+
+struct samplerstatehash_t {
+	size_t operator()(const samplerstate_t& state) const {
+		return static_cast<size_t>(hashBytes(&state, sizeof(state)));
+	}
+};
+
+struct samplerstateequal_t {
+	bool operator()(const samplerstate_t& a, const samplerstate_t& b) const {
+		return memcmp(&a, &b, sizeof(a)) == 0;
+	}
+};
+
+/* a VkSampler shared by every sampler object and texture with the same state */
+struct samplerentry_t {
+	VkSampler sampler;
+	uint32_t refs;
+};
+
+/* indices into the bindless descriptor arrays, pushed before draws once the bindings changed. the layout is documented in glvk.h */
+struct pushconstants_t {
+	uint32_t uniform_buffers[GLVK_MAX_UNIFORM_BUFFER_BINDINGS];
+	uint32_t storage_buffers[GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS];
+	uint32_t textures[GLVK_MAX_TEXTURE_UNITS];
+};
+
+/* vertex input state compiled from a vertex array object. layouts are zeroed before being filled in and hashed whole */
+struct vertexlayout_t {
+	uint32_t binding_count;
+	uint32_t attribute_count;
+	VkVertexInputBindingDescription bindings[GLVK_MAX_VERTEX_ATTRIBS];
+	VkVertexInputAttributeDescription attributes[GLVK_MAX_VERTEX_ATTRIBS];
+};
+
+/* the buffers behind a layout's bindings, bound with one command */
+struct vertexbuffers_t {
+	uint32_t count;
+	VkBuffer buffers[GLVK_MAX_VERTEX_ATTRIBS];
+	VkDeviceSize offsets[GLVK_MAX_VERTEX_ATTRIBS];
+};
+
+struct viewportstate_t {
+	VkViewport viewport;
+	VkRect2D scissor;
+};
+
+/* a piece of a frame slot's uniform ring and the set binding it as a dynamic uniform buffer */
+struct uniformchunk_t {
+	VkBuffer buffer;
+	allocation_t memory;
+	VkDescriptorSet set;
+};
+
+struct GLVKvkframe {
+	VkCommandPool command_pool;
+	VkCommandBuffer command_buffer;
+
+	/* image_available has not been waited on by a submission of this frame yet */
+	bool image_wait;
+
+	/* copies out of the staging ring, submitted ahead of command_buffer */
+	VkCommandBuffer upload_buffer;
+	bool upload_active;
+	VkDeviceSize staging_end;
+
+	/* stores orphaned while this slot was recording, recycled once its fence signals */
+	std::vector<bufferstore_t> retired_buffers;
+	std::vector<imagestore_t> retired_images;
+	std::vector<VkSampler> retired_samplers;
+	std::vector<VkPipeline> retired_pipelines;
+
+	/* images written by upload_buffer, moved back to SHADER_READ_ONLY_OPTIMAL together when the uploads end */
+	std::vector<VkImageMemoryBarrier> upload_images;
+
+	/* color buffer blitted into the byte order glReadPixels asked for, created on first use */
+	GLVKvkattachment readback;
+
+	/* with record threads, packets not yet recorded into secondary command buffers and the blend constants in effect before the first */
+	std::vector<drawpacket_t> packets;
+	GLfloat packet_blend_color[4];
+
+	/* push constant blocks and descriptor sets referenced by packets, and the ones in effect before the first pending packet (UINT32_MAX for none) */
+	std::vector<pushconstants_t> push_constants;
+	std::vector<VkDescriptorSet> descriptor_sets;
+	uint32_t packet_push_constants;
+	uint32_t packet_descriptor_set;
+
+	/* viewport and scissor rectangles set by packets, packet_viewport is the one in effect before the first pending packet */
+	std::vector<viewportstate_t> viewports;
+	uint32_t packet_viewport;
+
+	/* vertex array buffers bound by packets, and the buffers and dynamic vertex layout in effect before the first pending packet */
+	std::vector<vertexbuffers_t> vertex_buffers;
+	uint32_t packet_vertex_buffers;
+	uint32_t packet_vertex_input;
+
+	/* without descriptor indexing, sets are allocated linearly from these pools, descriptor_pool_index is the one being allocated from */
+	std::vector<VkDescriptorPool> descriptor_pools;
+	uint32_t descriptor_pool_index;
+	std::unordered_map<descriptorsetkey_t, VkDescriptorSet, descriptorsetkeyhash_t, descriptorsetkeyequal_t> descriptor_cache;
+
+	/* default uniform blocks copied at draws, filled linearly and rewound once the slot's fence signals.
+	 * packet_uniform_chunk/offset are the copy in effect before the first pending packet (UINT32_MAX for none) */
+	std::vector<uniformchunk_t> uniform_chunks;
+	uint32_t uniform_chunk;
+	uint32_t uniform_offset;
+	uint32_t packet_uniform_chunk;
+	uint32_t packet_uniform_offset;
+
+	/* timestamps 0 and 1 bracket the frame, the rest are handed out to scopes and gl queries.
+	 * the pool is reset by the frame's first command buffer, results are only read once query_reset_frame has completed */
+	VkQueryPool query_pool;
+	uint32_t query_count;
+	uint64_t query_reset_frame;
+	std::vector<timestampref_t> timestamp_refs;
+	std::vector<framescope_t> scopes;
+	std::vector<uint32_t> open_scopes;
+
+	/* cpu timings in nanoseconds, reported together with the gpu time once the slot's fence signals */
+	bool timed;
+	uint64_t record_begin;
+	uint64_t cpu_ns;
+	uint64_t fence_ns;
+	uint64_t acquire_ns;
+	uint64_t submit_ns;
+	uint64_t present_ns;
+
+	VkSemaphore image_available;
+	VkFence in_flight_fence;
+
+	/* number of the frame last recorded into this slot */
+	uint64_t number;
+};
+
+/* what the frame's command buffer currently has bound, so unchanged bindings are not re-emitted.
+ * the counters are added to the state stats once the command buffer is done with */
+struct GLVKvkcmdstate {
+	VkPipeline pipeline;
+	VkBuffer vertex_buffer;
+	VkBuffer index_buffer;
+	VkIndexType index_type;
+	uint64_t state_commands;
+	uint64_t redundant_state;
+};
+
+/* everything a graphics pipeline is built from. keys are hashed and compared bytewise, so they are zero initialized before being filled in.
+ * program and vertex_layout are 0 for the built-in shaders and vertex format */
+struct pipelinekey_t {
+	uint64_t program;
+	uint64_t vertex_layout;
+	/* pipelines are only used with render passes compatible with this one */
+	VkRenderPass render_pass;
+	uint8_t topology;
+	uint8_t primitive_restart;
+	uint8_t polygon_mode;
+	uint8_t cull_mode;
+	uint8_t front_face;
+	uint8_t rasterizer_discard;
+	uint8_t depth_test;
+	uint8_t depth_write;
+	uint8_t depth_compare;
+	uint8_t blend;
+	uint8_t src_color_factor;
+	uint8_t dst_color_factor;
+	uint8_t color_op;
+	uint8_t src_alpha_factor;
+	uint8_t dst_alpha_factor;
+	uint8_t alpha_op;
+	uint8_t color_write_mask;
+};
+
+struct pipelinekeyhash_t {
+	size_t operator()(const pipelinekey_t& key) const {
+		return static_cast<size_t>(hashBytes(&key, sizeof(key)));
+	}
+};
+
+struct pipelinekeyequal_t {
+	bool operator()(const pipelinekey_t& a, const pipelinekey_t& b) const {
+		return memcmp(&a, &b, sizeof(pipelinekey_t)) == 0;
+	}
+};
+
+/* pipelines built so far, a failed build is cached as VK_NULL_HANDLE so it is not retried on every draw */
+struct GLVKvkpipelines {
+	std::unordered_map<pipelinekey_t, VkPipeline, pipelinekeyhash_t, pipelinekeyequal_t> cache;
+	/* driver side cache of compiled shader code, persisted across runs */
+	VkPipelineCache driver_cache;
+	std::string path;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t compile_ns;
+	uint64_t max_compile_ns;
+};
+
+/* the shader modules of a linked program, found by the link number pipeline keys carry */
+struct programmodules_t {
+	VkShaderModule vertex;
+	VkShaderModule fragment;
+};
+
+/* spir-v cached on disk by the glsl it was compiled from, an empty path disables the cache */
+struct GLVKvkshaders {
+	std::string cache_path;
+	std::unordered_map<uint64_t, programmodules_t> programs;
+	/* numbers links so pipelines of a relinked program are never mistaken for the new ones */
+	uint64_t link_count;
+	uint64_t cache_hits;
+	uint64_t compiles;
+	uint64_t compile_ns;
+};
+
+struct descriptorslot_t {
+	descriptorkey_t key;
+	/* the last frame drawing with the slot, it is only rewritten once that frame has retired */
+	uint64_t last_use;
+	bool used;
+};
+
+/* one array binding of the bindless set. slots are shared by everything pointing at the same key and reclaimed clockwise once idle */
+struct descriptorarray_t {
+	uint32_t capacity;
+	std::vector<descriptorslot_t> slots;
+	uint32_t clock;
+	std::unordered_map<descriptorkey_t, uint32_t, descriptorkeyhash_t, descriptorkeyequal_t> lookup;
+};
+
+struct GLVKvkbindless {
+	/* without descriptor indexing the set has no bindings and indexed bindings are ignored */
+	bool supported;
+	VkDescriptorPool pool;
+	VkDescriptorSet set;
+	descriptorarray_t arrays[DESCRIPTOR_TYPE_COUNT];
+	/* the slots of every buffer or image view, released when it is destroyed. entries pack the array above GLVK_DESCRIPTOR_SLOT_BITS */
+	std::unordered_map<uint64_t, std::vector<uint32_t>> handle_slots;
+};
+
 struct GLVKvkstate {
 	GLVKvkinfo info;
 	GLVKvkqueuefamilies queue_families;
@@ -74,6 +577,8 @@ struct GLVKvkstate {
 	VkSurfaceKHR surface;
 	VkSurfaceCapabilitiesKHR surface_capabilities;
 	GLVKvkphysical physical;
+	/* the subset of physical.features that was enabled on the device */
+	VkPhysicalDeviceFeatures features;
 	VkDevice device;
 
 	VkSurfaceFormatKHR surface_format;
@@ -87,35 +592,325 @@ struct GLVKvkstate {
 	std::vector<VkImage> swapchain_images;
 	std::vector<VkImageView> swapchain_views;
 	VkSwapchainKHR swapchain;
-
+	/* without a surface swapchain_images/views alias these offscreen images, one per frame slot */
+	bool headless;
+	std::vector<GLVKvkattachment> offscreen;
+	/* set when acquire or present reported the swapchain out of date or suboptimal, it is rebuilt before the next frame */
+	bool swapchain_dirty;
+
+	/* shared by every swapchain image, frames in flight are ordered on it by the render pass dependency */
+	GLVKvkattachment depth;
 	std::vector<VkFramebuffer> framebuffers;
 
 	VkRenderPass render_pass;
+	/* the render pass the frame's command buffer is inside of, secondary command buffers inherit it */
+	VkRenderPass active_render_pass;
+	/* same as render_pass but keeps the attachment contents, used to continue a frame after a flush */
+	VkRenderPass render_pass_load;
 	VkShaderModule vshader;
 	VkShaderModule fshader;
 
 	VkDescriptorSetLayout desc_layout;
+	/* set 1, the default uniform block as a dynamic uniform buffer, with room for every frame slot's chunks */
+	VkDescriptorSetLayout uniform_layout;
+	VkDescriptorPool uniform_pool;
 	VkPipelineLayout pipeline_layout;
-	VkPipeline pipeline;
-
-	VkCommandBuffer command_buffer;
-	VkCommandPool command_pool;
+	GLVKvkbindless bindless;
+	GLVKvkpipelines pipelines;
+	GLVKvkshaders shaders;
+
+	/* every vertex layout used so far, found by the hash pipeline keys select them with. 0 is the built-in vertex format */
+	std::vector<vertexlayout_t> vertex_layouts;
+	std::unordered_map<uint64_t, uint32_t> vertex_layout_lookup;
+	/* with VK_EXT_vertex_input_dynamic_state the layout is set per draw and left out of pipeline keys */
+	bool vertex_input_dynamic;
+	PFN_vkCmdSetVertexInputEXT set_vertex_input;
+
+	/* frame numbers also advance when a frame is flushed mid-recording, so work recorded before and after a flush is told apart */
+	uint32_t frame_count;
+	uint32_t frame_index;
+	uint64_t frame_number;
+	uint64_t completed_frame;
+	uint32_t image_index;
+	/* the last frame handed to glvkDraw and the image it rendered to, 0 before the first */
+	uint64_t drawn_frame;
+	uint32_t drawn_image;
+	bool frame_prepared;
+	bool frame_active;
+	std::vector<GLVKvkframe> frames;
+	std::vector<VkFence> image_fences;
+	/* signalled by the submit of a frame and waited on by its present, per swapchain image rather than per frame slot
+	 * since a slot can come around again before the presentation engine let go of the semaphore it presented with */
+	std::vector<VkSemaphore> render_finished;
+	GLVKvkcmdstate bound;
+
+	/* valid bits of the graphics queue's timestamps, 0 when it has none, and nanoseconds per tick */
+	uint32_t timestamp_bits;
+	float timestamp_period;
+	GLVKframestats frame_stats;
+	GLVKstatestats state_stats;
 
 	VkQueue graphics_queue;
 	VkQueue present_queue;
-	VkSemaphore image_available;
-	VkSemaphore render_finished;
-	VkFence in_flight_fence;
+
+	/* for synchronous work outside of the frame ring such as readbacks */
+	VkCommandPool immediate_pool;
+	VkCommandBuffer immediate_buffer;
+
+	GLVKvkmemory memory;
+	GLVKvkstaging staging;
+
+	/* idle stores keyed on size class and placement, reused instead of allocating on re-specification */
+	std::unordered_map<uint64_t, std::vector<bufferstore_t>> buffer_pool;
+
+	/* samplers by state, so there are only as many as distinct states in use. unreferenced ones are retired with the frame */
+	std::unordered_map<samplerstate_t, samplerentry_t, samplerstatehash_t, samplerstateequal_t> sampler_cache;
 
 	VkDebugUtilsMessengerEXT debug_messenger;
 } static vkstate;
 
+/* command pools of one recording thread, one per frame slot so they are reset together with the slot */
+struct GLVKvkrecorder {
+	VkCommandPool pools[GLVK_MAX_FRAMES_IN_FLIGHT];
+	std::vector<VkCommandBuffer> buffers[GLVK_MAX_FRAMES_IN_FLIGHT];
+	uint32_t used[GLVK_MAX_FRAMES_IN_FLIGHT];
+
+	/* the chunk of packets handed to the thread and the secondary command buffer it recorded them into */
+	const drawpacket_t* packets;
+	uint32_t packet_count;
+	GLfloat blend_color[4];
+	uint32_t push_constants;
+	uint32_t descriptor_set;
+	uint32_t uniform_chunk;
+	uint32_t uniform_offset;
+	uint32_t viewport;
+	uint32_t vertex_buffers;
+	uint32_t vertex_input;
+	GLVKvkcmdstate bound;
+	VkCommandBuffer result;
+};
+
+/* recorder 0 belongs to the thread issuing gl calls, the others to workers woken by bumping generation.
+ * the low bits of generation hold the number of chunks handed out with it, or GLVK_RECORD_STOP */
+struct GLVKvkrecording {
+	std::vector<GLVKvkrecorder> recorders;
+	std::vector<std::thread> workers;
+	alignas(64) std::atomic<uint64_t> generation;
+	alignas(64) std::atomic<uint32_t> pending;
+	GLVKvkframe* frame;
+} static recording;
+
+#define GLVK_NAME_INDEX_BITS 22
+#define GLVK_NAME_INDEX_MASK ((1u << GLVK_NAME_INDEX_BITS) - 1)
+#define GLVK_NAME_GENERATION_MASK ((1u << (32 - GLVK_NAME_INDEX_BITS)) - 1)
+
+/* generational slot map handing out stable gl object names with O(1) create, lookup and destroy.
+ * a name packs the slot index + 1 in its low bits and the slot's generation in its high bits,
+ * so names of destroyed objects stop resolving even after their slot is reused */
+template<typename T>
+struct objecttable_t {
+	struct slot_t {
+		T object;
+		uint32_t generation;
+		bool alive;
+	};
+
+	std::vector<slot_t> slots;
+	std::vector<uint32_t> free_slots;
+	size_t count;
+
+	/* returns 0 when the table is full */
+	GLuint create(const T& object) {
+		uint32_t index;
+		if (!free_slots.empty()) {
+			index = free_slots.back();
+			free_slots.pop_back();
+		} else {
+			if (slots.size() >= GLVK_NAME_INDEX_MASK) {
+				return 0;
+			}
+
+			index = static_cast<uint32_t>(slots.size());
+			slots.push_back({ .object = {}, .generation = 0, .alive = false });
+		}
+
+		slot_t& slot = slots[index];
+		slot.object = object;
+		slot.alive = true;
+		++count;
+		return ((slot.generation & GLVK_NAME_GENERATION_MASK) << GLVK_NAME_INDEX_BITS) | (index + 1);
+	}
+
+	T* get(GLuint name) {
+		uint32_t index = (name & GLVK_NAME_INDEX_MASK) - 1;
+		if ((name & GLVK_NAME_INDEX_MASK) == 0 || index >= slots.size()) {
+			return nullptr;
+		}
+
+		slot_t& slot = slots[index];
+		if (!slot.alive || (slot.generation & GLVK_NAME_GENERATION_MASK) != (name >> GLVK_NAME_INDEX_BITS)) {
+			return nullptr;
+		}
+
+		return &slot.object;
+	}
+
+	bool destroy(GLuint name) {
+		if (get(name) == nullptr) {
+			return false;
+		}
+
+		uint32_t index = (name & GLVK_NAME_INDEX_MASK) - 1;
+		slot_t& slot = slots[index];
+		slot.object = {};
+		slot.alive = false;
+		++slot.generation;
+		free_slots.push_back(index);
+		--count;
+		return true;
+	}
+
+	template<typename F>
+	void forEach(F func) {
+		for (slot_t& slot : slots) {
+			if (slot.alive) {
+				func(slot.object);
+			}
+		}
+	}
+
+	void clear() {
+		slots.clear();
+		free_slots.clear();
+		count = 0;
+	}
+};
+
 struct glbuffer_t {
 	GLuint id;
-	VkBuffer buffer;
-	VkDeviceMemory memory;
+	bufferstore_t store;
 	VkDeviceSize size;
 	GLenum usage;
+
+	/* map_access is 0 while unmapped, a shadowed mapping points into map_shadow and is uploaded on unmap */
+	GLbitfield map_access;
+	VkDeviceSize map_offset;
+	VkDeviceSize map_length;
+	void* map_pointer;
+	bool map_shadowed;
+	std::vector<uint8_t> map_shadow;
+	std::vector<std::pair<VkDeviceSize, VkDeviceSize>> map_flushed;
+};
+
+/* a buffer range bound to an indexed target with glBindBufferBase/Range */
+struct glindexedbinding_t {
+	GLuint buffer;
+	GLintptr offset;
+	/* 0 binds the whole buffer, whatever size it has at draw time */
+	GLsizeiptr size;
+	/* the descriptor the binding resolved to last, reused while it still points at the same range */
+	uint32_t slot;
+};
+
+struct glvertexattrib_t {
+	bool enabled;
+	/* set by glVertexAttribIPointer, the values reach the shader without conversion to float */
+	bool integer;
+	GLboolean normalized;
+	GLint size;
+	GLenum type;
+	/* 0 for tightly packed */
+	GLsizei stride;
+	GLuint buffer;
+	GLintptr offset;
+	GLuint divisor;
+};
+
+struct glvertexarray_t {
+	GLuint id;
+	glvertexattrib_t attribs[GLVK_MAX_VERTEX_ATTRIBS];
+	/* the element array binding belongs to the vao, it is kept in bound_buffers while the vao is bound */
+	GLuint element_array;
+
+	/* the layout is compiled again by the next draw once attribute state changed */
+	bool dirty;
+	uint32_t layout;
+	uint64_t layout_hash;
+	/* buffer and base offset of each binding of the layout, attribute offsets are relative to the base */
+	uint32_t binding_count;
+	GLuint binding_buffers[GLVK_MAX_VERTEX_ATTRIBS];
+	GLintptr binding_offsets[GLVK_MAX_VERTEX_ATTRIBS];
+};
+
+struct gltexture_t {
+	GLuint id;
+	/* 0 until the name is first bound, then GL_TEXTURE_2D for good */
+	GLenum target;
+	imagestore_t store;
+	GLenum internal_format;
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	/* glTexStorage2D fixed the format, size and levels */
+	bool immutable;
+	/* glTexParameter state, sampled with while no sampler object is bound to the unit. sampler holds a reference
+	 * to the cached sampler of sampler_state, taken on the first draw after it changed */
+	samplerstate_t sampler_state;
+	VkSampler sampler;
+};
+
+struct glsampler_t {
+	GLuint id;
+	samplerstate_t state;
+	VkSampler sampler;
+};
+
+struct glshader_t {
+	GLuint id;
+	GLenum type;
+	std::string source;
+	/* the spir-v of the last successful compile */
+	std::vector<uint32_t> spirv;
+	std::string info_log;
+	bool compiled;
+	/* deleted while attached, destroyed once the last program lets go of it */
+	bool delete_pending;
+	uint32_t attach_count;
+};
+
+struct glprogram_t {
+	GLuint id;
+	std::vector<GLuint> shaders;
+	/* the link number of the executable in GLVKvkshaders::programs, 0 before the first successful link */
+	uint64_t link;
+	bool linked;
+	std::string info_log;
+	/* deleted while current, destroyed once another program is used */
+	bool delete_pending;
+};
+
+/* a texture unit's GL_TEXTURE_2D and sampler object bindings and the descriptor it resolved to last */
+struct gltextureunit_t {
+	GLuint texture;
+	GLuint sampler;
+	uint32_t slot;
+};
+
+/* GL_UNPACK_* pixel store state that pixels given to texture uploads are read with, and GL_PACK_* state glReadPixels writes with */
+struct GLVKglpixelstore {
+	GLint alignment;
+	GLint row_length;
+	GLint skip_rows;
+	GLint skip_pixels;
+};
+
+struct GLVKglindexedbuffers {
+	glindexedbinding_t uniform[GLVK_MAX_UNIFORM_BUFFER_BINDINGS];
+	glindexedbinding_t storage[GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS];
+	/* bindings with a buffer bound */
+	uint32_t uniform_mask;
+	uint32_t storage_mask;
 };
 
 struct GLVKglboundbuffers {
@@ -131,22 +926,172 @@ struct GLVKglboundbuffers {
 	GLuint texture;
 };
 
+/* fixed function state that ends up in the pipeline key */
+struct GLVKglraster {
+	bool cull_face;
+	GLenum cull_mode;
+	GLenum front_face;
+	GLenum polygon_mode;
+	bool rasterizer_discard;
+	bool primitive_restart;
+
+	bool depth_test;
+	bool depth_write;
+	GLenum depth_func;
+
+	bool blend;
+	GLenum blend_src_rgb;
+	GLenum blend_dst_rgb;
+	GLenum blend_src_alpha;
+	GLenum blend_dst_alpha;
+	GLenum blend_equation_rgb;
+	GLenum blend_equation_alpha;
+	GLboolean color_mask[4];
+};
+
+struct glquery_t {
+	GLuint id;
+	/* 0 until the query is first used, then GL_TIME_ELAPSED or GL_TIMESTAMP for good */
+	GLenum target;
+	bool active;
+	/* bumped whenever the query is begun or counted again */
+	uint32_t serial;
+	/* a bit per timestamp that was written, and per timestamp still to be read from the slot that wrote it */
+	uint32_t written;
+	uint32_t pending;
+	uint64_t ticks[2];
+	uint64_t frames[2];
+	uint32_t slots[2];
+};
+
+/* loose glUniform* state. location l is the vec4 slot at byte 16 * l, size covers the slots written so far */
+struct gluniformblock_t {
+	alignas(16) uint8_t data[GLVK_UNIFORM_BLOCK_SIZE];
+	uint32_t size;
+	/* the block changed since it was last copied to the uniform ring */
+	bool dirty;
+	/* the frame the last copy was made in, draws keep using it while nothing changed */
+	uint64_t upload_frame;
+	uint32_t chunk;
+	uint32_t offset;
+	/* the last copy is bound in the current render pass */
+	bool bound;
+};
+
+/* groups of gl state a draw turns into commands, set when the state changes and cleared once a draw has emitted it.
+ * vertex and index buffers are not tracked here: orphaning renames them without a gl call, so packets carry them
+ * and they are compared against what the command buffer has bound when recorded */
+enum dirtybit_t {
+	DIRTY_PIPELINE = 1 << 0,
+	DIRTY_VIEWPORT = 1 << 1,
+	DIRTY_BLEND_CONSTANTS = 1 << 2,
+	DIRTY_DESCRIPTORS = 1 << 3,
+	/* the vertex layout with dynamic vertex input, the vertex array's buffers after something else was bound in between */
+	DIRTY_VERTEX_INPUT = 1 << 4,
+	DIRTY_VERTEX_BUFFERS = 1 << 5,
+};
+
 struct GLVKglstate {
 	std::stack<GLenum> errors;
-	std::vector<glbuffer_t> buffers;
+	objecttable_t<glbuffer_t> buffers;
+	objecttable_t<glquery_t> queries;
+	/* the query begun on GL_TIME_ELAPSED, 0 when there is none */
+	GLuint active_query;
 
 	GLVKglboundbuffers bound_buffers;
+	GLVKglindexedbuffers indexed_buffers;
+	objecttable_t<gltexture_t> textures;
+	objecttable_t<glsampler_t> samplers;
+	gltextureunit_t texture_units[GLVK_MAX_TEXTURE_UNITS];
+	/* units with a texture bound */
+	uint32_t texture_mask;
+	uint32_t active_texture;
+	GLVKglpixelstore unpack;
+	GLVKglpixelstore pack;
+	objecttable_t<glshader_t> shaders;
+	objecttable_t<glprogram_t> programs;
+	/* the program of glUseProgram, 0 draws with the built-in shaders */
+	GLuint program;
+	objecttable_t<glvertexarray_t> vertex_arrays;
 	GLuint bound_vao;
+	/* the element array binding of vertex array 0 while another one is bound */
+	GLuint default_element_array;
+
+	/* descriptor indices of the current bindings, pushed with the next draw once dirty.
+	 * without descriptor indexing binding_set holds what the bindings point at instead */
+	pushconstants_t bindings;
+	descriptorsetkey_t binding_set;
+
+	gluniformblock_t uniforms;
+
+	/* DIRTY_* groups changed since the last draw */
+	uint32_t dirty;
+	/* the pipeline of the last draw, looked up again only once DIRTY_PIPELINE is set */
+	VkPipeline pipeline;
+	VkPrimitiveTopology topology;
+	/* hash of the vertex layout pipelines are selected with, the layout last set as dynamic vertex input
+	 * and the vertex array buffers last bound */
+	uint64_t vertex_layout;
+	uint32_t vertex_input;
+	vertexbuffers_t vertex_buffers;
+
+	GLVKglraster raster;
+	/* blend constants are dynamic state and not part of the pipeline key */
+	GLfloat blend_color[4];
+
+	/* glViewport and glScissor in window coordinates, both cover the whole target until they are first set */
+	bool viewport_set;
+	GLint viewport[4];
+	bool scissor_set;
+	bool scissor_test;
+	GLint scissor_box[4];
 } static glstate;
 
 struct GLVKstate {
 	bool inited;
+	uint32_t frames_in_flight;
+
+	/* pipeline_cache_path is only used once pipeline_cache_set, an empty path disables the disk cache */
+	bool pipeline_cache_set;
+	std::string pipeline_cache_path;
+	/* likewise for the shader cache directory */
+	bool shader_cache_set;
+	std::string shader_cache_path;
 
 	bool is_debug;
 	GLVKdebugfunc debugfunc;
 	GLVKwindow window;
+
+	/* gl calls are recorded into the command ring and replayed by a worker thread, set before glvkInit */
+	bool threaded;
+	uint32_t record_threads;
 } static state;
 
+/* every entry in the command ring starts with this header, entries without execute are skipped (ring wrap, copied data) */
+struct alignas(GLVK_COMMAND_ALIGNMENT) commandheader_t {
+	void (*execute)(commandheader_t* header);
+	uint32_t size;
+};
+
+/* single producer (the gl thread), single consumer (the worker) ring of commands.
+ * head and tail are byte positions that only grow, the worker publishes tail after every executed command */
+struct GLVKcommandring {
+	std::unique_ptr<uint8_t[]> buffer;
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+
+	/* producer side, entries up to write are reserved but only published up to head */
+	alignas(64) uint64_t write;
+	bool running;
+
+	/* worker side */
+	std::thread worker;
+	bool stopping;
+} static commands;
+
+/* set on the worker and while the gl thread runs a call directly, nested entry points then execute instead of being recorded */
+static thread_local bool command_direct = false;
+
 struct layer_t {
 	const char* name;
 	bool required;
@@ -188,673 +1133,1194 @@ static void debugFunc(GLVKmessagetype type, GLVKmessageseverity severity, const
 	state.debugfunc(stream.str().c_str(), type, severity);
 }
 
-void glvkRegisterDebugFunc(GLVKdebugfunc func) {
-	if (func == nullptr) {
-		return;
-	}
-
-	state.debugfunc = func;
-}
-
-void glvkSetDebug(int is_debug) {
-	state.is_debug = (is_debug != 0);
+static uint32_t commandSize(size_t size) {
+	return static_cast<uint32_t>((size + GLVK_COMMAND_ALIGNMENT - 1) & ~static_cast<size_t>(GLVK_COMMAND_ALIGNMENT - 1));
 }
 
-static void glPushError(GLenum error) {
-	if (glstate.errors.size() > 64) {
-		glstate.errors.pop();
+/* blocks until size more bytes fit into the ring */
+static void commandWait(uint64_t size) {
+	uint64_t tail = commands.tail.load(std::memory_order_acquire);
+	while (commands.write + size - tail > GLVK_COMMAND_RING_SIZE) {
+		commands.tail.wait(tail, std::memory_order_acquire);
+		tail = commands.tail.load(std::memory_order_acquire);
 	}
-	glstate.errors.push(error);
 }
 
-int glvkInit(GLVKwindow window) {
-	GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Initialization started");
-	if (state.inited) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glvk already initialized");
-		return 0;
+/* returns contiguous space for an entry of size bytes, the entry is published by commandCommit */
+static commandheader_t* commandReserve(uint32_t size) {
+	uint64_t offset = commands.write % GLVK_COMMAND_RING_SIZE;
+	if (offset + size > GLVK_COMMAND_RING_SIZE) {
+		/* the entry does not fit before the end of the ring, the rest of it is skipped */
+		uint32_t remaining = static_cast<uint32_t>(GLVK_COMMAND_RING_SIZE - offset);
+		commandWait(remaining);
+
+		commandheader_t* skip = reinterpret_cast<commandheader_t*>(&commands.buffer[offset]);
+		skip->execute = nullptr;
+		skip->size = remaining;
+		commands.write += remaining;
+		offset = 0;
 	}
-	state.window = window;
 
-	vkstate.info.app = {
-		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
-		.pNext = nullptr,
-		.pApplicationName = "glvk",
-		.applicationVersion = VK_MAKE_VERSION(1, 0, 0),
-		.pEngineName = "glvk",
-		.engineVersion = VK_MAKE_VERSION(1, 0, 0),
-		.apiVersion = VK_API_VERSION_1_3,
-	};
+	commandWait(size);
+	return reinterpret_cast<commandheader_t*>(&commands.buffer[offset]);
+}
 
-	std::vector<layer_t> requested_instance_layers;
-	std::vector<extension_t> requested_instance_extensions = {
-		{ VK_KHR_SURFACE_EXTENSION_NAME, true },
-		{ SURFACE_EXTENSION_NAME, true },
-	};
+static void commandCommit(uint32_t size) {
+	commands.write += size;
+	commands.head.store(commands.write, std::memory_order_release);
+	commands.head.notify_one();
+}
 
-	if (state.is_debug) {
-		requested_instance_layers.push_back({ "VK_LAYER_KHRONOS_validation", false });
-		requested_instance_extensions.push_back({ VK_EXT_DEBUG_UTILS_EXTENSION_NAME, false });
+/* copies data the caller may reuse once the call returns into the ring, it lives until the next command has executed */
+static const void* commandCopy(const void* data, size_t size) {
+	if (data == nullptr || size == 0) {
+		return nullptr;
 	}
 
-	#ifdef GLVK_MAC
+	uint32_t entry_size = commandSize(sizeof(commandheader_t) + size);
+	commandheader_t* header = commandReserve(entry_size);
+	header->execute = nullptr;
+	header->size = entry_size;
+	std::memcpy(header + 1, data, size);
+	commands.write += entry_size;
 
-	#endif
+	return header + 1;
+}
 
-	uint32_t instance_layer_count = 0;
-	vkEnumerateInstanceLayerProperties(&instance_layer_count, nullptr);
+template<auto func, typename... Args>
+static void commandReplay(commandheader_t* header) {
+	std::apply(func, *reinterpret_cast<std::tuple<Args...>*>(header + 1));
+}
 
-	std::vector<VkLayerProperties> layer_props(instance_layer_count);
-	vkEnumerateInstanceLayerProperties(&instance_layer_count, layer_props.data());
-
-	std::vector<const char*> instance_layers;
-	for (const layer_t& layer : requested_instance_layers) {
-		bool found = false;
-		for (const VkLayerProperties& prop : layer_props) {
-			if (strcmp(prop.layerName, layer.name) == 0) {
-				found = true;
-				instance_layers.push_back(layer.name);
-			}
-		}
+/* records a call of func with args, the worker replays it through the same entry point */
+template<auto func, typename... Args>
+static void deferCommand(Args... args) {
+	static_assert((std::is_trivially_copyable_v<Args> && ...), "recorded arguments must be trivially copyable");
+
+	uint32_t size = commandSize(sizeof(commandheader_t) + sizeof(std::tuple<Args...>));
+	commandheader_t* header = commandReserve(size);
+	header->execute = commandReplay<func, Args...>;
+	header->size = size;
+	new (header + 1) std::tuple<Args...>(args...);
+	commandCommit(size);
+}
 
-		if (layer.required && !found) {
-			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find required Vulkan instance layer {}", layer.name);
-			return 1;
-		} else if (!found) {
-			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Failed to find Vulkan instance layer {}", layer.name);
-		}
+/* waits until the worker has executed everything recorded so far */
+static void commandFlush() {
+	uint64_t tail = commands.tail.load(std::memory_order_acquire);
+	while (tail != commands.write) {
+		commands.tail.wait(tail, std::memory_order_acquire);
+		tail = commands.tail.load(std::memory_order_acquire);
 	}
+}
 
-	uint32_t instance_extension_count = 0;
-	vkEnumerateInstanceExtensionProperties(nullptr, &instance_extension_count, nullptr);
-
-	std::vector<VkExtensionProperties> extension_props(instance_extension_count);
-	vkEnumerateInstanceExtensionProperties(nullptr, &instance_extension_count, extension_props.data());
+static bool commandThreaded() {
+	return !command_direct && commands.running;
+}
 
-	std::vector<const char*> instance_extensions;
-	for (const extension_t& extension : requested_instance_extensions) {
-		bool found = false;
-		for (const VkExtensionProperties& prop : extension_props) {
-			if (strcmp(prop.extensionName, extension.name) == 0) {
-				found = true;
-				instance_extensions.push_back(extension.name);
-			}
-		}
+/* runs the rest of the calling entry point on the gl thread, after the worker has caught up */
+struct commandsync_t {
+	bool outer;
 
-		if (extension.required && !found) {
-			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find required Vulkan instance extension {}", extension.name);
-			return 1;
-		} else if (!found) {
-			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Failed to find Vulkan instance extension {}", extension.name);
+	commandsync_t() : outer(!command_direct) {
+		if (outer && commands.running) {
+			commandFlush();
 		}
+		command_direct = true;
 	}
 
-	VkInstanceCreateInfo instance_create_info = {
-		.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-		.pApplicationInfo = &vkstate.info.app,
-		.enabledLayerCount = static_cast<uint32_t>(instance_layers.size()),
-		.ppEnabledLayerNames = instance_layers.data(),
-		.enabledExtensionCount = static_cast<uint32_t>(instance_extensions.size()),
-		.ppEnabledExtensionNames = instance_extensions.data(),
-	};
-
-	if (vkCreateInstance(&instance_create_info, vkstate.allocator, &vkstate.instance) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan instance");
-		return 1;
+	~commandsync_t() {
+		command_direct = !outer;
 	}
+};
 
-	if (state.is_debug) {
-		for (const char*& name : instance_extensions) {
-			if (strcmp(name, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0) {
-				PFN_vkCreateDebugUtilsMessengerEXT vkCreateDebugUtilsMessengerEXT = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(vkstate.instance, "vkCreateDebugUtilsMessengerEXT"));
-				if (vkCreateDebugUtilsMessengerEXT == nullptr) {
-					GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_WARNING, "Failed to find vkCreateDebugUtilsMessengerEXT");
-					break;
-				}
-
-				VkDebugUtilsMessengerCreateInfoEXT debug_create_info = {
-					.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
-					.pNext = nullptr,
-					.flags = 0,
-					.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
-					.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
-					.pfnUserCallback = [](VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_type, const VkDebugUtilsMessengerCallbackDataEXT* callback_data, void* user_data) -> VkBool32 {
-						const char* const severity = (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) ? "verbose" : (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) ? "info" : (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) ? "warning" : (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) ? "error" : "unknown";
-						const char* const type = (message_type & VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT) ? "general" : (message_type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) ? "performance" : (message_type & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT) ? "validation" : "unknown";
-						GLVKDEBUGF(GLVK_TYPE_VULKAN, GLVK_SEVERITY_DEBUG, "[{}] ({}) {}", severity, type, callback_data->pMessage);
+#define GLVK_DEFER(func, ...) if (commandThreaded()) { deferCommand<func>(__VA_ARGS__); return; }
+#define GLVK_SYNC() commandsync_t command_sync
 
-						if (message_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
-							return VK_TRUE;
-						}
+static void commandWorker() {
+	command_direct = true;
 
-						return VK_FALSE;
-					},
-					.pUserData = nullptr,
-				};
+	uint64_t read = commands.tail.load(std::memory_order_relaxed);
+	while (!commands.stopping) {
+		uint64_t head = commands.head.load(std::memory_order_acquire);
+		if (read == head) {
+			commands.head.wait(head, std::memory_order_acquire);
+			continue;
+		}
 
-				if (vkCreateDebugUtilsMessengerEXT(vkstate.instance, &debug_create_info, vkstate.allocator, &vkstate.debug_messenger) != VK_SUCCESS) {
-					GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_WARNING, "Failed to create Vulkan debug messenger");
-				}
-				break;
+		while (read != head) {
+			commandheader_t* header = reinterpret_cast<commandheader_t*>(&commands.buffer[read % GLVK_COMMAND_RING_SIZE]);
+			read += header->size;
+			if (header->execute == nullptr) {
+				continue;
 			}
+
+			header->execute(header);
+			commands.tail.store(read, std::memory_order_release);
+			commands.tail.notify_one();
 		}
 	}
+}
 
-	#ifdef GLVK_WINDOWS
-	if (window.hwnd == nullptr) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Window handle is null");
-		return 1;
-	}
+static void commandStopWorker() {
+	commands.stopping = true;
+}
+
+static void commandStart() {
+	commands.buffer = std::make_unique<uint8_t[]>(GLVK_COMMAND_RING_SIZE);
+	commands.head.store(0, std::memory_order_relaxed);
+	commands.tail.store(0, std::memory_order_relaxed);
+	commands.write = 0;
+	commands.stopping = false;
+	commands.running = true;
+	commands.worker = std::thread(commandWorker);
+}
 
-	if (window.hinstance == nullptr) {
-		window.hinstance = GetModuleHandle(nullptr);
+/* executes everything still recorded and joins the worker */
+static void commandStop() {
+	if (!commands.running) {
+		return;
 	}
 
-	VkWin32SurfaceCreateInfoKHR surface_create_info = {
-		.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
-		.pNext = nullptr,
-		.flags = 0,
-		.hinstance = reinterpret_cast<HINSTANCE>(window.hinstance),
-		.hwnd = reinterpret_cast<HWND>(window.hwnd),
-	};
+	deferCommand<commandStopWorker>();
+	commands.worker.join();
+	commands.running = false;
+	commands.buffer.reset();
+}
 
-	if (vkCreateWin32SurfaceKHR(vkstate.instance, &surface_create_info, vkstate.allocator, &vkstate.surface) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan surface");
-		return 1;
+void glvkRegisterDebugFunc(GLVKdebugfunc func) {
+	GLVK_SYNC();
+	if (func == nullptr) {
+		return;
 	}
-	#elif GLVK_LINUX
-	if (window.display == nullptr) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Display is null");
-		return 1;
+
+	state.debugfunc = func;
+}
+
+void glvkSetDebug(int is_debug) {
+	GLVK_SYNC();
+	state.is_debug = (is_debug != 0);
+}
+
+void glvkSetFramesInFlight(unsigned int count) {
+	if (state.inited) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Frames in flight can only be changed before glvkInit");
+		return;
 	}
-	if (window.window == 0) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Window is null");
-		return 1;
+
+	if (count < 1) {
+		count = 1;
+	} else if (count > GLVK_MAX_FRAMES_IN_FLIGHT) {
+		count = GLVK_MAX_FRAMES_IN_FLIGHT;
 	}
 
-	VkXlibSurfaceCreateInfoKHR surface_create_info = {
-		.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR,
-		.pNext = nullptr,
-		.flags = 0,
-		.dpy = reinterpret_cast<Display*>(window.display),
-		.window = static_cast<Window>(window.window),
-	};
+	state.frames_in_flight = count;
+}
 
-	if (vkCreateXlibSurfaceKHR(vkstate.instance, &surface_create_info, vkstate.allocator, &vkstate.surface) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan surface");
-		return 1;
+void glvkSetThreaded(int enabled) {
+	if (state.inited) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Threaded mode can only be changed before glvkInit");
+		return;
 	}
-	#elif GLVK_MAC
-	if (window.layer == nullptr) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "layer is null");
-		return 1;
+
+	state.threaded = (enabled != 0);
+}
+
+void glvkSetRecordThreads(unsigned int count) {
+	if (state.inited) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Record threads can only be changed before glvkInit");
+		return;
 	}
 
-	VkMetalSurfaceCreateInfoEXT surface_create_info = {
-		.sType = VK_STRUCTURE_TYPE_METAL_SURFACE_CREATE_INFO_EXT,
-		.pNext = nullptr,
-		.flags = 0,
-		.pLayer = window.layer,
-	};
+	state.record_threads = std::clamp(count, 1u, static_cast<unsigned int>(GLVK_MAX_RECORD_THREADS));
+}
 
-	if (vkCreateMetalSurfaceEXT(vkstate.instance, &surface_create_info, vkstate.allocator, &vkstate.surface) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan surface");
-		return 1;
+void glvkSetPipelineCachePath(const char* path) {
+	if (state.inited) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Pipeline cache path can only be changed before glvkInit");
+		return;
 	}
-	#endif
 
-	uint32_t physical_count = 0;
-	vkEnumeratePhysicalDevices(vkstate.instance, &physical_count, nullptr);
+	state.pipeline_cache_set = true;
+	state.pipeline_cache_path = (path == nullptr) ? "" : path;
+}
 
-	std::vector<VkPhysicalDevice> physicals(physical_count);
-	vkEnumeratePhysicalDevices(vkstate.instance, &physical_count, physicals.data());
+void glvkSetShaderCachePath(const char* path) {
+	if (state.inited) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Shader cache path can only be changed before glvkInit");
+		return;
+	}
 
-	VkPhysicalDeviceProperties physical_props;
-	VkPhysicalDeviceFeatures physical_features;
-	VkPhysicalDeviceMemoryProperties physical_mem_props;
+	state.shader_cache_set = true;
+	state.shader_cache_path = (path == nullptr) ? "" : path;
+}
 
-	{
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_VERBOSE, "Physical devices available:");
+static void glPushError(GLenum error) {
+	if (glstate.errors.size() > 64) {
+		glstate.errors.pop();
+	}
+	glstate.errors.push(error);
+}
 
-		size_t best = 0;
-		size_t best_index = std::numeric_limits<size_t>::max();
-		for (size_t i = 0; i < physicals.size(); ++i) {
-			vkGetPhysicalDeviceProperties(physicals[i], &physical_props);
-			vkGetPhysicalDeviceFeatures(physicals[i], &physical_features);
-			vkGetPhysicalDeviceMemoryProperties(physicals[i], &physical_mem_props);
+static void tlsfMapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl) {
+	if (size < TLSF_SMALL_SIZE) {
+		fl = 0;
+		sl = static_cast<uint32_t>(size / (TLSF_SMALL_SIZE / TLSF_SL_COUNT));
+		return;
+	}
 
-			size_t score = 0;
-			if (physical_props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-				score += 10000;
-			}
+	uint32_t f = static_cast<uint32_t>(std::bit_width(size)) - 1;
+	fl = f - (TLSF_SL_LOG2 + 4) + 1;
+	sl = static_cast<uint32_t>(size >> (f - TLSF_SL_LOG2)) - TLSF_SL_COUNT;
+	if (fl >= TLSF_FL_COUNT) {
+		fl = TLSF_FL_COUNT - 1;
+		sl = TLSF_SL_COUNT - 1;
+	}
+}
 
-			score += physical_props.limits.maxImageDimension2D;
-			score += static_cast<size_t>(physical_props.limits.maxFramebufferWidth * physical_props.limits.maxFramebufferHeight) * 0.01f;
+static void tlsfInsert(memblock_t& block, uint32_t index) {
+	tlsfnode_t& node = block.nodes[index];
+	uint32_t fl, sl;
+	tlsfMapping(node.size, fl, sl);
 
-			if (score > best) {
-				best = score;
-				best_index = i;
-			}
+	node.free = true;
+	node.prev_free = TLSF_NONE;
+	node.next_free = block.heads[fl][sl];
+	if (node.next_free != TLSF_NONE) {
+		block.nodes[node.next_free].prev_free = index;
+	}
 
-			const char* const device_types[VK_PHYSICAL_DEVICE_TYPE_CPU + 1] = {
-				"Other",
-				"Integrated",
-				"Discrete",
-				"Virtual",
-				"CPU",
-			};
+	block.heads[fl][sl] = index;
+	block.fl_bitmap |= 1u << fl;
+	block.sl_bitmaps[fl] |= 1u << sl;
+}
 
-			GLVKDEBUGF(GLVK_TYPE_VULKAN, GLVK_SEVERITY_VERBOSE, "    [{}] ({}) {}", device_types[physical_props.deviceType], score, physical_props.deviceName);
-		}
+static void tlsfRemove(memblock_t& block, uint32_t index) {
+	tlsfnode_t& node = block.nodes[index];
+	uint32_t fl, sl;
+	tlsfMapping(node.size, fl, sl);
 
-		if (best_index == std::numeric_limits<size_t>::max()) {
-			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find GPU");
-			return 1;
-		}
+	if (node.prev_free != TLSF_NONE) {
+		block.nodes[node.prev_free].next_free = node.next_free;
+	} else {
+		block.heads[fl][sl] = node.next_free;
+	}
 
-		vkstate.physical.device = physicals[best_index];
+	if (node.next_free != TLSF_NONE) {
+		block.nodes[node.next_free].prev_free = node.prev_free;
 	}
 
-	if (vkstate.physical.device == VK_NULL_HANDLE) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find GPU");
-		return 1;
+	if (block.heads[fl][sl] == TLSF_NONE) {
+		block.sl_bitmaps[fl] &= ~(1u << sl);
+		if (block.sl_bitmaps[fl] == 0) {
+			block.fl_bitmap &= ~(1u << fl);
+		}
 	}
 
-	vkGetPhysicalDeviceProperties(vkstate.physical.device, &vkstate.physical.properties);
-	vkGetPhysicalDeviceFeatures(vkstate.physical.device, &vkstate.physical.features);
-	vkGetPhysicalDeviceMemoryProperties(vkstate.physical.device, &vkstate.physical.memory_properties);
-	GLVKDEBUGF(GLVK_TYPE_VULKAN, GLVK_SEVERITY_VERBOSE, "Found GPU \"{}\"", vkstate.physical.properties.deviceName);
+	node.free = false;
+	node.prev_free = TLSF_NONE;
+	node.next_free = TLSF_NONE;
+}
 
-	std::vector<layer_t> requested_device_layers;
-	std::vector<extension_t> requested_device_extensions = {
-		{ VK_KHR_SWAPCHAIN_EXTENSION_NAME, true },
+static uint32_t tlsfNewNode(memblock_t& block, VkDeviceSize offset, VkDeviceSize size) {
+	tlsfnode_t node = {
+		.offset = offset,
+		.size = size,
+		.prev_phys = TLSF_NONE,
+		.next_phys = TLSF_NONE,
+		.prev_free = TLSF_NONE,
+		.next_free = TLSF_NONE,
+		.free = false,
 	};
 
-	if (state.is_debug) {
-		requested_device_layers.push_back({ "VK_LAYER_KHRONOS_validation", false });
+	if (!block.unused_nodes.empty()) {
+		uint32_t index = block.unused_nodes.back();
+		block.unused_nodes.pop_back();
+		block.nodes[index] = node;
+		return index;
 	}
 
-	uint32_t device_layer_count = 0;
-	vkEnumerateDeviceLayerProperties(vkstate.physical.device, &device_layer_count, nullptr);
+	block.nodes.push_back(node);
+	return static_cast<uint32_t>(block.nodes.size() - 1);
+}
 
-	std::vector<VkLayerProperties> device_layer_props(device_layer_count);
-	vkEnumerateDeviceLayerProperties(vkstate.physical.device, &device_layer_count, device_layer_props.data());
+/* returns a free node at least size bytes large, rounding up to the next size class so any node in the class fits */
+static uint32_t tlsfFind(memblock_t& block, VkDeviceSize size) {
+	if (size >= TLSF_SMALL_SIZE) {
+		size += (static_cast<VkDeviceSize>(1) << (std::bit_width(size) - 1 - TLSF_SL_LOG2)) - 1;
+	} else {
+		size += (TLSF_SMALL_SIZE / TLSF_SL_COUNT) - 1;
+	}
 
-	std::vector<const char*> device_layer_names;
-	for (layer_t& layer : requested_device_layers) {
-		bool found = false;
-		for (VkLayerProperties& prop : device_layer_props) {
-			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, prop.layerName);
-			if (strcmp(prop.layerName, layer.name) == 0) {
-				found = true;
-				device_layer_names.push_back(layer.name);
-				break;
-			}
-		}
+	uint32_t fl, sl;
+	tlsfMapping(size, fl, sl);
 
-		if (!found) {
-			if (layer.required) {
-				GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find required Vulkan device layer ", layer.name);
-				return 1;
-			} else {
-				GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_DEBUG, "Failed to find Vulkan device layer ", layer.name);
-			}
+	uint32_t sl_map = block.sl_bitmaps[fl] & (~0u << sl);
+	if (sl_map == 0) {
+		uint32_t fl_map = (fl + 1 < TLSF_FL_COUNT) ? (block.fl_bitmap & (~0u << (fl + 1))) : 0;
+		if (fl_map == 0) {
+			return TLSF_NONE;
 		}
+
+		fl = std::countr_zero(fl_map);
+		sl_map = block.sl_bitmaps[fl];
 	}
 
-	uint32_t device_extension_count = 0;
-	vkEnumerateDeviceExtensionProperties(vkstate.physical.device, nullptr, &device_extension_count, nullptr);
+	sl = std::countr_zero(sl_map);
+	return block.heads[fl][sl];
+}
 
-	std::vector<VkExtensionProperties> device_extension_props(device_extension_count);
-	vkEnumerateDeviceExtensionProperties(vkstate.physical.device, nullptr, &device_extension_count, device_extension_props.data());
+static uint32_t tlsfAllocate(memblock_t& block, VkDeviceSize size, VkDeviceSize alignment) {
+	uint32_t index = tlsfFind(block, size + alignment - 1);
+	if (index == TLSF_NONE) {
+		return TLSF_NONE;
+	}
 
-	std::vector<const char*> device_extension_names;
-	for (extension_t& extension : requested_device_extensions) {
-		bool found = false;
-		for (VkExtensionProperties& prop : device_extension_props) {
-			if (strcmp(prop.extensionName, extension.name) == 0) {
-				found = true;
-				device_extension_names.push_back(extension.name);
-				break;
-			}
+	tlsfRemove(block, index);
+
+	VkDeviceSize offset = block.nodes[index].offset;
+	VkDeviceSize aligned = (offset + alignment - 1) & ~(alignment - 1);
+	if (aligned != offset) {
+		uint32_t pad = tlsfNewNode(block, offset, aligned - offset);
+		tlsfnode_t& node = block.nodes[index];
+		block.nodes[pad].prev_phys = node.prev_phys;
+		block.nodes[pad].next_phys = index;
+		if (node.prev_phys != TLSF_NONE) {
+			block.nodes[node.prev_phys].next_phys = pad;
 		}
 
-		if (!found) {
-			if (extension.required) {
-				GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find required Vulkan device extension ", extension.name);
-				return 1;
-			} else {
-				GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Failed to find Vulkan device extension ", extension.name);
-			}
+		node.prev_phys = pad;
+		node.offset = aligned;
+		node.size -= aligned - offset;
+		tlsfInsert(block, pad);
+	}
+
+	if (block.nodes[index].size - size >= TLSF_MIN_SPLIT) {
+		uint32_t tail = tlsfNewNode(block, block.nodes[index].offset + size, block.nodes[index].size - size);
+		tlsfnode_t& node = block.nodes[index];
+		block.nodes[tail].prev_phys = index;
+		block.nodes[tail].next_phys = node.next_phys;
+		if (node.next_phys != TLSF_NONE) {
+			block.nodes[node.next_phys].prev_phys = tail;
 		}
+
+		node.next_phys = tail;
+		node.size = size;
+		tlsfInsert(block, tail);
 	}
 
-	uint32_t queue_family_count = 0;
-	vkGetPhysicalDeviceQueueFamilyProperties(vkstate.physical.device, &queue_family_count, nullptr);
-
-	std::vector<VkQueueFamilyProperties> queue_family_props(queue_family_count);
-	vkGetPhysicalDeviceQueueFamilyProperties(vkstate.physical.device, &queue_family_count, queue_family_props.data());
+	return index;
+}
 
-	uint32_t gfx = std::numeric_limits<uint32_t>::max();
-	uint32_t prs = std::numeric_limits<uint32_t>::max();
-	for (uint32_t i = 0; i < queue_family_count; ++i) {
-		if (queue_family_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-			gfx = i;
+static void tlsfFree(memblock_t& block, uint32_t index) {
+	uint32_t prev = block.nodes[index].prev_phys;
+	if (prev != TLSF_NONE && block.nodes[prev].free) {
+		tlsfRemove(block, prev);
+		block.nodes[prev].size += block.nodes[index].size;
+		block.nodes[prev].next_phys = block.nodes[index].next_phys;
+		if (block.nodes[prev].next_phys != TLSF_NONE) {
+			block.nodes[block.nodes[prev].next_phys].prev_phys = prev;
 		}
 
-		VkBool32 present = VK_FALSE;
-		vkGetPhysicalDeviceSurfaceSupportKHR(vkstate.physical.device, i, vkstate.surface, &present);
-		if (present == VK_TRUE) {
-			prs = i;
-		}
+		block.unused_nodes.push_back(index);
+		index = prev;
+	}
 
-		if (gfx != std::numeric_limits<uint32_t>::max() && prs != std::numeric_limits<uint32_t>::max()) {
-			break;
+	uint32_t next = block.nodes[index].next_phys;
+	if (next != TLSF_NONE && block.nodes[next].free) {
+		tlsfRemove(block, next);
+		block.nodes[index].size += block.nodes[next].size;
+		block.nodes[index].next_phys = block.nodes[next].next_phys;
+		if (block.nodes[index].next_phys != TLSF_NONE) {
+			block.nodes[block.nodes[index].next_phys].prev_phys = index;
 		}
-	}
 
-	if (gfx == std::numeric_limits<uint32_t>::max()) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find graphics queue family");
-		return 1;
+		block.unused_nodes.push_back(next);
 	}
-	if (prs == std::numeric_limits<uint32_t>::max()) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find present queue family");
-		return 1;
+
+	tlsfInsert(block, index);
+}
+
+static VkResult allocateDeviceMemory(VkDeviceSize size, uint32_t memory_type, VkDeviceMemory& memory, void*& mapped) {
+	if (vkstate.memory.device_allocation_count >= vkstate.physical.properties.limits.maxMemoryAllocationCount) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Reached maxMemoryAllocationCount");
+		return VK_ERROR_TOO_MANY_OBJECTS;
 	}
 
-	vkstate.queue_families = {
-		.graphics = gfx,
-		.present = prs,
+	VkMemoryAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.allocationSize = size,
+		.memoryTypeIndex = memory_type,
 	};
 
-	uint32_t queue_families[] = {
-		vkstate.queue_families.graphics,
-		vkstate.queue_families.present,
-	};
+	VkResult res = vkAllocateMemory(vkstate.device, &alloc_info, vkstate.allocator, &memory);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
 
-	float priority = 1.0f;
-	std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+	/* host coherent memory stays mapped for its whole lifetime so sub-allocations never map, unmap or flush */
+	mapped = nullptr;
+	VkMemoryPropertyFlags coherent = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	if ((vkstate.physical.memory_properties.memoryTypes[memory_type].propertyFlags & coherent) == coherent) {
+		res = vkMapMemory(vkstate.device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+		if (res != VK_SUCCESS) {
+			vkFreeMemory(vkstate.device, memory, vkstate.allocator);
+			return res;
+		}
+	}
 
-	for (size_t i = 0; i < 2; ++i) {
-		VkDeviceQueueCreateInfo qcreate_info;
-		for (size_t j = 0; j < queue_create_infos.size(); ++j) {
-			if (queue_create_infos[j].queueFamilyIndex == queue_families[i]) {
-				goto next;
-			}
+	++vkstate.memory.device_allocation_count;
+	return VK_SUCCESS;
+}
+
+static VkDeviceSize memoryBlockSize(uint32_t memory_type) {
+	uint32_t heap = vkstate.physical.memory_properties.memoryTypes[memory_type].heapIndex;
+	VkDeviceSize heap_size = vkstate.physical.memory_properties.memoryHeaps[heap].size;
+
+	/* small heaps (e.g. 256MiB BAR windows) should not be exhausted by a handful of mostly empty blocks */
+	VkDeviceSize size = GLVK_MEMORY_BLOCK_SIZE;
+	while (size > (static_cast<VkDeviceSize>(1) << 20) && size > heap_size / 8) {
+		size >>= 1;
+	}
+
+	return size;
+}
+
+/* sub-allocates memory of the given type that satisfies reqs, falling back to a dedicated allocation for large requests */
+static VkResult allocateMemory(const VkMemoryRequirements& reqs, uint32_t memory_type, allocation_t& allocation) {
+	VkDeviceSize block_size = memoryBlockSize(memory_type);
+	VkDeviceSize alignment = std::max<VkDeviceSize>(reqs.alignment, 1);
+
+	if (reqs.size > block_size / 2) {
+		VkDeviceMemory memory;
+		void* mapped;
+		VkResult res = allocateDeviceMemory(reqs.size, memory_type, memory, mapped);
+		if (res != VK_SUCCESS) {
+			return res;
 		}
 
-		qcreate_info = {
-			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			.pNext = nullptr,
-			.flags = 0,
-			.queueFamilyIndex = queue_families[i],
-			.queueCount = 1,
-			.pQueuePriorities = &priority,
+		allocation = {
+			.block = nullptr,
+			.node = TLSF_NONE,
+			.memory = memory,
+			.offset = 0,
+			.size = reqs.size,
+			.mapped = mapped,
 		};
 
-		queue_create_infos.push_back(qcreate_info);
-	next:;
+		++vkstate.memory.dedicated_count;
+		vkstate.memory.dedicated_bytes += reqs.size;
+		return VK_SUCCESS;
 	}
 
-	VkDeviceCreateInfo create_info = {
-		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-		.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size()),
-		.pQueueCreateInfos = queue_create_infos.data(),
-		.enabledLayerCount = static_cast<uint32_t>(device_layer_names.size()),
-		.ppEnabledLayerNames = device_layer_names.data(),
-		.enabledExtensionCount = static_cast<uint32_t>(device_extension_names.size()),
-		.ppEnabledExtensionNames = device_extension_names.data(),
-		.pEnabledFeatures = nullptr,
-	};
+	memblock_t* block = nullptr;
+	uint32_t node = TLSF_NONE;
+	for (std::unique_ptr<memblock_t>& candidate : vkstate.memory.blocks) {
+		if (candidate->memory_type != memory_type || candidate->size - candidate->used < reqs.size) {
+			continue;
+		}
 
-	if (vkCreateDevice(vkstate.physical.device, &create_info, vkstate.allocator, &vkstate.device) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan device");
-		return 1;
+		node = tlsfAllocate(*candidate, reqs.size, alignment);
+		if (node != TLSF_NONE) {
+			block = candidate.get();
+			break;
+		}
 	}
 
-	vkGetDeviceQueue(vkstate.device, vkstate.queue_families.graphics, 0, &vkstate.graphics_queue);
-	vkGetDeviceQueue(vkstate.device, vkstate.queue_families.present, 0, &vkstate.present_queue);
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vkstate.physical.device, vkstate.surface, &vkstate.surface_capabilities);
+	if (block == nullptr) {
+		std::unique_ptr<memblock_t> created = std::make_unique<memblock_t>();
+		VkResult res = allocateDeviceMemory(block_size, memory_type, created->memory, created->mapped);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
 
-	uint32_t surface_format_count = 0;
-	vkGetPhysicalDeviceSurfaceFormatsKHR(vkstate.physical.device, vkstate.surface, &surface_format_count, nullptr);
-	if (surface_format_count == 0) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find surface formats");
-		return 1;
-	}
+		created->memory_type = memory_type;
+		created->size = block_size;
+		created->used = 0;
+		created->allocation_count = 0;
+		created->fl_bitmap = 0;
+		memset(created->sl_bitmaps, 0, sizeof(created->sl_bitmaps));
+		memset(created->heads, 0xFF, sizeof(created->heads));
+		tlsfInsert(*created, tlsfNewNode(*created, 0, block_size));
 
-	std::vector<VkSurfaceFormatKHR> surface_formats(surface_format_count);
-	vkGetPhysicalDeviceSurfaceFormatsKHR(vkstate.physical.device, vkstate.surface, &surface_format_count, surface_formats.data());
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Created {} byte memory block for memory type {}", block_size, memory_type);
 
-	uint32_t surface_format_index = std::numeric_limits<uint32_t>::max();
-	for (size_t i = 0; i < surface_formats.size(); ++i) {
-		if (surface_formats[i].format == VK_FORMAT_B8G8R8A8_SRGB && surface_formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-			surface_format_index = i;
-			break;
+		block = created.get();
+		vkstate.memory.blocks.push_back(std::move(created));
+
+		node = tlsfAllocate(*block, reqs.size, alignment);
+		if (node == TLSF_NONE) {
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
 		}
 	}
 
-	if (surface_format_count == std::numeric_limits<uint32_t>::max()) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find surface format");
-		return 1;
+	tlsfnode_t& n = block->nodes[node];
+	block->used += n.size;
+	++block->allocation_count;
+
+	allocation = {
+		.block = block,
+		.node = node,
+		.memory = block->memory,
+		.offset = n.offset,
+		.size = reqs.size,
+		.mapped = (block->mapped == nullptr) ? nullptr : static_cast<uint8_t*>(block->mapped) + n.offset,
+	};
+
+	return VK_SUCCESS;
+}
+
+static void freeMemory(allocation_t& allocation) {
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
 	}
 
-	uint32_t surface_modes_count = 0;
-	vkGetPhysicalDeviceSurfacePresentModesKHR(vkstate.physical.device, vkstate.surface, &surface_modes_count, nullptr);
-	if (surface_modes_count == 0) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find surface present modes");
-		return 1;
+	if (allocation.block == nullptr) {
+		vkFreeMemory(vkstate.device, allocation.memory, vkstate.allocator);
+		--vkstate.memory.device_allocation_count;
+		--vkstate.memory.dedicated_count;
+		vkstate.memory.dedicated_bytes -= allocation.size;
+		allocation = {};
+		return;
 	}
 
-	std::vector<VkPresentModeKHR> surface_modes(surface_modes_count);
-	vkGetPhysicalDeviceSurfacePresentModesKHR(vkstate.physical.device, vkstate.surface, &surface_modes_count, surface_modes.data());
+	memblock_t* block = allocation.block;
+	block->used -= block->nodes[allocation.node].size;
+	--block->allocation_count;
+	tlsfFree(*block, allocation.node);
+	allocation = {};
 
-	uint32_t surface_mode_index = std::numeric_limits<uint32_t>::max();
-	for (size_t i = 0; i < surface_modes.size(); ++i) {
-		if (surface_modes[i] == VK_PRESENT_MODE_FIFO_KHR) {
-			surface_mode_index = i;
-		}
-		if (surface_modes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
-			surface_mode_index = i;
-			break;
+	if (block->allocation_count != 0) {
+		return;
+	}
+
+	/* keep one empty block per memory type around so alternating alloc/free does not thrash vkAllocateMemory */
+	for (std::unique_ptr<memblock_t>& other : vkstate.memory.blocks) {
+		if (other.get() != block && other->memory_type == block->memory_type && other->allocation_count == 0) {
+			for (size_t i = 0; i < vkstate.memory.blocks.size(); ++i) {
+				if (vkstate.memory.blocks[i].get() == block) {
+					vkFreeMemory(vkstate.device, block->memory, vkstate.allocator);
+					--vkstate.memory.device_allocation_count;
+					vkstate.memory.blocks.erase(vkstate.memory.blocks.begin() + i);
+					break;
+				}
+			}
+			return;
 		}
 	}
+}
 
-	if (surface_mode_index == std::numeric_limits<uint32_t>::max()) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find surface present mode");
-		return 1;
+/* returns a memory type with all required flags, preferring one that also has the preferred flags */
+static uint32_t findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+	uint32_t fallback = std::numeric_limits<uint32_t>::max();
+	for (uint32_t i = 0; i < vkstate.physical.memory_properties.memoryTypeCount; ++i) {
+		VkMemoryPropertyFlags flags = vkstate.physical.memory_properties.memoryTypes[i].propertyFlags;
+		if (!(type_bits & (1 << i)) || (flags & required) != required) {
+			continue;
+		}
+
+		if ((flags & preferred) == preferred) {
+			return i;
+		}
+
+		if (fallback == std::numeric_limits<uint32_t>::max()) {
+			fallback = i;
+		}
 	}
 
-	vkstate.surface_format = surface_formats[surface_format_index];
-	vkstate.surface_mode = surface_modes[surface_mode_index];
-	vkstate.extent = vkstate.surface_capabilities.currentExtent;
+	return fallback;
+}
 
-	VkSwapchainCreateInfoKHR swapchain_create_info = {
-		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+static VkResult createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkBuffer& buffer, allocation_t& memory) {
+	VkBufferCreateInfo buffer_create_info = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.surface = vkstate.surface,
-		.minImageCount = vkstate.surface_capabilities.minImageCount,
-		.imageFormat = vkstate.surface_format.format,
-		.imageColorSpace = vkstate.surface_format.colorSpace,
-		.imageExtent = vkstate.extent,
-		.imageArrayLayers = 1,
-		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.size = size,
+		.usage = usage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
 		.queueFamilyIndexCount = 0,
 		.pQueueFamilyIndices = nullptr,
-		.preTransform = vkstate.surface_capabilities.currentTransform,
-		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-		.presentMode = vkstate.surface_mode,
-		.clipped = VK_TRUE,
-		.oldSwapchain = VK_NULL_HANDLE,
 	};
 
-	uint32_t indices[2] = { vkstate.queue_families.graphics, vkstate.queue_families.present };
-	if (vkstate.queue_families.graphics != vkstate.queue_families.present) {
-		swapchain_create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-		swapchain_create_info.queueFamilyIndexCount = 2;
-		swapchain_create_info.pQueueFamilyIndices = indices;
+	VkResult res = vkCreateBuffer(vkstate.device, &buffer_create_info, vkstate.allocator, &buffer);
+	if (res != VK_SUCCESS) {
+		return res;
 	}
 
-	VkResult res = vkCreateSwapchainKHR(vkstate.device, &swapchain_create_info, vkstate.allocator, &vkstate.swapchain);
+	VkMemoryRequirements reqs;
+	vkGetBufferMemoryRequirements(vkstate.device, buffer, &reqs);
+
+	uint32_t memory_type = findMemoryType(reqs.memoryTypeBits, required, preferred);
+	if (memory_type == std::numeric_limits<uint32_t>::max()) {
+		vkDestroyBuffer(vkstate.device, buffer, vkstate.allocator);
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+
+	res = allocateMemory(reqs, memory_type, memory);
 	if (res != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan swapchain");
-		return 1;
+		vkDestroyBuffer(vkstate.device, buffer, vkstate.allocator);
+		return res;
 	}
 
-	vkGetSwapchainImagesKHR(vkstate.device, vkstate.swapchain, &vkstate.swapchain_image_count, nullptr);
-	vkstate.swapchain_images.resize(vkstate.swapchain_image_count);
-	vkGetSwapchainImagesKHR(vkstate.device, vkstate.swapchain, &vkstate.swapchain_image_count, vkstate.swapchain_images.data());
+	res = vkBindBufferMemory(vkstate.device, buffer, memory.memory, memory.offset);
+	if (res != VK_SUCCESS) {
+		freeMemory(memory);
+		vkDestroyBuffer(vkstate.device, buffer, vkstate.allocator);
+		return res;
+	}
 
-	vkstate.swapchain_views.resize(vkstate.swapchain_image_count);
-	for (size_t i = 0; i < vkstate.swapchain_image_count; ++i) {
-		VkImageViewCreateInfo view_create_info = {
-			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-			.pNext = nullptr,
-			.flags = 0,
-			.image = vkstate.swapchain_images[i],
-			.viewType = VK_IMAGE_VIEW_TYPE_2D,
-			.format = vkstate.surface_format.format,
-			.components = {
-				.r = VK_COMPONENT_SWIZZLE_IDENTITY,
-				.g = VK_COMPONENT_SWIZZLE_IDENTITY,
-				.b = VK_COMPONENT_SWIZZLE_IDENTITY,
-				.a = VK_COMPONENT_SWIZZLE_IDENTITY,
-			},
-			.subresourceRange = {
-				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-				.baseMipLevel = 0,
-				.levelCount = 1,
-				.baseArrayLayer = 0,
-				.layerCount = 1,
-			},
-		};
+	return VK_SUCCESS;
+}
 
-		vkCreateImageView(vkstate.device, &view_create_info, vkstate.allocator, &vkstate.swapchain_views[i]);
+/* creates an image in device local memory. blocks are shared with buffers, so optimal tiling images are padded out to
+ * bufferImageGranularity on both ends and never share a granularity page with a linear resource */
+static VkResult createImage(const VkImageCreateInfo& create_info, VkImage& image, allocation_t& memory) {
+	VkResult res = vkCreateImage(vkstate.device, &create_info, vkstate.allocator, &image);
+	if (res != VK_SUCCESS) {
+		return res;
 	}
 
-	VkAttachmentDescription color_attachment = {
-		.flags = 0,
-		.format = vkstate.surface_format.format,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-	};
+	VkMemoryRequirements reqs;
+	vkGetImageMemoryRequirements(vkstate.device, image, &reqs);
 
-	VkAttachmentReference color_reference = {
-		.attachment = 0,
-		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	if (create_info.tiling == VK_IMAGE_TILING_OPTIMAL) {
+		VkDeviceSize granularity = vkstate.physical.properties.limits.bufferImageGranularity;
+		reqs.alignment = std::max(reqs.alignment, granularity);
+		reqs.size = (reqs.size + granularity - 1) & ~(granularity - 1);
+	}
+
+	uint32_t memory_type = findMemoryType(reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+	if (memory_type == std::numeric_limits<uint32_t>::max()) {
+		vkDestroyImage(vkstate.device, image, vkstate.allocator);
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+
+	res = allocateMemory(reqs, memory_type, memory);
+	if (res != VK_SUCCESS) {
+		vkDestroyImage(vkstate.device, image, vkstate.allocator);
+		return res;
+	}
+
+	res = vkBindImageMemory(vkstate.device, image, memory.memory, memory.offset);
+	if (res != VK_SUCCESS) {
+		freeMemory(memory);
+		vkDestroyImage(vkstate.device, image, vkstate.allocator);
+		return res;
+	}
+
+	return VK_SUCCESS;
+}
+
+/* picks a placement from a glBufferData usage hint:
+ * static and copy data lives in device local memory and is uploaded through the staging ring,
+ * stream and dynamic draw data is written by the cpu in place, preferably in device local host visible (ReBAR) memory,
+ * read data is host visible and preferably cached for readback */
+static bufferplacement_t bufferPlacement(GLenum usage) {
+	if (usage == GL_STREAM_DRAW || usage == GL_DYNAMIC_DRAW) {
+		return BUFFER_PLACEMENT_UPLOAD;
+	} else if (usage == GL_STREAM_READ || usage == GL_STATIC_READ || usage == GL_DYNAMIC_READ) {
+		return BUFFER_PLACEMENT_READBACK;
+	}
+
+	return BUFFER_PLACEMENT_DEVICE;
+}
+
+static void placementFlags(bufferplacement_t placement, VkMemoryPropertyFlags& required, VkMemoryPropertyFlags& preferred) {
+	if (placement == BUFFER_PLACEMENT_UPLOAD) {
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	} else if (placement == BUFFER_PLACEMENT_READBACK) {
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	} else {
+		required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		preferred = 0;
+	}
+}
+
+/* rounds a buffer size up to a quarter-octave size class, wasting at most a quarter of the store */
+static VkDeviceSize bufferSizeClass(VkDeviceSize size) {
+	if (size <= 256) {
+		return 256;
+	}
+
+	VkDeviceSize step = std::bit_floor(size) >> 2;
+	return (size + step - 1) & ~(step - 1);
+}
+
+static uint64_t bufferPoolKey(VkDeviceSize capacity, bufferplacement_t placement) {
+	return (capacity << 2) | static_cast<uint64_t>(placement);
+}
+
+static void writeDescriptor(descriptortype_t type, uint32_t slot, const descriptorkey_t& key) {
+	VkDescriptorBufferInfo buffer_info = {
+		.buffer = reinterpret_cast<VkBuffer>(key.handle),
+		.offset = key.offset,
+		.range = key.range,
 	};
 
-	VkSubpassDescription subpass = {
-		.flags = 0,
-		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-		.inputAttachmentCount = 0,
-		.pInputAttachments = nullptr,
-		.colorAttachmentCount = 1,
-		.pColorAttachments = &color_reference,
-		.pResolveAttachments = nullptr,
-		.pDepthStencilAttachment = nullptr,
-		.preserveAttachmentCount = 0,
-		.pPreserveAttachments = nullptr,
+	VkDescriptorImageInfo image_info = {
+		.sampler = reinterpret_cast<VkSampler>(key.offset),
+		.imageView = reinterpret_cast<VkImageView>(key.handle),
+		.imageLayout = static_cast<VkImageLayout>(key.range),
 	};
 
-	VkSubpassDependency subpass_dependency = {
-		.srcSubpass = VK_SUBPASS_EXTERNAL,
-		.dstSubpass = 0,
-		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.srcAccessMask = 0,
-		.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		.dependencyFlags = 0,
+	VkDescriptorType descriptor_types[DESCRIPTOR_TYPE_COUNT] = {
+		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 	};
 
-	VkRenderPassCreateInfo render_pass_create_info = {
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+	VkWriteDescriptorSet write = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
 		.pNext = nullptr,
-		.flags = 0,
-		.attachmentCount = 1,
-		.pAttachments = &color_attachment,
-		.subpassCount = 1,
-		.pSubpasses = &subpass,
-		.dependencyCount = 1,
-		.pDependencies = &subpass_dependency,
+		.dstSet = vkstate.bindless.set,
+		.dstBinding = static_cast<uint32_t>(type),
+		.dstArrayElement = slot,
+		.descriptorCount = 1,
+		.descriptorType = descriptor_types[type],
+		.pImageInfo = (type == DESCRIPTOR_TEXTURE) ? &image_info : nullptr,
+		.pBufferInfo = (type == DESCRIPTOR_TEXTURE) ? nullptr : &buffer_info,
+		.pTexelBufferView = nullptr,
 	};
 
-	vkCreateRenderPass(vkstate.device, &render_pass_create_info, vkstate.allocator, &vkstate.render_pass);
+	vkUpdateDescriptorSets(vkstate.device, 1, &write, 0, nullptr);
+}
 
-	vkstate.framebuffers.resize(vkstate.swapchain_image_count);
-	for (size_t i = 0; i < vkstate.swapchain_image_count; ++i) {
-		VkFramebufferCreateInfo framebuffer_create_info = {
-			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-			.pNext = nullptr,
-			.flags = 0,
-			.renderPass = vkstate.render_pass,
-			.attachmentCount = 1,
-			.pAttachments = &vkstate.swapchain_views[i],
-			.width = vkstate.extent.width,
-			.height = vkstate.extent.height,
-			.layers = 1,
-		};
+static void releaseDescriptor(descriptortype_t type, uint32_t slot) {
+	descriptorarray_t& array = vkstate.bindless.arrays[type];
+	descriptorslot_t& entry = array.slots[slot];
+	array.lookup.erase(entry.key);
+	entry.used = false;
 
-		vkCreateFramebuffer(vkstate.device, &framebuffer_create_info, vkstate.allocator, &vkstate.framebuffers[i]);
+	auto it = vkstate.bindless.handle_slots.find(entry.key.handle);
+	if (it == vkstate.bindless.handle_slots.end()) {
+		return;
 	}
-	
-	std::ifstream vshader_file("assets/shaders/vert.spv", std::ios::ate | std::ios::binary);
-	std::ifstream fshader_file("assets/shaders/frag.spv", std::ios::ate | std::ios::binary);
-	if (!vshader_file.is_open()) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to open assets/shaders/vert.spv");
-		return 1;
+
+	std::vector<uint32_t>& packed = it->second;
+	uint32_t value = (static_cast<uint32_t>(type) << GLVK_DESCRIPTOR_SLOT_BITS) | slot;
+	auto entry_it = std::find(packed.begin(), packed.end(), value);
+	if (entry_it != packed.end()) {
+		*entry_it = packed.back();
+		packed.pop_back();
 	}
-	if (!fshader_file.is_open()) {
-		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to open assets/shaders/frag.spv");
-		return 1;
+
+	if (packed.empty()) {
+		vkstate.bindless.handle_slots.erase(it);
 	}
+}
 
-	size_t size = vshader_file.tellg();
-	std::vector<uint8_t> v_spv(size);
-	vshader_file.seekg(0);
-	vshader_file.read(reinterpret_cast<char*>(v_spv.data()), size);
-	vshader_file.close();
+/* releases the descriptors of a buffer or image view that is being destroyed, which no frame in flight uses anymore */
+static void releaseDescriptors(uint64_t handle) {
+	auto it = vkstate.bindless.handle_slots.find(handle);
+	if (it == vkstate.bindless.handle_slots.end()) {
+		return;
+	}
 
-	size = fshader_file.tellg();
-	std::vector<uint8_t> f_spv(size);
-	fshader_file.seekg(0);
-	fshader_file.read(reinterpret_cast<char*>(f_spv.data()), size);
-	fshader_file.close();
+	std::vector<uint32_t> packed = std::move(it->second);
+	vkstate.bindless.handle_slots.erase(it);
+	for (uint32_t value : packed) {
+		descriptorarray_t& array = vkstate.bindless.arrays[value >> GLVK_DESCRIPTOR_SLOT_BITS];
+		descriptorslot_t& entry = array.slots[value & ((1u << GLVK_DESCRIPTOR_SLOT_BITS) - 1)];
+		array.lookup.erase(entry.key);
+		entry.used = false;
+	}
+}
 
-	VkShaderModuleCreateInfo vshader_create_info = {
-		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+/* returns the slot of the type's array pointing at key, writing a new one on a miss.
+ * GLVK_NO_DESCRIPTOR when every slot is still used by a frame in flight */
+static uint32_t acquireDescriptor(descriptortype_t type, const descriptorkey_t& key) {
+	descriptorarray_t& array = vkstate.bindless.arrays[type];
+	auto it = array.lookup.find(key);
+	if (it != array.lookup.end()) {
+		return it->second;
+	}
+
+	uint32_t slot = GLVK_NO_DESCRIPTOR;
+	if (array.slots.size() < array.capacity) {
+		slot = static_cast<uint32_t>(array.slots.size());
+		array.slots.push_back({});
+	} else {
+		/* released slots may still be read by frames in flight as well, so they are found by the same sweep */
+		for (uint32_t i = 0; i < array.capacity; ++i) {
+			uint32_t candidate = array.clock;
+			array.clock = (array.clock + 1) % array.capacity;
+			if (array.slots[candidate].last_use <= vkstate.completed_frame) {
+				if (array.slots[candidate].used) {
+					releaseDescriptor(type, candidate);
+				}
+				slot = candidate;
+				break;
+			}
+		}
+
+		if (slot == GLVK_NO_DESCRIPTOR) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Ran out of bindless descriptors, the binding is ignored");
+			return GLVK_NO_DESCRIPTOR;
+		}
+	}
+
+	array.slots[slot] = {
+		.key = key,
+		.last_use = 0,
+		.used = true,
+	};
+	array.lookup.emplace(key, slot);
+	vkstate.bindless.handle_slots[key.handle].push_back((static_cast<uint32_t>(type) << GLVK_DESCRIPTOR_SLOT_BITS) | slot);
+	writeDescriptor(type, slot, key);
+
+	return slot;
+}
+
+static void destroyBufferStore(bufferstore_t& store) {
+	if (store.buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	releaseDescriptors(reinterpret_cast<uint64_t>(store.buffer));
+	vkDestroyBuffer(vkstate.device, store.buffer, vkstate.allocator);
+	freeMemory(store.memory);
+	store.buffer = VK_NULL_HANDLE;
+}
+
+static void destroyImageStore(imagestore_t& store) {
+	if (store.image == VK_NULL_HANDLE) {
+		return;
+	}
+
+	releaseDescriptors(reinterpret_cast<uint64_t>(store.view));
+	vkDestroyImageView(vkstate.device, store.view, vkstate.allocator);
+	vkDestroyImage(vkstate.device, store.image, vkstate.allocator);
+	freeMemory(store.memory);
+	store.image = VK_NULL_HANDLE;
+	store.view = VK_NULL_HANDLE;
+}
+
+/* destroys a sampler no frame in flight draws with, together with the descriptors pairing it with an image view */
+static void destroySampler(VkSampler sampler) {
+	descriptorarray_t& array = vkstate.bindless.arrays[DESCRIPTOR_TEXTURE];
+	for (uint32_t slot = 0; slot < array.slots.size(); ++slot) {
+		if (array.slots[slot].used && array.slots[slot].key.offset == reinterpret_cast<uint64_t>(sampler)) {
+			releaseDescriptor(DESCRIPTOR_TEXTURE, slot);
+		}
+	}
+
+	vkDestroySampler(vkstate.device, sampler, vkstate.allocator);
+}
+
+/* returns a store the gpu is done with to the pool */
+static void recycleBufferStore(bufferstore_t& store) {
+	store.last_use = vkstate.frame_number;
+	vkstate.buffer_pool[bufferPoolKey(store.capacity, store.placement)].push_back(store);
+	store.buffer = VK_NULL_HANDLE;
+}
+
+/* destroys pooled stores that have not been reused for GLVK_BUFFER_POOL_FRAMES frames */
+static void trimBufferPool() {
+	for (auto it = vkstate.buffer_pool.begin(); it != vkstate.buffer_pool.end();) {
+		std::vector<bufferstore_t>& stores = it->second;
+
+		size_t expired = 0;
+		while (expired < stores.size() && stores[expired].last_use + GLVK_BUFFER_POOL_FRAMES < vkstate.frame_number) {
+			destroyBufferStore(stores[expired]);
+			++expired;
+		}
+		stores.erase(stores.begin(), stores.begin() + expired);
+
+		if (stores.empty()) {
+			it = vkstate.buffer_pool.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+static void destroyMemoryBlocks() {
+	for (std::unique_ptr<memblock_t>& block : vkstate.memory.blocks) {
+		if (block->allocation_count != 0) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Memory block destroyed with {} live allocations", block->allocation_count);
+		}
+		vkFreeMemory(vkstate.device, block->memory, vkstate.allocator);
+	}
+
+	vkstate.memory.blocks.clear();
+	vkstate.memory.device_allocation_count = 0;
+}
+
+void glvkGetMemoryStats(GLVKmemorystats* stats) {
+	GLVK_SYNC();
+	if (stats == nullptr) {
+		return;
+	}
+
+	*stats = {
+		.block_count = static_cast<unsigned int>(vkstate.memory.blocks.size()),
+		.dedicated_count = vkstate.memory.dedicated_count,
+		.allocation_count = vkstate.memory.dedicated_count,
+		.reserved_bytes = vkstate.memory.dedicated_bytes,
+		.used_bytes = vkstate.memory.dedicated_bytes,
+		.largest_free_bytes = 0,
+		.fragmentation = 0.0f,
+	};
+
+	VkDeviceSize total_free = 0;
+	for (std::unique_ptr<memblock_t>& block : vkstate.memory.blocks) {
+		stats->allocation_count += block->allocation_count;
+		stats->reserved_bytes += block->size;
+		stats->used_bytes += block->used;
+
+		for (tlsfnode_t& node : block->nodes) {
+			if (!node.free) {
+				continue;
+			}
+
+			total_free += node.size;
+			if (node.size > stats->largest_free_bytes) {
+				stats->largest_free_bytes = node.size;
+			}
+		}
+	}
+
+	if (total_free != 0) {
+		stats->fragmentation = 1.0f - static_cast<float>(stats->largest_free_bytes) / static_cast<float>(total_free);
+	}
+}
+
+/* depth only formats, D16 is always supported as a depth attachment */
+static VkFormat findDepthFormat() {
+	VkFormat candidates[] = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_X8_D24_UNORM_PACK32,
+		VK_FORMAT_D16_UNORM,
+	};
+
+	for (VkFormat format : candidates) {
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(vkstate.physical.device, format, &props);
+		if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+			return format;
+		}
+	}
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+/* creates a 2D render target with one mip level and sample, and its view, in device local memory */
+static VkResult createAttachment(GLVKvkattachment& attachment, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, uint32_t width, uint32_t height) {
+	VkImageCreateInfo image_create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.codeSize = v_spv.size(),
-		.pCode = reinterpret_cast<const uint32_t*>(v_spv.data()),
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = format,
+		.extent = {
+			.width = width,
+			.height = height,
+			.depth = 1,
+		},
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = usage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
 	};
 
-	if (vkCreateShaderModule(vkstate.device, &vshader_create_info, vkstate.allocator, &vkstate.vshader) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create vertex shader module");
-		return 1;
+	attachment.format = format;
+	VkResult res = createImage(image_create_info, attachment.image, attachment.memory);
+	if (res != VK_SUCCESS) {
+		return res;
 	}
 
-	VkShaderModuleCreateInfo fshader_create_info = {
-		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+	VkImageViewCreateInfo view_create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.codeSize = f_spv.size(),
-		.pCode = reinterpret_cast<const uint32_t*>(f_spv.data()),
+		.image = attachment.image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = format,
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+		},
+		.subresourceRange = {
+			.aspectMask = aspect,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
 	};
 
-	if (vkCreateShaderModule(vkstate.device, &fshader_create_info, vkstate.allocator, &vkstate.fshader) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create fragment shader module");
-		return 1;
+	return vkCreateImageView(vkstate.device, &view_create_info, vkstate.allocator, &attachment.view);
+}
+
+static VkResult createDepthTarget() {
+	return createAttachment(vkstate.depth, vkstate.depth.format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, vkstate.extent.width, vkstate.extent.height);
+}
+
+static void destroyAttachment(GLVKvkattachment& attachment) {
+	vkDestroyImageView(vkstate.device, attachment.view, vkstate.allocator);
+	vkDestroyImage(vkstate.device, attachment.image, vkstate.allocator);
+	freeMemory(attachment.memory);
+	attachment.view = VK_NULL_HANDLE;
+	attachment.image = VK_NULL_HANDLE;
+}
+
+/* layout the render passes leave the color buffer in at the end of a frame, offscreen images are left ready to be copied out */
+static VkImageLayout colorLayout() {
+	return vkstate.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+/* returns VK_BLEND_FACTOR_MAX_ENUM for enums that are not blend factors */
+static VkBlendFactor blendFactor(GLenum factor) {
+	switch (factor) {
+		case GL_ZERO: return VK_BLEND_FACTOR_ZERO;
+		case GL_ONE: return VK_BLEND_FACTOR_ONE;
+		case GL_SRC_COLOR: return VK_BLEND_FACTOR_SRC_COLOR;
+		case GL_ONE_MINUS_SRC_COLOR: return VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+		case GL_DST_COLOR: return VK_BLEND_FACTOR_DST_COLOR;
+		case GL_ONE_MINUS_DST_COLOR: return VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR;
+		case GL_SRC_ALPHA: return VK_BLEND_FACTOR_SRC_ALPHA;
+		case GL_ONE_MINUS_SRC_ALPHA: return VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		case GL_DST_ALPHA: return VK_BLEND_FACTOR_DST_ALPHA;
+		case GL_ONE_MINUS_DST_ALPHA: return VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+		case GL_CONSTANT_COLOR: return VK_BLEND_FACTOR_CONSTANT_COLOR;
+		case GL_ONE_MINUS_CONSTANT_COLOR: return VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_COLOR;
+		case GL_CONSTANT_ALPHA: return VK_BLEND_FACTOR_CONSTANT_ALPHA;
+		case GL_ONE_MINUS_CONSTANT_ALPHA: return VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_ALPHA;
+		case GL_SRC_ALPHA_SATURATE: return VK_BLEND_FACTOR_SRC_ALPHA_SATURATE;
+	}
+
+	return VK_BLEND_FACTOR_MAX_ENUM;
+}
+
+/* returns VK_BLEND_OP_MAX_ENUM for enums that are not blend equations */
+static VkBlendOp blendOp(GLenum equation) {
+	switch (equation) {
+		case GL_FUNC_ADD: return VK_BLEND_OP_ADD;
+		case GL_FUNC_SUBTRACT: return VK_BLEND_OP_SUBTRACT;
+		case GL_FUNC_REVERSE_SUBTRACT: return VK_BLEND_OP_REVERSE_SUBTRACT;
+		case GL_MIN: return VK_BLEND_OP_MIN;
+		case GL_MAX: return VK_BLEND_OP_MAX;
+	}
+
+	return VK_BLEND_OP_MAX_ENUM;
+}
+
+/* maps a draw mode to a topology, pushing the gl error and returning false for modes that cannot be drawn */
+static bool drawTopology(GLenum mode, VkPrimitiveTopology& topology) {
+	switch (mode) {
+		case GL_POINTS: topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST; return true;
+		case GL_LINES: topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST; return true;
+		case GL_LINE_STRIP: topology = VK_PRIMITIVE_TOPOLOGY_LINE_STRIP; return true;
+		/* drawn as a strip through indices that come back to the first vertex, see lineLoopIndices */
+		case GL_LINE_LOOP: topology = VK_PRIMITIVE_TOPOLOGY_LINE_STRIP; return true;
+		case GL_TRIANGLES: topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; return true;
+		case GL_TRIANGLE_STRIP: topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP; return true;
+		case GL_TRIANGLE_FAN: topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN; return true;
+	}
+
+	if (vkstate.features.geometryShader) {
+		switch (mode) {
+			case GL_LINES_ADJACENCY: topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY; return true;
+			case GL_LINE_STRIP_ADJACENCY: topology = VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY; return true;
+			case GL_TRIANGLES_ADJACENCY: topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST_WITH_ADJACENCY; return true;
+			case GL_TRIANGLE_STRIP_ADJACENCY: topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP_WITH_ADJACENCY; return true;
+		}
+	}
+
+	if (mode == GL_PATCHES) {
+		/* there are no tessellation shaders to consume patches */
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return false;
+	}
+
+	GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Draw mode {} is not supported", mode);
+	GLPUSHERROR(GL_INVALID_ENUM);
+	return false;
+}
+
+/* builds the pipeline key for a draw from the current gl state */
+static pipelinekey_t pipelineKey(VkPrimitiveTopology topology) {
+	const GLVKglraster& raster = glstate.raster;
+
+	pipelinekey_t key;
+	memset(&key, 0, sizeof(key));
+	key.render_pass = vkstate.render_pass;
+	const glprogram_t* program = glstate.programs.get(glstate.program);
+	key.program = (program != nullptr) ? program->link : 0;
+	key.topology = static_cast<uint8_t>(topology);
+	key.vertex_layout = vkstate.vertex_input_dynamic ? 0 : glstate.vertex_layout;
+
+	/* list topologies cannot restart without an extension and gain nothing from it */
+	key.primitive_restart = raster.primitive_restart && (
+		topology == VK_PRIMITIVE_TOPOLOGY_LINE_STRIP ||
+		topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP ||
+		topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN ||
+		topology == VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY ||
+		topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP_WITH_ADJACENCY
+	);
+
+	key.polygon_mode = VK_POLYGON_MODE_FILL;
+	if (vkstate.features.fillModeNonSolid) {
+		if (raster.polygon_mode == GL_LINE) {
+			key.polygon_mode = VK_POLYGON_MODE_LINE;
+		} else if (raster.polygon_mode == GL_POINT) {
+			key.polygon_mode = VK_POLYGON_MODE_POINT;
+		}
+	}
+
+	key.cull_mode = VK_CULL_MODE_NONE;
+	if (raster.cull_face) {
+		key.cull_mode = (raster.cull_mode == GL_FRONT) ? VK_CULL_MODE_FRONT_BIT : (raster.cull_mode == GL_BACK) ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_FRONT_AND_BACK;
+	}
+
+	/* the viewport is not flipped, so gl's counter-clockwise winding is clockwise in vulkan framebuffer coordinates */
+	key.front_face = (raster.front_face == GL_CCW) ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	key.rasterizer_discard = raster.rasterizer_discard;
+
+	/* gl disables depth writes together with the depth test */
+	key.depth_test = raster.depth_test;
+	key.depth_write = raster.depth_test && raster.depth_write;
+	key.depth_compare = raster.depth_test ? static_cast<uint8_t>(raster.depth_func - GL_NEVER) : 0;
+
+	/* the blend factors of a disabled blend are ignored, leaving them out keeps them from splitting the cache */
+	key.blend = raster.blend;
+	if (raster.blend) {
+		key.src_color_factor = static_cast<uint8_t>(blendFactor(raster.blend_src_rgb));
+		key.dst_color_factor = static_cast<uint8_t>(blendFactor(raster.blend_dst_rgb));
+		key.color_op = static_cast<uint8_t>(blendOp(raster.blend_equation_rgb));
+		key.src_alpha_factor = static_cast<uint8_t>(blendFactor(raster.blend_src_alpha));
+		key.dst_alpha_factor = static_cast<uint8_t>(blendFactor(raster.blend_dst_alpha));
+		key.alpha_op = static_cast<uint8_t>(blendOp(raster.blend_equation_alpha));
+	}
+
+	key.color_write_mask =
+		(raster.color_mask[0] ? VK_COLOR_COMPONENT_R_BIT : 0) |
+		(raster.color_mask[1] ? VK_COLOR_COMPONENT_G_BIT : 0) |
+		(raster.color_mask[2] ? VK_COLOR_COMPONENT_B_BIT : 0) |
+		(raster.color_mask[3] ? VK_COLOR_COMPONENT_A_BIT : 0);
+
+	return key;
+}
+
+static VkPipeline createPipeline(const pipelinekey_t& key) {
+	programmodules_t modules = { .vertex = vkstate.vshader, .fragment = vkstate.fshader };
+	if (key.program != 0) {
+		auto it = vkstate.shaders.programs.find(key.program);
+		if (it == vkstate.shaders.programs.end()) {
+			return VK_NULL_HANDLE;
+		}
+		modules = it->second;
 	}
 
 	VkPipelineShaderStageCreateInfo shader_stage_create_infos[2] = {
@@ -863,7 +2329,7 @@ int glvkInit(GLVKwindow window) {
 			.pNext = nullptr,
 			.flags = 0,
 			.stage = VK_SHADER_STAGE_VERTEX_BIT,
-			.module = vkstate.vshader,
+			.module = modules.vertex,
 			.pName = "main",
 			.pSpecializationInfo = nullptr,
 		},
@@ -872,72 +2338,46 @@ int glvkInit(GLVKwindow window) {
 			.pNext = nullptr,
 			.flags = 0,
 			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-			.module = vkstate.fshader,
+			.module = modules.fragment,
 			.pName = "main",
 			.pSpecializationInfo = nullptr,
 		},
 	};
 
-	VkDynamicState dynamic_states[2] = {
+	VkDynamicState dynamic_states[4] = {
 		VK_DYNAMIC_STATE_VIEWPORT,
 		VK_DYNAMIC_STATE_SCISSOR,
+		VK_DYNAMIC_STATE_BLEND_CONSTANTS,
+		VK_DYNAMIC_STATE_VERTEX_INPUT_EXT,
 	};
 
 	VkPipelineDynamicStateCreateInfo pipeline_ds_create_info = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.dynamicStateCount = 2,
+		.dynamicStateCount = vkstate.vertex_input_dynamic ? 4u : 3u,
 		.pDynamicStates = dynamic_states,
 	};
 
-	/*
-	VkVertexInputBindingDescription vinput_binding_desc = {
-		.binding = 0,
-		.stride = sizeof(vertex_t),
-		.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
-	};
-
-	VkVertexInputAttributeDescription vinput_attr_desc[1] = {
-		{
-			.location = 0,
-			.binding = 0,
-			.format = VK_FORMAT_R32G32B32_SFLOAT,
-			.offset = offsetof(vertex_t, pos),
-		},
-	};
-	*/
+	/* with dynamic vertex input the layout is set by the draw, otherwise it is part of the key */
+	const vertexlayout_t& layout = vkstate.vertex_layouts[vkstate.vertex_layout_lookup[key.vertex_layout]];
 
 	VkPipelineVertexInputStateCreateInfo pipeline_vinput_state_create_info = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.vertexBindingDescriptionCount = 0,
-		.pVertexBindingDescriptions = nullptr,
-		.vertexAttributeDescriptionCount = 0,
-		.pVertexAttributeDescriptions = nullptr,
+		.vertexBindingDescriptionCount = layout.binding_count,
+		.pVertexBindingDescriptions = layout.bindings,
+		.vertexAttributeDescriptionCount = layout.attribute_count,
+		.pVertexAttributeDescriptions = layout.attributes,
 	};
 
 	VkPipelineInputAssemblyStateCreateInfo pipeline_ia_state_create_info = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-		.primitiveRestartEnable = VK_FALSE,
-	};
-
-	vkstate.viewport = {
-		.x = 0,
-		.y = 0,
-		.width = static_cast<float>(vkstate.extent.width),
-		.height = static_cast<float>(vkstate.extent.height),
-		.minDepth = 0,
-		.maxDepth = 1,
-	};
-
-	vkstate.scissor = {
-		.offset = { 0, 0 },
-		.extent = vkstate.extent,
+		.topology = static_cast<VkPrimitiveTopology>(key.topology),
+		.primitiveRestartEnable = key.primitive_restart ? VK_TRUE : VK_FALSE,
 	};
 
 	VkPipelineViewportStateCreateInfo pipeline_viewport_state_create_info = {
@@ -945,9 +2385,9 @@ int glvkInit(GLVKwindow window) {
 		.pNext = nullptr,
 		.flags = 0,
 		.viewportCount = 1,
-		.pViewports = &vkstate.viewport,
+		.pViewports = nullptr,
 		.scissorCount = 1,
-		.pScissors = &vkstate.scissor,
+		.pScissors = nullptr,
 	};
 
 	VkPipelineRasterizationStateCreateInfo pipeline_rast_state_create_info = {
@@ -955,10 +2395,10 @@ int glvkInit(GLVKwindow window) {
 		.pNext = nullptr,
 		.flags = 0,
 		.depthClampEnable = VK_FALSE,
-		.rasterizerDiscardEnable = VK_FALSE,
-		.polygonMode = VK_POLYGON_MODE_FILL,
-		.cullMode = VK_CULL_MODE_NONE,
-		.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+		.rasterizerDiscardEnable = key.rasterizer_discard ? VK_TRUE : VK_FALSE,
+		.polygonMode = static_cast<VkPolygonMode>(key.polygon_mode),
+		.cullMode = key.cull_mode,
+		.frontFace = static_cast<VkFrontFace>(key.front_face),
 		.depthBiasEnable = VK_FALSE,
 		.depthBiasConstantFactor = 0,
 		.depthBiasClamp = 0,
@@ -978,15 +2418,30 @@ int glvkInit(GLVKwindow window) {
 		.alphaToOneEnable = VK_FALSE,
 	};
 
+	VkPipelineDepthStencilStateCreateInfo pipeline_depth_state_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.depthTestEnable = key.depth_test ? VK_TRUE : VK_FALSE,
+		.depthWriteEnable = key.depth_write ? VK_TRUE : VK_FALSE,
+		.depthCompareOp = static_cast<VkCompareOp>(key.depth_compare),
+		.depthBoundsTestEnable = VK_FALSE,
+		.stencilTestEnable = VK_FALSE,
+		.front = {},
+		.back = {},
+		.minDepthBounds = 0,
+		.maxDepthBounds = 1,
+	};
+
 	VkPipelineColorBlendAttachmentState pipeline_cba_state = {
-		.blendEnable = VK_FALSE,
-		.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-		.colorBlendOp = VK_BLEND_OP_ADD,
-		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-		.alphaBlendOp = VK_BLEND_OP_ADD,
-		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+		.blendEnable = key.blend ? VK_TRUE : VK_FALSE,
+		.srcColorBlendFactor = static_cast<VkBlendFactor>(key.src_color_factor),
+		.dstColorBlendFactor = static_cast<VkBlendFactor>(key.dst_color_factor),
+		.colorBlendOp = static_cast<VkBlendOp>(key.color_op),
+		.srcAlphaBlendFactor = static_cast<VkBlendFactor>(key.src_alpha_factor),
+		.dstAlphaBlendFactor = static_cast<VkBlendFactor>(key.dst_alpha_factor),
+		.alphaBlendOp = static_cast<VkBlendOp>(key.alpha_op),
+		.colorWriteMask = key.color_write_mask,
 	};
 
 	VkPipelineColorBlendStateCreateInfo pipeline_cb_state_create_info = {
@@ -1000,491 +2455,7902 @@ int glvkInit(GLVKwindow window) {
 		.blendConstants = { 0, 0, 0, 0 },
 	};
 
-	VkDescriptorSetLayoutCreateInfo desc_set_layout_create_info = {
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-		.bindingCount = 0,
-		.pBindings = nullptr,
-	};
-
-	if (vkCreateDescriptorSetLayout(vkstate.device, &desc_set_layout_create_info, vkstate.allocator, &vkstate.desc_layout)) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create descriptor set layout");
-		return 1;
-	}
-
-	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-		.setLayoutCount = 1,
-		.pSetLayouts = &vkstate.desc_layout,
-		.pushConstantRangeCount = 0,
-		.pPushConstantRanges = nullptr,
-	};
-
-	if (vkCreatePipelineLayout(vkstate.device, &pipeline_layout_create_info, vkstate.allocator, &vkstate.pipeline_layout) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create pipeline layout");
-		return 1;
-	}
-
 	VkGraphicsPipelineCreateInfo pipeline_create_info = {
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
 		.stageCount = 2,
 		.pStages = shader_stage_create_infos,
-		.pVertexInputState = &pipeline_vinput_state_create_info,
+		.pVertexInputState = vkstate.vertex_input_dynamic ? nullptr : &pipeline_vinput_state_create_info,
 		.pInputAssemblyState = &pipeline_ia_state_create_info,
 		.pTessellationState = nullptr,
 		.pViewportState = &pipeline_viewport_state_create_info,
 		.pRasterizationState = &pipeline_rast_state_create_info,
 		.pMultisampleState = &pipeline_ms_state_create_info,
-		.pDepthStencilState = nullptr,
+		.pDepthStencilState = &pipeline_depth_state_create_info,
 		.pColorBlendState = &pipeline_cb_state_create_info,
 		.pDynamicState = &pipeline_ds_create_info,
 		.layout = vkstate.pipeline_layout,
-		.renderPass = vkstate.render_pass,
+		.renderPass = key.render_pass,
 		.subpass = 0,
 		.basePipelineHandle = VK_NULL_HANDLE,
 		.basePipelineIndex = -1,
 	};
 
-	if (vkCreateGraphicsPipelines(vkstate.device, VK_NULL_HANDLE, 1, &pipeline_create_info, vkstate.allocator, &vkstate.pipeline) != VK_SUCCESS) {
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(vkstate.device, vkstate.pipelines.driver_cache, 1, &pipeline_create_info, vkstate.allocator, &pipeline) != VK_SUCCESS) {
 		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create graphics pipeline");
-		return 1;
+		return VK_NULL_HANDLE;
+	}
+
+	return pipeline;
+}
+
+/* returns the pipeline for key, building it on a miss */
+static VkPipeline findPipeline(const pipelinekey_t& key) {
+	GLVKvkpipelines& pipelines = vkstate.pipelines;
+
+	auto it = pipelines.cache.find(key);
+	if (it != pipelines.cache.end()) {
+		++pipelines.hits;
+		return it->second;
+	}
+
+	++pipelines.misses;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	VkPipeline pipeline = createPipeline(key);
+	uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+	pipelines.compile_ns += elapsed;
+	pipelines.max_compile_ns = std::max(pipelines.max_compile_ns, elapsed);
+	pipelines.cache.emplace(key, pipeline);
+
+	GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Built pipeline {} in {} us", pipelines.cache.size(), elapsed / 1000);
+	return pipeline;
+}
+
+/* returns the cache file contents if they were written by a driver that can use them */
+static std::vector<uint8_t> readPipelineCache(const std::string& path) {
+	std::vector<uint8_t> data;
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		return data;
+	}
+
+	data.resize(file.tellg());
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+	if (!file) {
+		data.clear();
+		return data;
+	}
+
+	/* drivers are supposed to reject foreign data themselves, but not all of them do so gracefully */
+	VkPipelineCacheHeaderVersionOne header;
+	if (data.size() < sizeof(header)) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Ignoring truncated pipeline cache {}", path);
+		data.clear();
+		return data;
+	}
+
+	memcpy(&header, data.data(), sizeof(header));
+	const VkPhysicalDeviceProperties& props = vkstate.physical.properties;
+	if (
+		header.headerSize < sizeof(header) ||
+		header.headerSize > data.size() ||
+		header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		header.vendorID != props.vendorID ||
+		header.deviceID != props.deviceID ||
+		memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) != 0
+	) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Ignoring pipeline cache {} from another device or driver", path);
+		data.clear();
+	}
+
+	return data;
+}
+
+static VkResult createPipelineCache() {
+	vkstate.pipelines.path = state.pipeline_cache_set ? state.pipeline_cache_path : GLVK_DEFAULT_PIPELINE_CACHE_PATH;
+
+	std::vector<uint8_t> data;
+	if (!vkstate.pipelines.path.empty()) {
+		data = readPipelineCache(vkstate.pipelines.path);
+	}
+
+	VkPipelineCacheCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.initialDataSize = data.size(),
+		.pInitialData = data.empty() ? nullptr : data.data(),
+	};
+
+	VkResult res = vkCreatePipelineCache(vkstate.device, &create_info, vkstate.allocator, &vkstate.pipelines.driver_cache);
+	if (res != VK_SUCCESS && !data.empty()) {
+		/* fall back to an empty cache rather than failing initialization over stale data */
+		create_info.initialDataSize = 0;
+		create_info.pInitialData = nullptr;
+		res = vkCreatePipelineCache(vkstate.device, &create_info, vkstate.allocator, &vkstate.pipelines.driver_cache);
+	}
+
+	if (res == VK_SUCCESS && !data.empty()) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Loaded {} byte pipeline cache from {}", data.size(), vkstate.pipelines.path);
+	}
+
+	return res;
+}
+
+/* writes the driver cache back to disk, through a temporary file so a crash never leaves a torn cache behind */
+static void savePipelineCache() {
+	if (vkstate.pipelines.path.empty() || vkstate.pipelines.misses == 0) {
+		return;
+	}
+
+	size_t size = 0;
+	if (vkGetPipelineCacheData(vkstate.device, vkstate.pipelines.driver_cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+		return;
+	}
+
+	std::vector<uint8_t> data(size);
+	if (vkGetPipelineCacheData(vkstate.device, vkstate.pipelines.driver_cache, &size, data.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	std::string temp_path = vkstate.pipelines.path + ".tmp";
+	std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Failed to open {} for writing", temp_path);
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(data.data()), size);
+	file.close();
+
+	/* std::rename refuses to replace an existing file on windows, filesystem::rename replaces it everywhere */
+	std::error_code error;
+	if (file) {
+		std::filesystem::rename(temp_path, vkstate.pipelines.path, error);
+	}
+
+	if (!file || error) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Failed to write pipeline cache {}", vkstate.pipelines.path);
+		std::remove(temp_path.c_str());
+		return;
+	}
+
+	GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Saved {} byte pipeline cache to {}", size, vkstate.pipelines.path);
+}
+
+static void destroyPipelines() {
+	for (auto& [key, pipeline] : vkstate.pipelines.cache) {
+		if (pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(vkstate.device, pipeline, vkstate.allocator);
+		}
+	}
+
+	vkstate.pipelines.cache.clear();
+}
+
+void glvkGetPipelineStats(GLVKpipelinestats* stats) {
+	GLVK_SYNC();
+	if (stats == nullptr) {
+		return;
+	}
+
+	*stats = {
+		.pipeline_count = static_cast<unsigned int>(vkstate.pipelines.cache.size()),
+		.hits = vkstate.pipelines.hits,
+		.misses = vkstate.pipelines.misses,
+		.compile_us = vkstate.pipelines.compile_ns / 1000,
+		.max_compile_us = vkstate.pipelines.max_compile_ns / 1000,
+		.shader_cache_hits = static_cast<unsigned int>(vkstate.shaders.cache_hits),
+		.shader_compiles = static_cast<unsigned int>(vkstate.shaders.compiles),
+		.shader_compile_us = vkstate.shaders.compile_ns / 1000,
+	};
+}
+
+static void destroyProgramModules(programmodules_t& modules) {
+	vkDestroyShaderModule(vkstate.device, modules.vertex, vkstate.allocator);
+	vkDestroyShaderModule(vkstate.device, modules.fragment, vkstate.allocator);
+	modules = { .vertex = VK_NULL_HANDLE, .fragment = VK_NULL_HANDLE };
+}
+
+/* a replacement of source[start, end). after is put on lines of its own behind the line the replacement ends on */
+struct shaderedit_t {
+	size_t start;
+	size_t end;
+	std::string text;
+	std::string after;
+};
+
+/* the source with comments blanked, offsets and line breaks are kept so matches in it map back onto the source */
+static std::string maskComments(const std::string& source) {
+	std::string masked = source;
+	size_t i = 0;
+	while (i < masked.size()) {
+		if (masked.compare(i, 2, "//") == 0) {
+			for (; i < masked.size() && masked[i] != '\n'; ++i) {
+				masked[i] = ' ';
+			}
+		} else if (masked.compare(i, 2, "/*") == 0) {
+			size_t end = masked.find("*/", i + 2);
+			end = (end == std::string::npos) ? masked.size() : end + 2;
+			for (; i < end; ++i) {
+				if (masked[i] != '\n') {
+					masked[i] = ' ';
+				}
+			}
+		} else {
+			++i;
+		}
+	}
+
+	return masked;
+}
+
+static size_t lineAt(const std::string& source, size_t offset) {
+	return 1 + std::count(source.begin(), source.begin() + offset, '\n');
+}
+
+/* text followed by the line breaks of source[start, end), so replacing the range keeps the lines after it where they were */
+static std::string keepLines(std::string text, const std::string& source, size_t start, size_t end) {
+	text.append(std::count(source.begin() + start, source.begin() + end, '\n'), '\n');
+	return text;
+}
+
+/* the name and value of every entry of a layout qualifier list, the value is empty for entries without one */
+static std::vector<std::pair<std::string, std::string>> layoutQualifiers(const std::string& list) {
+	static const std::regex entry(R"(\s*(\w+)\s*(?:=\s*(\w+))?\s*)");
+
+	std::vector<std::pair<std::string, std::string>> qualifiers;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		std::smatch m;
+		if (std::regex_match(item, m, entry)) {
+			qualifiers.emplace_back(m[1].str(), m[2].str());
+		}
+	}
+
+	return qualifiers;
+}
+
+static const std::string* layoutQualifier(const std::vector<std::pair<std::string, std::string>>& qualifiers, const char* name) {
+	for (const auto& [key, value] : qualifiers) {
+		if (key == name) {
+			return &value;
+		}
+	}
+
+	return nullptr;
+}
+
+/* the binding of a qualifier list, 0 without one and -1 when it is not an integer literal below limit */
+static int layoutBinding(const std::vector<std::pair<std::string, std::string>>& qualifiers, int limit) {
+	const std::string* value = layoutQualifier(qualifiers, "binding");
+	if (value == nullptr) {
+		return 0;
+	}
+
+	char* end = nullptr;
+	long binding = std::strtol(value->c_str(), &end, 0);
+	if (value->empty() || *end != '\0' || binding < 0 || binding >= limit) {
+		return -1;
+	}
+
+	return static_cast<int>(binding);
+}
+
+/* rewrites gl flavoured glsl onto glvk's descriptor layout, see the description next to GLVK_MAX_UNIFORM_LOCATIONS.
+ * declarations are matched with the comments blanked out and rewritten in place, #line directives keep error lines pointing into the source */
+static bool translateShader(GLenum type, const std::string& source, bool bindless, std::string& glsl, std::string& log) {
+	static const std::regex version_regex(R"(#[ \t]*version[ \t]+(\d+)[^\n]*)");
+	static const std::regex extension_regex(R"(#[ \t]*extension[^\n]*)");
+	static const std::regex sampler_regex(R"(\b(?:layout\s*\(([^)]*)\)\s*)?uniform\s+(?:(?:lowp|mediump|highp)\s+)?sampler2D\s+(\w+)\s*;)");
+	static const std::regex uniform_regex(R"(\b(?:layout\s*\(([^)]*)\)\s*)?uniform\s+(?:(?:lowp|mediump|highp)\s+)?(\w+)\s+([^;{]*);)");
+	static const std::regex slot_type_regex(R"(float|int|uint|bool|[iub]?vec[234]|mat[234])");
+	static const std::regex opaque_type_regex(R"([iu]?(?:sampler|image|texture)\w*|subpassInput\w*|atomic_uint)");
+	static const std::regex declarator_regex(R"(\s*(\w+)\s*(\[[^\]]*\])?\s*)");
+	static const std::regex block_regex(R"(\b(layout\s*\(([^)]*)\)\s*)?((?:(?:readonly|writeonly|coherent|volatile|restrict)\s+)*)(uniform|buffer)\s+(\w+)\s*\{)");
+	static const std::regex block_end_regex(R"(\}\s*(\w*)\s*(\[[^\]]*\])?\s*;)");
+	static const std::regex member_layout_regex(R"(layout\s*\([^)]*\))");
+	static const std::regex array_regex(R"(\[[^\]]*\])");
+	static const std::regex last_name_regex(R"((\w+)\s*$)");
+	static const std::regex first_name_regex(R"(^\s*(\w+))");
+
+	const std::string masked = maskComments(source);
+	std::vector<shaderedit_t> edits;
+	auto error = [&](size_t offset, const std::string& message) {
+		log += "ERROR: 0:" + std::to_string(lineAt(source, offset)) + ": " + message + "\n";
+	};
+
+	/* #version moves into the header, shaders older than 130 get the renamed builtins */
+	std::smatch m;
+	int version = 110;
+	if (std::regex_search(masked, m, version_regex)) {
+		version = std::stoi(m[1].str());
+		edits.push_back({ .start = static_cast<size_t>(m.position(0)), .end = static_cast<size_t>(m.position(0) + m.length(0)), .text = "", .after = "" });
+	}
+
+	/* interface declarations go behind the shader's own #extension directives, which have to come before any declaration */
+	size_t extension_end = std::string::npos;
+	for (std::sregex_iterator it(masked.begin(), masked.end(), extension_regex), end; it != end; ++it) {
+		extension_end = it->position(0) + it->length(0);
+	}
+
+	bool uses_uniforms = false;
+	bool uses_bindings = false;
+	bool uses_textures = false;
+
+	for (std::sregex_iterator it(masked.begin(), masked.end(), sampler_regex), end; it != end; ++it) {
+		const std::smatch& match = *it;
+		std::vector<std::pair<std::string, std::string>> qualifiers = layoutQualifiers(match[1].str());
+		if (layoutQualifier(qualifiers, "set") != nullptr) {
+			continue;
+		}
+
+		size_t start = match.position(0);
+		size_t stop = start + match.length(0);
+		int unit = layoutBinding(qualifiers, GLVK_MAX_TEXTURE_UNITS);
+		if (unit < 0) {
+			error(start, "sampler '" + match[2].str() + "' binding must be a texture unit below " + std::to_string(GLVK_MAX_TEXTURE_UNITS));
+			continue;
+		}
+
+		if (bindless) {
+			edits.push_back({ .start = start, .end = stop, .text = keepLines("", source, start, stop), .after = "#define " + match[2].str() + " glvk_textures[glvk_bindings.textures[" + std::to_string(unit) + "]]\n" });
+			uses_bindings = true;
+			uses_textures = true;
+		} else {
+			std::string text = "layout(set = 0, binding = " + std::to_string(GLVK_FALLBACK_TEXTURE_BINDING + unit) + ") uniform sampler2D " + match[2].str() + ";";
+			edits.push_back({ .start = start, .end = stop, .text = keepLines(text, source, start, stop), .after = "" });
+		}
+	}
+
+	/* loose uniforms become reads of their slots in the default block, which stores every component as a raw 32 bit word */
+	for (std::sregex_iterator it(masked.begin(), masked.end(), uniform_regex), end; it != end; ++it) {
+		const std::smatch& match = *it;
+		std::vector<std::pair<std::string, std::string>> qualifiers = layoutQualifiers(match[1].str());
+		if (layoutQualifier(qualifiers, "set") != nullptr) {
+			continue;
+		}
+
+		size_t start = match.position(0);
+		size_t stop = start + match.length(0);
+		std::string type_name = match[2].str();
+		std::string list = match[3].str();
+
+		/* single sampler2D declarations were rewritten above, other opaque types are left to the shader */
+		if (std::regex_match(type_name, opaque_type_regex)) {
+			std::smatch single;
+			if (type_name == "sampler2D" && (!std::regex_match(list, single, declarator_regex) || single[2].matched)) {
+				error(start, "samplers have to be declared one per statement, arrays of samplers are not supported");
+			}
+			continue;
+		}
+
+		if (!std::regex_match(type_name, slot_type_regex)) {
+			error(start, "uniforms of type '" + type_name + "' are not supported outside of uniform blocks");
+			continue;
+		}
+
+		if (list.find('=') != std::string::npos) {
+			error(start, "uniform initializers are not supported");
+			continue;
+		}
+
+		/* declarators of one statement take consecutive slots from the location on */
+		std::vector<std::string> names;
+		std::stringstream stream(list);
+		std::string declarator;
+		bool valid = true;
+		while (std::getline(stream, declarator, ',')) {
+			std::smatch name;
+			if (!std::regex_match(declarator, name, declarator_regex)) {
+				error(start, "malformed uniform declaration");
+				valid = false;
+				break;
+			}
+
+			if (name[2].matched) {
+				error(start, "uniform '" + name[1].str() + "' arrays outside of uniform blocks are not supported");
+				valid = false;
+				break;
+			}
+
+			names.push_back(name[1].str());
+		}
+		if (!valid) {
+			continue;
+		}
+
+		bool matrix = type_name.compare(0, 3, "mat") == 0;
+		int size = std::isdigit(static_cast<unsigned char>(type_name.back())) ? type_name.back() - '0' : 1;
+		int columns = matrix ? size : 1;
+		const std::string* value = layoutQualifier(qualifiers, "location");
+		char* value_end = nullptr;
+		long location = (value != nullptr) ? std::strtol(value->c_str(), &value_end, 0) : -1;
+		long slot_count = static_cast<long>(names.size()) * columns;
+		if (value == nullptr || value->empty() || *value_end != '\0' || location < 0 || location + slot_count > GLVK_MAX_UNIFORM_LOCATIONS) {
+			error(start, "uniform '" + names[0] + "' needs a layout location below " + std::to_string(GLVK_MAX_UNIFORM_LOCATIONS));
+			continue;
+		}
+
+		static const char* swizzles[5] = { "", ".x", ".xy", ".xyz", "" };
+		std::string defines;
+		for (const std::string& name : names) {
+			auto slot = [&](long column) {
+				return "glvk_uniforms[" + std::to_string(location + column) + "]" + swizzles[size];
+			};
+
+			std::string expression;
+			if (matrix) {
+				expression = type_name + "(";
+				for (int c = 0; c < columns; ++c) {
+					expression += ((c > 0) ? ", " : "") + slot(c);
+				}
+				expression += ")";
+			} else if (type_name[0] == 'i') {
+				expression = "floatBitsToInt(" + slot(0) + ")";
+			} else if (type_name[0] == 'u') {
+				expression = "floatBitsToUint(" + slot(0) + ")";
+			} else if (type_name == "bool") {
+				expression = "(floatBitsToUint(" + slot(0) + ") != 0u)";
+			} else if (type_name[0] == 'b') {
+				expression = "notEqual(floatBitsToUint(" + slot(0) + "), uvec" + std::to_string(size) + "(0u))";
+			} else {
+				expression = slot(0);
+			}
+
+			defines += "#define " + name + " " + expression + "\n";
+			location += columns;
+		}
+
+		edits.push_back({ .start = start, .end = stop, .text = keepLines("", source, start, stop), .after = defines });
+		uses_uniforms = true;
+	}
+
+	for (std::sregex_iterator it(masked.begin(), masked.end(), block_regex), end; it != end; ++it) {
+		const std::smatch& match = *it;
+		std::vector<std::pair<std::string, std::string>> qualifiers = layoutQualifiers(match[2].str());
+		if (layoutQualifier(qualifiers, "set") != nullptr || layoutQualifier(qualifiers, "push_constant") != nullptr) {
+			continue;
+		}
+
+		size_t start = match.position(0);
+		size_t brace = start + match.length(0) - 1;
+		bool storage = match[4].str() == "buffer";
+		std::string block_name = match[5].str();
+
+		std::smatch tail;
+		size_t close = masked.find('}', brace);
+		if (close == std::string::npos || !std::regex_search(masked.cbegin() + close, masked.cend(), tail, block_end_regex, std::regex_constants::match_continuous)) {
+			error(start, "block '" + block_name + "' is not terminated");
+			continue;
+		}
+
+		std::string instance = tail[1].str();
+		if (tail[2].matched) {
+			error(start, "arrays of block '" + block_name + "' are not supported");
+			continue;
+		}
+
+		int limit = storage ? GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS : GLVK_MAX_UNIFORM_BUFFER_BINDINGS;
+		int binding = layoutBinding(qualifiers, limit);
+		if (binding < 0) {
+			error(start, "block '" + block_name + "' binding must be below " + std::to_string(limit));
+			continue;
+		}
+
+		/* gl's shared and packed layouts have no vulkan equivalent, std140 is what applications querying offsets expect most */
+		std::string layout = "layout(";
+		bool packing = false;
+		for (const auto& [key, value] : qualifiers) {
+			if (key == "binding" || key == "shared" || key == "packed") {
+				continue;
+			}
+
+			packing = packing || key == "std140" || key == "std430";
+			layout += key + (value.empty() ? "" : " = " + value) + ", ";
+		}
+		if (!packing) {
+			layout += "std140, ";
+		}
+
+		int set_binding = bindless ? (storage ? DESCRIPTOR_STORAGE_BUFFER : DESCRIPTOR_UNIFORM_BUFFER) : (storage ? GLVK_FALLBACK_STORAGE_BINDING : 0) + binding;
+		layout += "set = 0, binding = " + std::to_string(set_binding) + ")";
+
+		size_t layout_start = start;
+		size_t layout_end = match[1].matched ? start + match.length(1) : start;
+		edits.push_back({ .start = layout_start, .end = layout_end, .text = keepLines(layout + " ", source, layout_start, layout_end), .after = "" });
+
+		if (!bindless) {
+			continue;
+		}
+
+		/* one array per descriptor type in the bindless set, the block is indexed with the slot its binding resolved to */
+		std::string array = "glvk_block_" + (instance.empty() ? block_name : instance);
+		std::string element = array + "[glvk_bindings." + (storage ? "storage_buffers[" : "uniform_buffers[") + std::to_string(binding) + "]]";
+		std::string defines;
+		if (!instance.empty()) {
+			defines = "#define " + instance + " " + element + "\n";
+		} else {
+			std::string body = masked.substr(brace + 1, close - brace - 1);
+			std::stringstream stream(body);
+			std::string declaration;
+			while (std::getline(stream, declaration, ';')) {
+				declaration = std::regex_replace(std::regex_replace(declaration, member_layout_regex, " "), array_regex, " ");
+				std::stringstream names(declaration);
+				std::string part;
+				bool first = true;
+				while (std::getline(names, part, ',')) {
+					std::smatch name;
+					if (std::regex_search(part, name, first ? last_name_regex : first_name_regex)) {
+						defines += "#define " + name[1].str() + " " + element + "." + name[1].str() + "\n";
+					}
+					first = false;
+				}
+			}
+		}
+
+		size_t tail_end = close + tail.length(0);
+		edits.push_back({ .start = close, .end = tail_end, .text = keepLines("} " + array + "[];", source, close, tail_end), .after = defines });
+		uses_bindings = true;
+	}
+
+	if (!log.empty()) {
+		return false;
+	}
+
+	std::string interface;
+	if (uses_uniforms) {
+		interface += "layout(std140, set = 1, binding = 0) uniform glvk_default_block { vec4 glvk_uniforms[" + std::to_string(GLVK_MAX_UNIFORM_LOCATIONS) + "]; };\n";
+	}
+	if (uses_bindings) {
+		interface += "layout(push_constant) uniform glvk_bindings_block { uint uniform_buffers[" + std::to_string(GLVK_MAX_UNIFORM_BUFFER_BINDINGS) +
+			"]; uint storage_buffers[" + std::to_string(GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS) +
+			"]; uint textures[" + std::to_string(GLVK_MAX_TEXTURE_UNITS) + "]; } glvk_bindings;\n";
+	}
+	if (uses_textures) {
+		interface += "layout(set = 0, binding = " + std::to_string(DESCRIPTOR_TEXTURE) + ") uniform sampler2D glvk_textures[];\n";
+	}
+
+	std::string header = "#version 450\n";
+	if (bindless) {
+		header += "#extension GL_EXT_nonuniform_qualifier : require\n";
+	}
+	header += std::string("#define GLVK_BINDLESS ") + (bindless ? "1" : "0") + "\n";
+	header += "#define gl_VertexID gl_VertexIndex\n#define gl_InstanceID gl_InstanceIndex\n";
+	if (version < 130) {
+		header += "#define texture2D texture\n";
+		if (type == GL_VERTEX_SHADER) {
+			header += "#define attribute in\n#define varying out\n";
+		} else {
+			header += "#define varying in\n";
+			if (masked.find("gl_FragColor") != std::string::npos) {
+				header += "#define gl_FragColor glvk_frag_color\n";
+				interface += "layout(location = 0) out vec4 glvk_frag_color;\n";
+			}
+		}
+	}
+
+	if (extension_end == std::string::npos) {
+		header += interface;
+	} else if (!interface.empty()) {
+		edits.push_back({ .start = extension_end, .end = extension_end, .text = "", .after = interface });
+	}
+	header += "#line 1\n";
+
+	std::sort(edits.begin(), edits.end(), [](const shaderedit_t& a, const shaderedit_t& b) {
+		return a.start < b.start;
+	});
+
+	/* pending declarations are flushed at the next line break, followed by the number of the line coming next */
+	glsl = header;
+	std::string pending;
+	size_t line = 1;
+	size_t offset = 0;
+	auto copy = [&](size_t stop) {
+		for (; offset < stop; ++offset) {
+			glsl += source[offset];
+			if (source[offset] == '\n') {
+				++line;
+				if (!pending.empty()) {
+					glsl += pending + "#line " + std::to_string(line) + "\n";
+					pending.clear();
+				}
+			}
+		}
+	};
+
+	for (const shaderedit_t& edit : edits) {
+		copy(edit.start);
+		glsl += edit.text;
+		line += std::count(source.begin() + edit.start, source.begin() + edit.end, '\n');
+		offset = edit.end;
+		pending += edit.after;
+	}
+	copy(source.size());
+	if (!pending.empty()) {
+		glsl += "\n" + pending;
+	}
+
+	return true;
+}
+
+/* shaders are cached by their source, the stage, the descriptor layout they were rewritten for and the cache version */
+static uint64_t shaderKey(GLenum type, bool bindless, const std::string& source) {
+	uint32_t header[3] = { GLVK_SHADER_CACHE_VERSION, type, bindless ? 1u : 0u };
+	return hashBytes(source.data(), source.size(), hashBytes(header, sizeof(header)));
+}
+
+static std::string shaderCacheFile(uint64_t key) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.spv", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(vkstate.shaders.cache_path) / name).string();
+}
+
+static bool readShaderCache(uint64_t key, std::vector<uint32_t>& spirv) {
+	if (vkstate.shaders.cache_path.empty()) {
+		return false;
+	}
+
+	std::string path = shaderCacheFile(key);
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	size_t size = file.tellg();
+	if (size < sizeof(uint32_t) || size % sizeof(uint32_t) != 0) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Ignoring truncated shader cache entry {}", path);
+		return false;
+	}
+
+	spirv.resize(size / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(spirv.data()), size);
+	if (!file || spirv[0] != 0x07230203) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Ignoring invalid shader cache entry {}", path);
+		spirv.clear();
+		return false;
+	}
+
+	return true;
+}
+
+/* written through a temporary file like the pipeline cache, so a crash never leaves a torn entry behind */
+static void writeShaderCache(uint64_t key, const std::vector<uint32_t>& spirv) {
+	if (vkstate.shaders.cache_path.empty()) {
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(vkstate.shaders.cache_path, error);
+
+	std::string path = shaderCacheFile(key);
+	std::string temp_path = path + ".tmp";
+	std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Failed to open {} for writing", temp_path);
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+	file.close();
+	error.clear();
+	if (file) {
+		std::filesystem::rename(temp_path, path, error);
+	}
+
+	if (!file || error) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Failed to write shader cache entry {}", path);
+		std::remove(temp_path.c_str());
+	}
+}
+
+#ifdef GLVK_GLSLANG
+/* in and out variables without locations are assigned them in declaration order, the bindings were all made explicit by translateShader */
+static bool compileGlsl(GLenum type, const std::string& glsl, std::vector<uint32_t>& spirv, std::string& log) {
+	glslang_stage_t stage = (type == GL_VERTEX_SHADER) ? GLSLANG_STAGE_VERTEX : GLSLANG_STAGE_FRAGMENT;
+	glslang_messages_t messages = static_cast<glslang_messages_t>(GLSLANG_MSG_SPV_RULES_BIT | GLSLANG_MSG_VULKAN_RULES_BIT);
+	glslang_input_t input = {
+		.language = GLSLANG_SOURCE_GLSL,
+		.stage = stage,
+		.client = GLSLANG_CLIENT_VULKAN,
+		.client_version = GLSLANG_TARGET_VULKAN_1_0,
+		.target_language = GLSLANG_TARGET_SPV,
+		.target_language_version = GLSLANG_TARGET_SPV_1_0,
+		.code = glsl.c_str(),
+		.default_version = 450,
+		.default_profile = GLSLANG_NO_PROFILE,
+		.force_default_version_and_profile = false,
+		.forward_compatible = false,
+		.messages = messages,
+		.resource = glslang_default_resource(),
+	};
+
+	glslang_shader_t* shader = glslang_shader_create(&input);
+	glslang_shader_set_options(shader, GLSLANG_SHADER_AUTO_MAP_LOCATIONS);
+	if (!glslang_shader_preprocess(shader, &input) || !glslang_shader_parse(shader, &input)) {
+		log += glslang_shader_get_info_log(shader);
+		glslang_shader_delete(shader);
+		return false;
+	}
+
+	glslang_program_t* program = glslang_program_create();
+	glslang_program_add_shader(program, shader);
+	if (!glslang_program_link(program, messages)) {
+		log += glslang_program_get_info_log(program);
+		glslang_program_delete(program);
+		glslang_shader_delete(shader);
+		return false;
+	}
+
+	glslang_program_SPIRV_generate(program, stage);
+	spirv.resize(glslang_program_SPIRV_get_size(program));
+	glslang_program_SPIRV_get(program, spirv.data());
+	const char* spirv_messages = glslang_program_SPIRV_get_messages(program);
+	if (spirv_messages != nullptr) {
+		log += spirv_messages;
+	}
+
+	glslang_program_delete(program);
+	glslang_shader_delete(shader);
+	return true;
+}
+#endif
+
+/* compiles the shader's source, looking it up in the shader cache first */
+static void compileShader(glshader_t& shader) {
+	shader.compiled = false;
+	shader.info_log.clear();
+
+	bool bindless = vkstate.bindless.supported;
+	uint64_t key = shaderKey(shader.type, bindless, shader.source);
+	std::vector<uint32_t> spirv;
+	if (readShaderCache(key, spirv)) {
+		++vkstate.shaders.cache_hits;
+		shader.spirv = std::move(spirv);
+		shader.compiled = true;
+		return;
+	}
+
+	std::string glsl;
+	if (!translateShader(shader.type, shader.source, bindless, glsl, shader.info_log)) {
+		return;
+	}
+
+#ifdef GLVK_GLSLANG
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool compiled = compileGlsl(shader.type, glsl, spirv, shader.info_log);
+	uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	++vkstate.shaders.compiles;
+	vkstate.shaders.compile_ns += elapsed;
+	if (!compiled) {
+		return;
+	}
+
+	GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Compiled shader {} in {} us", shader.id, elapsed / 1000);
+	writeShaderCache(key, spirv);
+	shader.spirv = std::move(spirv);
+	shader.compiled = true;
+#else
+	shader.info_log += "ERROR: glvk was built without GLVK_GLSLANG, only shaders found in the shader cache can be compiled\n";
+#endif
+}
+
+static VkShaderModule createShaderModule(const std::vector<uint32_t>& spirv) {
+	VkShaderModuleCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.codeSize = spirv.size() * sizeof(uint32_t),
+		.pCode = spirv.data(),
+	};
+
+	VkShaderModule module;
+	if (vkCreateShaderModule(vkstate.device, &create_info, vkstate.allocator, &module) != VK_SUCCESS) {
+		return VK_NULL_HANDLE;
+	}
+
+	return module;
+}
+
+/* adds the counters of a command buffer's bindings to the state stats */
+static void collectStateStats(GLVKvkcmdstate& bound) {
+	vkstate.state_stats.state_commands += bound.state_commands;
+	vkstate.state_stats.redundant_state += bound.redundant_state;
+	bound.state_commands = 0;
+	bound.redundant_state = 0;
+}
+
+void glvkGetStateStats(GLVKstatestats* stats) {
+	GLVK_SYNC();
+	if (stats == nullptr) {
+		return;
+	}
+
+	/* the counters of the command buffer being recorded inline are taken now, secondaries report theirs as they are executed */
+	collectStateStats(vkstate.bound);
+	*stats = vkstate.state_stats;
+}
+
+/* queries the surface for the extent the swapchain should have, false while the window is minimized */
+static bool swapchainExtent(VkExtent2D& extent) {
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vkstate.physical.device, vkstate.surface, &vkstate.surface_capabilities);
+	const VkSurfaceCapabilitiesKHR& caps = vkstate.surface_capabilities;
+
+	extent = caps.currentExtent;
+	if (extent.width == std::numeric_limits<uint32_t>::max()) {
+		/* the surface takes its size from the swapchain, keep the current one */
+		extent.width = std::clamp(vkstate.extent.width, caps.minImageExtent.width, caps.maxImageExtent.width);
+		extent.height = std::clamp(vkstate.extent.height, caps.minImageExtent.height, caps.maxImageExtent.height);
+	}
+
+	return extent.width != 0 && extent.height != 0;
+}
+
+/* creates the swapchain and its image views for the current surface extent, retiring the previous swapchain if there is one */
+static VkResult createSwapchain() {
+	VkExtent2D extent;
+	if (!swapchainExtent(extent)) {
+		return VK_NOT_READY;
+	}
+
+	/* one image more than the minimum so acquiring the next image does not wait on the presentation engine */
+	uint32_t image_count = vkstate.surface_capabilities.minImageCount + 1;
+	if (vkstate.surface_capabilities.maxImageCount != 0 && image_count > vkstate.surface_capabilities.maxImageCount) {
+		image_count = vkstate.surface_capabilities.maxImageCount;
+	}
+
+	VkSwapchainKHR old_swapchain = vkstate.swapchain;
+	VkSwapchainCreateInfoKHR swapchain_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+		.pNext = nullptr,
+		.flags = 0,
+		.surface = vkstate.surface,
+		.minImageCount = image_count,
+		.imageFormat = vkstate.surface_format.format,
+		.imageColorSpace = vkstate.surface_format.colorSpace,
+		.imageExtent = extent,
+		.imageArrayLayers = 1,
+		/* glReadPixels copies out of the swapchain images where the surface allows it */
+		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (vkstate.surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT),
+		.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr,
+		.preTransform = vkstate.surface_capabilities.currentTransform,
+		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+		.presentMode = vkstate.surface_mode,
+		.clipped = VK_TRUE,
+		/* lets the presentation engine hand resources over instead of tearing the old swapchain down first */
+		.oldSwapchain = old_swapchain,
+	};
+
+	uint32_t indices[2] = { vkstate.queue_families.graphics, vkstate.queue_families.present };
+	if (vkstate.queue_families.graphics != vkstate.queue_families.present) {
+		swapchain_create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		swapchain_create_info.queueFamilyIndexCount = 2;
+		swapchain_create_info.pQueueFamilyIndices = indices;
+	}
+
+	VkResult res = vkCreateSwapchainKHR(vkstate.device, &swapchain_create_info, vkstate.allocator, &vkstate.swapchain);
+	if (old_swapchain != VK_NULL_HANDLE) {
+		/* retired either way, a failed create leaves no swapchain to present to */
+		vkDestroySwapchainKHR(vkstate.device, old_swapchain, vkstate.allocator);
+	}
+
+	if (res != VK_SUCCESS) {
+		vkstate.swapchain = VK_NULL_HANDLE;
+		return res;
+	}
+
+	vkstate.extent = extent;
+	vkGetSwapchainImagesKHR(vkstate.device, vkstate.swapchain, &vkstate.swapchain_image_count, nullptr);
+	vkstate.swapchain_images.resize(vkstate.swapchain_image_count);
+	vkGetSwapchainImagesKHR(vkstate.device, vkstate.swapchain, &vkstate.swapchain_image_count, vkstate.swapchain_images.data());
+
+	vkstate.swapchain_views.resize(vkstate.swapchain_image_count);
+	for (size_t i = 0; i < vkstate.swapchain_image_count; ++i) {
+		VkImageViewCreateInfo view_create_info = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.image = vkstate.swapchain_images[i],
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = vkstate.surface_format.format,
+			.components = {
+				.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+				.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+				.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+				.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+			},
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+
+		res = vkCreateImageView(vkstate.device, &view_create_info, vkstate.allocator, &vkstate.swapchain_views[i]);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+	}
+
+	vkstate.viewport = {
+		.x = 0,
+		.y = 0,
+		.width = static_cast<float>(vkstate.extent.width),
+		.height = static_cast<float>(vkstate.extent.height),
+		.minDepth = 0,
+		.maxDepth = 1,
+	};
+
+	vkstate.scissor = {
+		.offset = { 0, 0 },
+		.extent = vkstate.extent,
+	};
+
+	vkstate.image_fences.assign(vkstate.swapchain_image_count, VK_NULL_HANDLE);
+	return VK_SUCCESS;
+}
+
+/* headless stand-in for createSwapchain, one offscreen image per frame slot so a slot's image is free once its fence signals */
+static VkResult createOffscreenTargets(uint32_t width, uint32_t height) {
+	if (width == 0 || height == 0) {
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+
+	vkstate.extent = { width, height };
+	vkstate.offscreen.resize(vkstate.frame_count);
+	vkstate.swapchain_image_count = vkstate.frame_count;
+	vkstate.swapchain_images.resize(vkstate.frame_count);
+	vkstate.swapchain_views.resize(vkstate.frame_count);
+	for (uint32_t i = 0; i < vkstate.frame_count; ++i) {
+		VkResult res = createAttachment(vkstate.offscreen[i], vkstate.surface_format.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, width, height);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+
+		vkstate.swapchain_images[i] = vkstate.offscreen[i].image;
+		vkstate.swapchain_views[i] = vkstate.offscreen[i].view;
+	}
+
+	vkstate.viewport = {
+		.x = 0,
+		.y = 0,
+		.width = static_cast<float>(width),
+		.height = static_cast<float>(height),
+		.minDepth = 0,
+		.maxDepth = 1,
+	};
+
+	vkstate.scissor = {
+		.offset = { 0, 0 },
+		.extent = vkstate.extent,
+	};
+
+	vkstate.image_fences.assign(vkstate.swapchain_image_count, VK_NULL_HANDLE);
+	return VK_SUCCESS;
+}
+
+/* creates the objects sized by the swapchain: the depth buffer, one framebuffer and one present semaphore per swapchain image */
+static VkResult createSwapchainTargets() {
+	VkResult res = createDepthTarget();
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	if (!vkstate.headless) {
+		VkSemaphoreCreateInfo semaphore_create_info = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+		};
+
+		vkstate.render_finished.assign(vkstate.swapchain_image_count, VK_NULL_HANDLE);
+		for (VkSemaphore& semaphore : vkstate.render_finished) {
+			res = vkCreateSemaphore(vkstate.device, &semaphore_create_info, vkstate.allocator, &semaphore);
+			if (res != VK_SUCCESS) {
+				return res;
+			}
+		}
+	}
+
+	vkstate.framebuffers.resize(vkstate.swapchain_image_count);
+	for (size_t i = 0; i < vkstate.swapchain_image_count; ++i) {
+		VkImageView framebuffer_views[2] = {
+			vkstate.swapchain_views[i],
+			vkstate.depth.view,
+		};
+
+		VkFramebufferCreateInfo framebuffer_create_info = {
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.renderPass = vkstate.render_pass,
+			.attachmentCount = 2,
+			.pAttachments = framebuffer_views,
+			.width = vkstate.extent.width,
+			.height = vkstate.extent.height,
+			.layers = 1,
+		};
+
+		res = vkCreateFramebuffer(vkstate.device, &framebuffer_create_info, vkstate.allocator, &vkstate.framebuffers[i]);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+	}
+
+	return VK_SUCCESS;
+}
+
+/* destroys framebuffers, present semaphores, the depth buffer and swapchain image views, but not the swapchain itself */
+static void destroySwapchainTargets() {
+	for (VkFramebuffer framebuffer : vkstate.framebuffers) {
+		vkDestroyFramebuffer(vkstate.device, framebuffer, vkstate.allocator);
+	}
+	vkstate.framebuffers.clear();
+
+	for (VkSemaphore semaphore : vkstate.render_finished) {
+		vkDestroySemaphore(vkstate.device, semaphore, vkstate.allocator);
+	}
+	vkstate.render_finished.clear();
+
+	destroyAttachment(vkstate.depth);
+	for (GLVKvkframe& frame : vkstate.frames) {
+		destroyAttachment(frame.readback);
+	}
+
+	if (vkstate.headless) {
+		/* the views belong to the offscreen images */
+		for (GLVKvkattachment& attachment : vkstate.offscreen) {
+			destroyAttachment(attachment);
+		}
+		vkstate.offscreen.clear();
+		vkstate.swapchain_images.clear();
+	} else {
+		for (VkImageView view : vkstate.swapchain_views) {
+			vkDestroyImageView(vkstate.device, view, vkstate.allocator);
+		}
+	}
+	vkstate.swapchain_views.clear();
+}
+
+/* rebuilds the swapchain and everything sized by it after a resize. render passes and pipelines only depend on the
+ * surface format and stay valid. returns false while the window is minimized, the swapchain stays dirty until it is not */
+static bool recreateSwapchain() {
+	VkExtent2D extent;
+	if (!swapchainExtent(extent)) {
+		vkstate.swapchain_dirty = true;
+		return false;
+	}
+
+	/* in-flight frames still render to the old framebuffers */
+	vkDeviceWaitIdle(vkstate.device);
+	destroySwapchainTargets();
+
+	if (createSwapchain() != VK_SUCCESS || createSwapchainTargets() != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to recreate Vulkan swapchain");
+		destroySwapchainTargets();
+		vkstate.swapchain_dirty = true;
+		return false;
+	}
+
+	GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Recreated swapchain at {}x{}", vkstate.extent.width, vkstate.extent.height);
+	vkstate.swapchain_dirty = false;
+	return true;
+}
+
+static bool recordSecondary() {
+	return !recording.recorders.empty();
+}
+
+static void setVertexInput(VkCommandBuffer cb, const vertexlayout_t& layout) {
+	VkVertexInputBindingDescription2EXT bindings[GLVK_MAX_VERTEX_ATTRIBS];
+	for (uint32_t i = 0; i < layout.binding_count; ++i) {
+		bindings[i] = {
+			.sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT,
+			.pNext = nullptr,
+			.binding = layout.bindings[i].binding,
+			.stride = layout.bindings[i].stride,
+			.inputRate = layout.bindings[i].inputRate,
+			.divisor = 1,
+		};
+	}
+
+	VkVertexInputAttributeDescription2EXT attributes[GLVK_MAX_VERTEX_ATTRIBS];
+	for (uint32_t i = 0; i < layout.attribute_count; ++i) {
+		attributes[i] = {
+			.sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT,
+			.pNext = nullptr,
+			.location = layout.attributes[i].location,
+			.binding = layout.attributes[i].binding,
+			.format = layout.attributes[i].format,
+			.offset = layout.attributes[i].offset,
+		};
+	}
+
+	vkstate.set_vertex_input(cb, layout.binding_count, bindings, layout.attribute_count, attributes);
+}
+
+/* records a packet into cb, bound tracks what cb has bound so unchanged bindings are not re-emitted */
+static void recordPacket(VkCommandBuffer cb, GLVKvkcmdstate& bound, const GLVKvkframe& frame, const drawpacket_t& packet) {
+	if (packet.type == PACKET_TIMESTAMP) {
+		vkCmdWriteTimestamp(cb, static_cast<VkPipelineStageFlagBits>(packet.count), frame.query_pool, packet.first);
+		return;
+	}
+
+	/* everything else is state, draws only carry state that is compared against what cb has bound */
+	if (packet.type != PACKET_DRAW && packet.type != PACKET_DRAW_INDEXED) {
+		++bound.state_commands;
+	}
+
+	if (packet.type == PACKET_BLEND_CONSTANTS) {
+		vkCmdSetBlendConstants(cb, packet.blend_color);
+		return;
+	}
+
+	if (packet.type == PACKET_VIEWPORT) {
+		vkCmdSetViewport(cb, 0, 1, &frame.viewports[packet.first].viewport);
+		vkCmdSetScissor(cb, 0, 1, &frame.viewports[packet.first].scissor);
+		return;
+	}
+
+	if (packet.type == PACKET_VERTEX_BUFFERS) {
+		const vertexbuffers_t& buffers = frame.vertex_buffers[packet.first];
+		vkCmdBindVertexBuffers(cb, 0, buffers.count, buffers.buffers, buffers.offsets);
+		/* binding 0 no longer holds what a draw without a vertex array bound last */
+		bound.vertex_buffer = VK_NULL_HANDLE;
+		return;
+	}
+
+	if (packet.type == PACKET_VERTEX_INPUT) {
+		setVertexInput(cb, vkstate.vertex_layouts[packet.first]);
+		return;
+	}
+
+	if (packet.type == PACKET_PUSH_CONSTANTS) {
+		vkCmdPushConstants(cb, vkstate.pipeline_layout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(pushconstants_t), &frame.push_constants[packet.first]);
+		return;
+	}
+
+	if (packet.type == PACKET_BIND_DESCRIPTOR_SET) {
+		vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vkstate.pipeline_layout, 0, 1, &frame.descriptor_sets[packet.first], 0, nullptr);
+		return;
+	}
+
+	if (packet.type == PACKET_BIND_UNIFORMS) {
+		vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vkstate.pipeline_layout, 1, 1, &frame.uniform_chunks[packet.count].set, 1, &packet.first);
+		return;
+	}
+
+	if (bound.pipeline != packet.pipeline) {
+		vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+		bound.pipeline = packet.pipeline;
+		++bound.state_commands;
+	} else {
+		++bound.redundant_state;
+	}
+
+	if (packet.vertex_buffer != VK_NULL_HANDLE) {
+		if (bound.vertex_buffer != packet.vertex_buffer) {
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(cb, 0, 1, &packet.vertex_buffer, &offset);
+			bound.vertex_buffer = packet.vertex_buffer;
+			++bound.state_commands;
+		} else {
+			++bound.redundant_state;
+		}
+	}
+
+	if (packet.type == PACKET_DRAW) {
+		vkCmdDraw(cb, packet.count, packet.instance_count, packet.first, 0);
+		return;
+	}
+
+	/* the buffer stays bound at offset 0 and the offset becomes firstIndex, so moving through one index buffer never rebinds */
+	if (bound.index_buffer != packet.index_buffer || bound.index_type != packet.index_type) {
+		vkCmdBindIndexBuffer(cb, packet.index_buffer, 0, packet.index_type);
+		bound.index_buffer = packet.index_buffer;
+		bound.index_type = packet.index_type;
+		++bound.state_commands;
+	} else {
+		++bound.redundant_state;
+	}
+
+	vkCmdDrawIndexed(cb, packet.count, packet.instance_count, packet.first, 0, 0);
+}
+
+/* records a packet into the frame's command buffer, or keeps it for the record threads */
+static void submitPacket(GLVKvkframe& frame, const drawpacket_t& packet) {
+	if (recordSecondary()) {
+		frame.packets.push_back(packet);
+		return;
+	}
+
+	recordPacket(frame.command_buffer, vkstate.bound, frame, packet);
+}
+
+/* records the recorder's chunk into one of its secondary command buffers, runs on the recorder's own thread */
+static void recordChunk(GLVKvkrecorder& recorder) {
+	const GLVKvkframe& frame = *recording.frame;
+	uint32_t slot = vkstate.frame_index;
+	recorder.result = VK_NULL_HANDLE;
+
+	if (recorder.used[slot] == recorder.buffers[slot].size()) {
+		VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext = nullptr,
+			.commandPool = recorder.pools[slot],
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1,
+		};
+
+		VkCommandBuffer command_buffer;
+		if (vkAllocateCommandBuffers(vkstate.device, &command_buffer_allocate_info, &command_buffer) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to allocate secondary command buffer");
+			return;
+		}
+		recorder.buffers[slot].push_back(command_buffer);
+	}
+
+	VkCommandBuffer cb = recorder.buffers[slot][recorder.used[slot]++];
+
+	VkCommandBufferInheritanceInfo inheritance_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.pNext = nullptr,
+		.renderPass = vkstate.active_render_pass,
+		.subpass = 0,
+		.framebuffer = vkstate.framebuffers[vkstate.image_index],
+		.occlusionQueryEnable = VK_FALSE,
+		.queryFlags = 0,
+		.pipelineStatistics = 0,
+	};
+
+	VkCommandBufferBeginInfo command_buffer_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritance_info,
+	};
+
+	vkBeginCommandBuffer(cb, &command_buffer_begin_info);
+
+	/* dynamic state and bindings are not inherited from the primary */
+	vkCmdSetViewport(cb, 0, 1, &frame.viewports[recorder.viewport].viewport);
+	vkCmdSetScissor(cb, 0, 1, &frame.viewports[recorder.viewport].scissor);
+	vkCmdSetBlendConstants(cb, recorder.blend_color);
+	if (vkstate.bindless.supported) {
+		vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vkstate.pipeline_layout, 0, 1, &vkstate.bindless.set, 0, nullptr);
+	} else if (recorder.descriptor_set != GLVK_NO_DESCRIPTOR) {
+		vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vkstate.pipeline_layout, 0, 1, &frame.descriptor_sets[recorder.descriptor_set], 0, nullptr);
+	}
+	if (recorder.push_constants != GLVK_NO_DESCRIPTOR) {
+		vkCmdPushConstants(cb, vkstate.pipeline_layout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(pushconstants_t), &frame.push_constants[recorder.push_constants]);
+	}
+	if (recorder.uniform_chunk != GLVK_NO_DESCRIPTOR) {
+		vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vkstate.pipeline_layout, 1, 1, &frame.uniform_chunks[recorder.uniform_chunk].set, 1, &recorder.uniform_offset);
+	}
+	if (recorder.vertex_buffers != GLVK_NO_DESCRIPTOR) {
+		const vertexbuffers_t& buffers = frame.vertex_buffers[recorder.vertex_buffers];
+		vkCmdBindVertexBuffers(cb, 0, buffers.count, buffers.buffers, buffers.offsets);
+	}
+	if (recorder.vertex_input != GLVK_NO_DESCRIPTOR) {
+		setVertexInput(cb, vkstate.vertex_layouts[recorder.vertex_input]);
+	}
+
+	recorder.bound = {};
+	for (uint32_t i = 0; i < recorder.packet_count; ++i) {
+		recordPacket(cb, recorder.bound, frame, recorder.packets[i]);
+	}
+
+	vkEndCommandBuffer(cb);
+	recorder.result = cb;
+}
+
+static void recordWorker(uint32_t index) {
+	uint64_t seen = 0;
+	for (;;) {
+		recording.generation.wait(seen, std::memory_order_acquire);
+		seen = recording.generation.load(std::memory_order_acquire);
+
+		uint64_t chunk_count = seen & GLVK_RECORD_CHUNK_MASK;
+		if (chunk_count == GLVK_RECORD_STOP) {
+			return;
+		}
+
+		if (index < chunk_count) {
+			recordChunk(recording.recorders[index]);
+			if (recording.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				recording.pending.notify_one();
+			}
+		}
+	}
+}
+
+static void wakeRecordWorkers(uint64_t chunk_count) {
+	uint64_t generation = recording.generation.load(std::memory_order_relaxed);
+	generation = (generation & ~GLVK_RECORD_CHUNK_MASK) + (GLVK_RECORD_CHUNK_MASK + 1);
+	recording.generation.store(generation | chunk_count, std::memory_order_release);
+	recording.generation.notify_all();
+}
+
+/* splits the frame's packets into contiguous chunks, records them into secondary command buffers on the record threads
+ * and executes those in order in the frame's render pass */
+static void recordPackets(GLVKvkframe& frame) {
+	if (frame.packets.empty()) {
+		return;
+	}
+
+	uint32_t packet_count = static_cast<uint32_t>(frame.packets.size());
+	uint32_t chunk_count = std::min(static_cast<uint32_t>(recording.recorders.size()), (packet_count + GLVK_RECORD_MIN_PACKETS - 1) / GLVK_RECORD_MIN_PACKETS);
+	uint32_t chunk_size = (packet_count + chunk_count - 1) / chunk_count;
+
+	GLfloat blend_color[4];
+	memcpy(blend_color, frame.packet_blend_color, sizeof(blend_color));
+	uint32_t push_constants = frame.packet_push_constants;
+	uint32_t descriptor_set = frame.packet_descriptor_set;
+	uint32_t uniform_chunk = frame.packet_uniform_chunk;
+	uint32_t uniform_offset = frame.packet_uniform_offset;
+	uint32_t viewport = frame.packet_viewport;
+	uint32_t vertex_buffers = frame.packet_vertex_buffers;
+	uint32_t vertex_input = frame.packet_vertex_input;
+
+	uint32_t begin = 0;
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		uint32_t end = std::min(packet_count, begin + chunk_size);
+		GLVKvkrecorder& recorder = recording.recorders[i];
+		recorder.packets = frame.packets.data() + begin;
+		recorder.packet_count = end - begin;
+		memcpy(recorder.blend_color, blend_color, sizeof(blend_color));
+		recorder.push_constants = push_constants;
+		recorder.descriptor_set = descriptor_set;
+		recorder.uniform_chunk = uniform_chunk;
+		recorder.uniform_offset = uniform_offset;
+		recorder.viewport = viewport;
+		recorder.vertex_buffers = vertex_buffers;
+		recorder.vertex_input = vertex_input;
+
+		/* the next chunk starts with the blend constants and bindings this one leaves behind */
+		for (uint32_t j = begin; j < end; ++j) {
+			if (frame.packets[j].type == PACKET_BLEND_CONSTANTS) {
+				memcpy(blend_color, frame.packets[j].blend_color, sizeof(blend_color));
+			} else if (frame.packets[j].type == PACKET_PUSH_CONSTANTS) {
+				push_constants = frame.packets[j].first;
+			} else if (frame.packets[j].type == PACKET_BIND_DESCRIPTOR_SET) {
+				descriptor_set = frame.packets[j].first;
+			} else if (frame.packets[j].type == PACKET_BIND_UNIFORMS) {
+				uniform_chunk = frame.packets[j].count;
+				uniform_offset = frame.packets[j].first;
+			} else if (frame.packets[j].type == PACKET_VIEWPORT) {
+				viewport = frame.packets[j].first;
+			} else if (frame.packets[j].type == PACKET_VERTEX_BUFFERS) {
+				vertex_buffers = frame.packets[j].first;
+			} else if (frame.packets[j].type == PACKET_VERTEX_INPUT) {
+				vertex_input = frame.packets[j].first;
+			} else if (frame.packets[j].vertex_buffer != VK_NULL_HANDLE) {
+				/* a draw without a vertex array rebinds binding 0 */
+				vertex_buffers = GLVK_NO_DESCRIPTOR;
+			}
+		}
+		begin = end;
+	}
+	memcpy(frame.packet_blend_color, blend_color, sizeof(blend_color));
+	frame.packet_push_constants = push_constants;
+	frame.packet_descriptor_set = descriptor_set;
+	frame.packet_uniform_chunk = uniform_chunk;
+	frame.packet_uniform_offset = uniform_offset;
+	frame.packet_viewport = viewport;
+	frame.packet_vertex_buffers = vertex_buffers;
+	frame.packet_vertex_input = vertex_input;
+
+	recording.frame = &frame;
+	if (chunk_count > 1) {
+		recording.pending.store(chunk_count - 1, std::memory_order_relaxed);
+		wakeRecordWorkers(chunk_count);
+	}
+
+	recordChunk(recording.recorders[0]);
+
+	uint32_t pending = recording.pending.load(std::memory_order_acquire);
+	while (chunk_count > 1 && pending != 0) {
+		recording.pending.wait(pending, std::memory_order_acquire);
+		pending = recording.pending.load(std::memory_order_acquire);
+	}
+
+	VkCommandBuffer command_buffers[GLVK_MAX_RECORD_THREADS];
+	uint32_t command_buffer_count = 0;
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		collectStateStats(recording.recorders[i].bound);
+		if (recording.recorders[i].result != VK_NULL_HANDLE) {
+			command_buffers[command_buffer_count++] = recording.recorders[i].result;
+		}
+	}
+
+	if (command_buffer_count != 0) {
+		vkCmdExecuteCommands(frame.command_buffer, command_buffer_count, command_buffers);
+	}
+	frame.packets.clear();
+}
+
+static int createRecorders() {
+	if (state.record_threads <= 1) {
+		return 0;
+	}
+
+	recording.recorders.resize(state.record_threads);
+	for (GLVKvkrecorder& recorder : recording.recorders) {
+		for (uint32_t slot = 0; slot < vkstate.frame_count; ++slot) {
+			VkCommandPoolCreateInfo command_pool_create_info = {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+				.pNext = nullptr,
+				.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+				.queueFamilyIndex = vkstate.queue_families.graphics,
+			};
+
+			if (vkCreateCommandPool(vkstate.device, &command_pool_create_info, vkstate.allocator, &recorder.pools[slot]) != VK_SUCCESS) {
+				GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create command pool");
+				return 1;
+			}
+		}
+	}
+
+	recording.generation.store(0, std::memory_order_relaxed);
+	recording.pending.store(0, std::memory_order_relaxed);
+	for (uint32_t i = 1; i < state.record_threads; ++i) {
+		recording.workers.emplace_back(recordWorker, i);
+	}
+
+	return 0;
+}
+
+static void destroyRecorders() {
+	if (!recording.workers.empty()) {
+		wakeRecordWorkers(GLVK_RECORD_STOP);
+		for (std::thread& worker : recording.workers) {
+			worker.join();
+		}
+		recording.workers.clear();
+	}
+
+	/* destroying a pool frees its command buffers */
+	for (GLVKvkrecorder& recorder : recording.recorders) {
+		for (VkCommandPool pool : recorder.pools) {
+			if (pool != VK_NULL_HANDLE) {
+				vkDestroyCommandPool(vkstate.device, pool, vkstate.allocator);
+			}
+		}
+	}
+	recording.recorders.clear();
+}
+
+/* creates the descriptor set layout and, with descriptor indexing, the one bindless set every draw binds.
+ * without it every binding gets a descriptor of its own and sets are allocated per frame */
+static VkResult createDescriptorLayout() {
+	GLVKvkbindless& bindless = vkstate.bindless;
+	bindless.pool = VK_NULL_HANDLE;
+	bindless.set = VK_NULL_HANDLE;
+	bindless.handle_slots.clear();
+	for (descriptorarray_t& array : bindless.arrays) {
+		array.capacity = 0;
+		array.slots.clear();
+		array.clock = 0;
+		array.lookup.clear();
+	}
+
+	if (!bindless.supported) {
+		VkDescriptorSetLayoutBinding bindings[GLVK_FALLBACK_BINDING_COUNT];
+		for (uint32_t i = 0; i < GLVK_FALLBACK_BINDING_COUNT; ++i) {
+			bindings[i] = {
+				.binding = i,
+				.descriptorType = (i >= GLVK_FALLBACK_TEXTURE_BINDING) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : (i >= GLVK_FALLBACK_STORAGE_BINDING) ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+				.pImmutableSamplers = nullptr,
+			};
+		}
+
+		VkDescriptorSetLayoutCreateInfo desc_set_layout_create_info = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.bindingCount = GLVK_FALLBACK_BINDING_COUNT,
+			.pBindings = bindings,
+		};
+
+		return vkCreateDescriptorSetLayout(vkstate.device, &desc_set_layout_create_info, vkstate.allocator, &vkstate.desc_layout);
+	}
+
+	VkPhysicalDeviceDescriptorIndexingProperties indexing_props = {};
+	indexing_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+	VkPhysicalDeviceProperties2 props2 = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+		.pNext = &indexing_props,
+		.properties = {},
+	};
+	vkGetPhysicalDeviceProperties2(vkstate.physical.device, &props2);
+
+	/* the arrays share the per stage resource limit, uniform buffers are usually the scarcest */
+	uint32_t budget = indexing_props.maxPerStageUpdateAfterBindResources;
+	uint32_t uniform_count = std::min({ static_cast<uint32_t>(GLVK_BINDLESS_UNIFORM_BUFFERS), indexing_props.maxPerStageDescriptorUpdateAfterBindUniformBuffers, indexing_props.maxDescriptorSetUpdateAfterBindUniformBuffers, budget / 4 });
+	budget -= uniform_count;
+	uint32_t storage_count = std::min({ static_cast<uint32_t>(GLVK_BINDLESS_STORAGE_BUFFERS), indexing_props.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexing_props.maxDescriptorSetUpdateAfterBindStorageBuffers, budget / 2 });
+	budget -= storage_count;
+	uint32_t texture_count = std::min({ static_cast<uint32_t>(GLVK_BINDLESS_TEXTURES), indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages, indexing_props.maxPerStageDescriptorUpdateAfterBindSamplers, indexing_props.maxDescriptorSetUpdateAfterBindSampledImages, indexing_props.maxDescriptorSetUpdateAfterBindSamplers, budget });
+
+	bindless.arrays[DESCRIPTOR_UNIFORM_BUFFER].capacity = uniform_count;
+	bindless.arrays[DESCRIPTOR_STORAGE_BUFFER].capacity = storage_count;
+	bindless.arrays[DESCRIPTOR_TEXTURE].capacity = texture_count;
+
+	VkDescriptorSetLayoutBinding bindings[DESCRIPTOR_TYPE_COUNT] = {
+		{
+			.binding = DESCRIPTOR_UNIFORM_BUFFER,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = uniform_count,
+			.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+			.pImmutableSamplers = nullptr,
+		},
+		{
+			.binding = DESCRIPTOR_STORAGE_BUFFER,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = storage_count,
+			.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+			.pImmutableSamplers = nullptr,
+		},
+		{
+			.binding = DESCRIPTOR_TEXTURE,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = texture_count,
+			.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+			.pImmutableSamplers = nullptr,
+		},
+	};
+
+	VkDescriptorBindingFlags binding_flag = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+	VkDescriptorBindingFlags binding_flags[DESCRIPTOR_TYPE_COUNT] = { binding_flag, binding_flag, binding_flag };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.pNext = nullptr,
+		.bindingCount = DESCRIPTOR_TYPE_COUNT,
+		.pBindingFlags = binding_flags,
+	};
+
+	VkDescriptorSetLayoutCreateInfo desc_set_layout_create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = &binding_flags_create_info,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+		.bindingCount = DESCRIPTOR_TYPE_COUNT,
+		.pBindings = bindings,
+	};
+
+	VkResult res = vkCreateDescriptorSetLayout(vkstate.device, &desc_set_layout_create_info, vkstate.allocator, &vkstate.desc_layout);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkDescriptorPoolSize pool_sizes[DESCRIPTOR_TYPE_COUNT] = {
+		{ .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = uniform_count },
+		{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = storage_count },
+		{ .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = texture_count },
+	};
+
+	VkDescriptorPoolCreateInfo pool_create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets = 1,
+		.poolSizeCount = DESCRIPTOR_TYPE_COUNT,
+		.pPoolSizes = pool_sizes,
+	};
+
+	res = vkCreateDescriptorPool(vkstate.device, &pool_create_info, vkstate.allocator, &bindless.pool);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkDescriptorSetAllocateInfo set_allocate_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.descriptorPool = bindless.pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &vkstate.desc_layout,
+	};
+
+	return vkAllocateDescriptorSets(vkstate.device, &set_allocate_info, &bindless.set);
+}
+
+/* set 1 holds the default uniform block, every uniform chunk gets a set of its own written once when the chunk is created */
+static VkResult createUniformLayout() {
+	VkDescriptorSetLayoutBinding binding = {
+		.binding = 0,
+		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.descriptorCount = 1,
+		.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+		.pImmutableSamplers = nullptr,
+	};
+
+	VkDescriptorSetLayoutCreateInfo desc_set_layout_create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.bindingCount = 1,
+		.pBindings = &binding,
+	};
+
+	VkResult res = vkCreateDescriptorSetLayout(vkstate.device, &desc_set_layout_create_info, vkstate.allocator, &vkstate.uniform_layout);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkDescriptorPoolSize pool_size = {
+		.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.descriptorCount = vkstate.frame_count * GLVK_MAX_UNIFORM_CHUNKS,
+	};
+
+	VkDescriptorPoolCreateInfo pool_create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.maxSets = vkstate.frame_count * GLVK_MAX_UNIFORM_CHUNKS,
+		.poolSizeCount = 1,
+		.pPoolSizes = &pool_size,
+	};
+
+	return vkCreateDescriptorPool(vkstate.device, &pool_create_info, vkstate.allocator, &vkstate.uniform_pool);
+}
+
+/* without a window (headless) frames are rendered into width x height offscreen images instead of a swapchain */
+static int initialize(GLVKwindow window, bool headless, uint32_t width, uint32_t height) {
+	GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Initialization started");
+	if (state.inited) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glvk already initialized");
+		return 0;
+	}
+	state.window = window;
+	vkstate.headless = headless;
+	vkstate.surface = VK_NULL_HANDLE;
+	vkstate.swapchain = VK_NULL_HANDLE;
+
+	vkstate.info.app = {
+		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+		.pNext = nullptr,
+		.pApplicationName = "glvk",
+		.applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+		.pEngineName = "glvk",
+		.engineVersion = VK_MAKE_VERSION(1, 0, 0),
+		.apiVersion = VK_API_VERSION_1_3,
+	};
+
+	std::vector<layer_t> requested_instance_layers;
+	std::vector<extension_t> requested_instance_extensions;
+	if (!vkstate.headless) {
+		requested_instance_extensions.push_back({ VK_KHR_SURFACE_EXTENSION_NAME, true });
+		requested_instance_extensions.push_back({ SURFACE_EXTENSION_NAME, true });
+	}
+
+	if (state.is_debug) {
+		requested_instance_layers.push_back({ "VK_LAYER_KHRONOS_validation", false });
+		requested_instance_extensions.push_back({ VK_EXT_DEBUG_UTILS_EXTENSION_NAME, false });
+	}
+
+	#ifdef GLVK_MAC
+
+	#endif
+
+	uint32_t instance_layer_count = 0;
+	vkEnumerateInstanceLayerProperties(&instance_layer_count, nullptr);
+
+	std::vector<VkLayerProperties> layer_props(instance_layer_count);
+	vkEnumerateInstanceLayerProperties(&instance_layer_count, layer_props.data());
+
+	std::vector<const char*> instance_layers;
+	for (const layer_t& layer : requested_instance_layers) {
+		bool found = false;
+		for (const VkLayerProperties& prop : layer_props) {
+			if (strcmp(prop.layerName, layer.name) == 0) {
+				found = true;
+				instance_layers.push_back(layer.name);
+			}
+		}
+
+		if (layer.required && !found) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find required Vulkan instance layer {}", layer.name);
+			return 1;
+		} else if (!found) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Failed to find Vulkan instance layer {}", layer.name);
+		}
+	}
+
+	uint32_t instance_extension_count = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &instance_extension_count, nullptr);
+
+	std::vector<VkExtensionProperties> extension_props(instance_extension_count);
+	vkEnumerateInstanceExtensionProperties(nullptr, &instance_extension_count, extension_props.data());
+
+	std::vector<const char*> instance_extensions;
+	for (const extension_t& extension : requested_instance_extensions) {
+		bool found = false;
+		for (const VkExtensionProperties& prop : extension_props) {
+			if (strcmp(prop.extensionName, extension.name) == 0) {
+				found = true;
+				instance_extensions.push_back(extension.name);
+			}
+		}
+
+		if (extension.required && !found) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find required Vulkan instance extension {}", extension.name);
+			return 1;
+		} else if (!found) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Failed to find Vulkan instance extension {}", extension.name);
+		}
+	}
+
+	VkInstanceCreateInfo instance_create_info = {
+		.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.pApplicationInfo = &vkstate.info.app,
+		.enabledLayerCount = static_cast<uint32_t>(instance_layers.size()),
+		.ppEnabledLayerNames = instance_layers.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(instance_extensions.size()),
+		.ppEnabledExtensionNames = instance_extensions.data(),
+	};
+
+	if (vkCreateInstance(&instance_create_info, vkstate.allocator, &vkstate.instance) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan instance");
+		return 1;
+	}
+
+	if (state.is_debug) {
+		for (const char*& name : instance_extensions) {
+			if (strcmp(name, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0) {
+				PFN_vkCreateDebugUtilsMessengerEXT vkCreateDebugUtilsMessengerEXT = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(vkstate.instance, "vkCreateDebugUtilsMessengerEXT"));
+				if (vkCreateDebugUtilsMessengerEXT == nullptr) {
+					GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_WARNING, "Failed to find vkCreateDebugUtilsMessengerEXT");
+					break;
+				}
+
+				VkDebugUtilsMessengerCreateInfoEXT debug_create_info = {
+					.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
+					.pNext = nullptr,
+					.flags = 0,
+					.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+					.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+					.pfnUserCallback = [](VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_type, const VkDebugUtilsMessengerCallbackDataEXT* callback_data, void* user_data) -> VkBool32 {
+						const char* const severity = (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) ? "verbose" : (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) ? "info" : (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) ? "warning" : (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) ? "error" : "unknown";
+						const char* const type = (message_type & VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT) ? "general" : (message_type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) ? "performance" : (message_type & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT) ? "validation" : "unknown";
+						GLVKDEBUGF(GLVK_TYPE_VULKAN, GLVK_SEVERITY_DEBUG, "[{}] ({}) {}", severity, type, callback_data->pMessage);
+
+						if (message_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+							return VK_TRUE;
+						}
+
+						return VK_FALSE;
+					},
+					.pUserData = nullptr,
+				};
+
+				if (vkCreateDebugUtilsMessengerEXT(vkstate.instance, &debug_create_info, vkstate.allocator, &vkstate.debug_messenger) != VK_SUCCESS) {
+					GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_WARNING, "Failed to create Vulkan debug messenger");
+				}
+				break;
+			}
+		}
+	}
+
+	if (!vkstate.headless) {
+		#ifdef GLVK_WINDOWS
+		if (window.hwnd == nullptr) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Window handle is null");
+			return 1;
+		}
+
+		if (window.hinstance == nullptr) {
+			window.hinstance = GetModuleHandle(nullptr);
+		}
+
+		VkWin32SurfaceCreateInfoKHR surface_create_info = {
+			.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
+			.pNext = nullptr,
+			.flags = 0,
+			.hinstance = reinterpret_cast<HINSTANCE>(window.hinstance),
+			.hwnd = reinterpret_cast<HWND>(window.hwnd),
+		};
+
+		if (vkCreateWin32SurfaceKHR(vkstate.instance, &surface_create_info, vkstate.allocator, &vkstate.surface) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan surface");
+			return 1;
+		}
+		#elif GLVK_LINUX
+		if (window.display == nullptr) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Display is null");
+			return 1;
+		}
+		if (window.window == 0) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Window is null");
+			return 1;
+		}
+
+		VkXlibSurfaceCreateInfoKHR surface_create_info = {
+			.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR,
+			.pNext = nullptr,
+			.flags = 0,
+			.dpy = reinterpret_cast<Display*>(window.display),
+			.window = static_cast<Window>(window.window),
+		};
+
+		if (vkCreateXlibSurfaceKHR(vkstate.instance, &surface_create_info, vkstate.allocator, &vkstate.surface) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan surface");
+			return 1;
+		}
+		#elif GLVK_MAC
+		if (window.layer == nullptr) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "layer is null");
+			return 1;
+		}
+
+		VkMetalSurfaceCreateInfoEXT surface_create_info = {
+			.sType = VK_STRUCTURE_TYPE_METAL_SURFACE_CREATE_INFO_EXT,
+			.pNext = nullptr,
+			.flags = 0,
+			.pLayer = window.layer,
+		};
+
+		if (vkCreateMetalSurfaceEXT(vkstate.instance, &surface_create_info, vkstate.allocator, &vkstate.surface) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan surface");
+			return 1;
+		}
+		#endif
+	}
+
+	uint32_t physical_count = 0;
+	vkEnumeratePhysicalDevices(vkstate.instance, &physical_count, nullptr);
+
+	std::vector<VkPhysicalDevice> physicals(physical_count);
+	vkEnumeratePhysicalDevices(vkstate.instance, &physical_count, physicals.data());
+
+	VkPhysicalDeviceProperties physical_props;
+	VkPhysicalDeviceFeatures physical_features;
+	VkPhysicalDeviceMemoryProperties physical_mem_props;
+
+	{
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_VERBOSE, "Physical devices available:");
+
+		size_t best = 0;
+		size_t best_index = std::numeric_limits<size_t>::max();
+		for (size_t i = 0; i < physicals.size(); ++i) {
+			vkGetPhysicalDeviceProperties(physicals[i], &physical_props);
+			vkGetPhysicalDeviceFeatures(physicals[i], &physical_features);
+			vkGetPhysicalDeviceMemoryProperties(physicals[i], &physical_mem_props);
+
+			size_t score = 0;
+			if (physical_props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+				score += 10000;
+			}
+
+			score += physical_props.limits.maxImageDimension2D;
+			score += static_cast<size_t>(physical_props.limits.maxFramebufferWidth * physical_props.limits.maxFramebufferHeight) * 0.01f;
+
+			if (score > best) {
+				best = score;
+				best_index = i;
+			}
+
+			const char* const device_types[VK_PHYSICAL_DEVICE_TYPE_CPU + 1] = {
+				"Other",
+				"Integrated",
+				"Discrete",
+				"Virtual",
+				"CPU",
+			};
+
+			GLVKDEBUGF(GLVK_TYPE_VULKAN, GLVK_SEVERITY_VERBOSE, "    [{}] ({}) {}", device_types[physical_props.deviceType], score, physical_props.deviceName);
+		}
+
+		if (best_index == std::numeric_limits<size_t>::max()) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find GPU");
+			return 1;
+		}
+
+		vkstate.physical.device = physicals[best_index];
+	}
+
+	if (vkstate.physical.device == VK_NULL_HANDLE) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find GPU");
+		return 1;
+	}
+
+	vkGetPhysicalDeviceProperties(vkstate.physical.device, &vkstate.physical.properties);
+	vkGetPhysicalDeviceFeatures(vkstate.physical.device, &vkstate.physical.features);
+	vkGetPhysicalDeviceMemoryProperties(vkstate.physical.device, &vkstate.physical.memory_properties);
+	GLVKDEBUGF(GLVK_TYPE_VULKAN, GLVK_SEVERITY_VERBOSE, "Found GPU \"{}\"", vkstate.physical.properties.deviceName);
+
+	std::vector<layer_t> requested_device_layers;
+	std::vector<extension_t> requested_device_extensions;
+	if (!vkstate.headless) {
+		requested_device_extensions.push_back({ VK_KHR_SWAPCHAIN_EXTENSION_NAME, true });
+	}
+
+	/* descriptor indexing is core since 1.2 */
+	if (vkstate.physical.properties.apiVersion < VK_API_VERSION_1_2) {
+		requested_device_extensions.push_back({ VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME, false });
+	}
+
+	/* lets vertex array switches set vertex input without a pipeline per layout */
+	requested_device_extensions.push_back({ VK_EXT_VERTEX_INPUT_DYNAMIC_STATE_EXTENSION_NAME, false });
+
+	if (state.is_debug) {
+		requested_device_layers.push_back({ "VK_LAYER_KHRONOS_validation", false });
+	}
+
+	uint32_t device_layer_count = 0;
+	vkEnumerateDeviceLayerProperties(vkstate.physical.device, &device_layer_count, nullptr);
+
+	std::vector<VkLayerProperties> device_layer_props(device_layer_count);
+	vkEnumerateDeviceLayerProperties(vkstate.physical.device, &device_layer_count, device_layer_props.data());
+
+	std::vector<const char*> device_layer_names;
+	for (layer_t& layer : requested_device_layers) {
+		bool found = false;
+		for (VkLayerProperties& prop : device_layer_props) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, prop.layerName);
+			if (strcmp(prop.layerName, layer.name) == 0) {
+				found = true;
+				device_layer_names.push_back(layer.name);
+				break;
+			}
+		}
+
+		if (!found) {
+			if (layer.required) {
+				GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find required Vulkan device layer ", layer.name);
+				return 1;
+			} else {
+				GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_DEBUG, "Failed to find Vulkan device layer ", layer.name);
+			}
+		}
+	}
+
+	uint32_t device_extension_count = 0;
+	vkEnumerateDeviceExtensionProperties(vkstate.physical.device, nullptr, &device_extension_count, nullptr);
+
+	std::vector<VkExtensionProperties> device_extension_props(device_extension_count);
+	vkEnumerateDeviceExtensionProperties(vkstate.physical.device, nullptr, &device_extension_count, device_extension_props.data());
+
+	std::vector<const char*> device_extension_names;
+	for (extension_t& extension : requested_device_extensions) {
+		bool found = false;
+		for (VkExtensionProperties& prop : device_extension_props) {
+			if (strcmp(prop.extensionName, extension.name) == 0) {
+				found = true;
+				device_extension_names.push_back(extension.name);
+				break;
+			}
+		}
+
+		if (!found) {
+			if (extension.required) {
+				GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find required Vulkan device extension ", extension.name);
+				return 1;
+			} else {
+				GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_INFO, "Failed to find Vulkan device extension ", extension.name);
+			}
+		}
+	}
+
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(vkstate.physical.device, &queue_family_count, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queue_family_props(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(vkstate.physical.device, &queue_family_count, queue_family_props.data());
+
+	uint32_t gfx = std::numeric_limits<uint32_t>::max();
+	uint32_t prs = std::numeric_limits<uint32_t>::max();
+	for (uint32_t i = 0; i < queue_family_count; ++i) {
+		if (queue_family_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+			gfx = i;
+		}
+
+		/* headless frames are never presented, reuse the graphics family so only one queue is created */
+		VkBool32 present = vkstate.headless && gfx == i ? VK_TRUE : VK_FALSE;
+		if (!vkstate.headless) {
+			vkGetPhysicalDeviceSurfaceSupportKHR(vkstate.physical.device, i, vkstate.surface, &present);
+		}
+		if (present == VK_TRUE) {
+			prs = i;
+		}
+
+		if (gfx != std::numeric_limits<uint32_t>::max() && prs != std::numeric_limits<uint32_t>::max()) {
+			break;
+		}
+	}
+
+	if (gfx == std::numeric_limits<uint32_t>::max()) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find graphics queue family");
+		return 1;
+	}
+	if (prs == std::numeric_limits<uint32_t>::max()) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find present queue family");
+		return 1;
+	}
+
+	vkstate.queue_families = {
+		.graphics = gfx,
+		.present = prs,
+	};
+
+	vkstate.timestamp_bits = queue_family_props[gfx].timestampValidBits;
+	vkstate.timestamp_period = vkstate.physical.properties.limits.timestampPeriod;
+
+	uint32_t queue_families[] = {
+		vkstate.queue_families.graphics,
+		vkstate.queue_families.present,
+	};
+
+	float priority = 1.0f;
+	std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+
+	for (size_t i = 0; i < 2; ++i) {
+		VkDeviceQueueCreateInfo qcreate_info;
+		for (size_t j = 0; j < queue_create_infos.size(); ++j) {
+			if (queue_create_infos[j].queueFamilyIndex == queue_families[i]) {
+				goto next;
+			}
+		}
+
+		qcreate_info = {
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.queueFamilyIndex = queue_families[i],
+			.queueCount = 1,
+			.pQueuePriorities = &priority,
+		};
+
+		queue_create_infos.push_back(qcreate_info);
+	next:;
+	}
+
+	/* optional features that gl state maps onto, draws fall back when they are missing */
+	vkstate.features = {};
+	vkstate.features.fillModeNonSolid = vkstate.physical.features.fillModeNonSolid;
+	vkstate.features.geometryShader = vkstate.physical.features.geometryShader;
+	vkstate.features.samplerAnisotropy = vkstate.physical.features.samplerAnisotropy;
+
+	/* bindless descriptors need arrays that are partially bound and updated while frames using other elements are in flight */
+	VkPhysicalDeviceDescriptorIndexingFeatures indexing_features = {};
+	indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	bool indexing_available = vkstate.physical.properties.apiVersion >= VK_API_VERSION_1_2;
+	bool vertex_input_available = false;
+	for (const char* name : device_extension_names) {
+		indexing_available |= strcmp(name, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+		vertex_input_available |= strcmp(name, VK_EXT_VERTEX_INPUT_DYNAMIC_STATE_EXTENSION_NAME) == 0;
+	}
+
+	VkPhysicalDeviceVertexInputDynamicStateFeaturesEXT vertex_input_features = {};
+	vertex_input_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VERTEX_INPUT_DYNAMIC_STATE_FEATURES_EXT;
+
+	if (indexing_available || vertex_input_available) {
+		void* chain = nullptr;
+		if (vertex_input_available) {
+			vertex_input_features.pNext = chain;
+			chain = &vertex_input_features;
+		}
+		if (indexing_available) {
+			indexing_features.pNext = chain;
+			chain = &indexing_features;
+		}
+
+		VkPhysicalDeviceFeatures2 features2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = chain,
+			.features = {},
+		};
+		vkGetPhysicalDeviceFeatures2(vkstate.physical.device, &features2);
+	}
+
+	vkstate.vertex_input_dynamic = vertex_input_features.vertexInputDynamicState;
+
+	vkstate.bindless.supported =
+		indexing_features.runtimeDescriptorArray &&
+		indexing_features.descriptorBindingPartiallyBound &&
+		indexing_features.descriptorBindingUpdateUnusedWhilePending &&
+		indexing_features.descriptorBindingUniformBufferUpdateAfterBind &&
+		indexing_features.descriptorBindingStorageBufferUpdateAfterBind &&
+		indexing_features.descriptorBindingSampledImageUpdateAfterBind;
+
+	VkPhysicalDeviceDescriptorIndexingFeatures enabled_indexing_features = {};
+	enabled_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	if (vkstate.bindless.supported) {
+		enabled_indexing_features.runtimeDescriptorArray = VK_TRUE;
+		enabled_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+		enabled_indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		enabled_indexing_features.descriptorBindingUniformBufferUpdateAfterBind = VK_TRUE;
+		enabled_indexing_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		enabled_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		enabled_indexing_features.shaderSampledImageArrayNonUniformIndexing = indexing_features.shaderSampledImageArrayNonUniformIndexing;
+		enabled_indexing_features.shaderStorageBufferArrayNonUniformIndexing = indexing_features.shaderStorageBufferArrayNonUniformIndexing;
+	} else {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_INFO, "Device does not support descriptor indexing, descriptor sets are allocated per frame");
+	}
+
+	VkPhysicalDeviceVertexInputDynamicStateFeaturesEXT enabled_vertex_input_features = {};
+	enabled_vertex_input_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VERTEX_INPUT_DYNAMIC_STATE_FEATURES_EXT;
+	enabled_vertex_input_features.vertexInputDynamicState = VK_TRUE;
+
+	void* enabled_chain = nullptr;
+	if (vkstate.vertex_input_dynamic) {
+		enabled_vertex_input_features.pNext = enabled_chain;
+		enabled_chain = &enabled_vertex_input_features;
+	} else {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_INFO, "Device does not support dynamic vertex input, vertex layouts are part of the pipeline key");
+	}
+	if (vkstate.bindless.supported) {
+		enabled_indexing_features.pNext = enabled_chain;
+		enabled_chain = &enabled_indexing_features;
+	}
+
+	VkDeviceCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = enabled_chain,
+		.flags = 0,
+		.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size()),
+		.pQueueCreateInfos = queue_create_infos.data(),
+		.enabledLayerCount = static_cast<uint32_t>(device_layer_names.size()),
+		.ppEnabledLayerNames = device_layer_names.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(device_extension_names.size()),
+		.ppEnabledExtensionNames = device_extension_names.data(),
+		.pEnabledFeatures = &vkstate.features,
+	};
+
+	if (vkCreateDevice(vkstate.physical.device, &create_info, vkstate.allocator, &vkstate.device) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan device");
+		return 1;
+	}
+
+	vkstate.set_vertex_input = nullptr;
+	if (vkstate.vertex_input_dynamic) {
+		vkstate.set_vertex_input = reinterpret_cast<PFN_vkCmdSetVertexInputEXT>(vkGetDeviceProcAddr(vkstate.device, "vkCmdSetVertexInputEXT"));
+		vkstate.vertex_input_dynamic = vkstate.set_vertex_input != nullptr;
+	}
+
+	vkGetDeviceQueue(vkstate.device, vkstate.queue_families.graphics, 0, &vkstate.graphics_queue);
+	vkstate.present_queue = VK_NULL_HANDLE;
+	vkstate.swapchain_dirty = false;
+	vkstate.frame_count = (state.frames_in_flight == 0) ? GLVK_DEFAULT_FRAMES_IN_FLIGHT : state.frames_in_flight;
+
+	if (vkstate.headless) {
+		vkstate.surface_format = {
+			.format = VK_FORMAT_R8G8B8A8_SRGB,
+			.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
+		};
+
+		if (createOffscreenTargets(width, height) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create offscreen images");
+			return 1;
+		}
+	} else {
+		vkGetDeviceQueue(vkstate.device, vkstate.queue_families.present, 0, &vkstate.present_queue);
+		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vkstate.physical.device, vkstate.surface, &vkstate.surface_capabilities);
+
+		uint32_t surface_format_count = 0;
+		vkGetPhysicalDeviceSurfaceFormatsKHR(vkstate.physical.device, vkstate.surface, &surface_format_count, nullptr);
+		if (surface_format_count == 0) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find surface formats");
+			return 1;
+		}
+
+		std::vector<VkSurfaceFormatKHR> surface_formats(surface_format_count);
+		vkGetPhysicalDeviceSurfaceFormatsKHR(vkstate.physical.device, vkstate.surface, &surface_format_count, surface_formats.data());
+
+		uint32_t surface_format_index = std::numeric_limits<uint32_t>::max();
+		for (size_t i = 0; i < surface_formats.size(); ++i) {
+			if (surface_formats[i].format == VK_FORMAT_B8G8R8A8_SRGB && surface_formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+				surface_format_index = i;
+				break;
+			}
+		}
+
+		if (surface_format_index == std::numeric_limits<uint32_t>::max()) {
+			surface_format_index = 0;
+		}
+
+		uint32_t surface_modes_count = 0;
+		vkGetPhysicalDeviceSurfacePresentModesKHR(vkstate.physical.device, vkstate.surface, &surface_modes_count, nullptr);
+		if (surface_modes_count == 0) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find surface present modes");
+			return 1;
+		}
+
+		std::vector<VkPresentModeKHR> surface_modes(surface_modes_count);
+		vkGetPhysicalDeviceSurfacePresentModesKHR(vkstate.physical.device, vkstate.surface, &surface_modes_count, surface_modes.data());
+
+		uint32_t surface_mode_index = std::numeric_limits<uint32_t>::max();
+		for (size_t i = 0; i < surface_modes.size(); ++i) {
+			if (surface_modes[i] == VK_PRESENT_MODE_FIFO_KHR) {
+				surface_mode_index = i;
+			}
+			if (surface_modes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
+				surface_mode_index = i;
+				break;
+			}
+		}
+
+		if (surface_mode_index == std::numeric_limits<uint32_t>::max()) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find surface present mode");
+			return 1;
+		}
+
+		vkstate.surface_format = surface_formats[surface_format_index];
+		vkstate.surface_mode = surface_modes[surface_mode_index];
+		vkstate.extent = vkstate.surface_capabilities.currentExtent;
+		if (createSwapchain() != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create Vulkan swapchain");
+			return 1;
+		}
+	}
+
+	vkstate.depth.format = findDepthFormat();
+	if (vkstate.depth.format == VK_FORMAT_UNDEFINED) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to find depth format");
+		return 1;
+	}
+
+	VkImageLayout color_layout = colorLayout();
+
+	VkAttachmentDescription attachments[2] = {
+		{
+			.flags = 0,
+			.format = vkstate.surface_format.format,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.finalLayout = color_layout,
+		},
+		{
+			.flags = 0,
+			.format = vkstate.depth.format,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+			/* stored so a flushed frame can continue with the same depth contents */
+			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		},
+	};
+
+	VkAttachmentReference color_reference = {
+		.attachment = 0,
+		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	};
+
+	VkAttachmentReference depth_reference = {
+		.attachment = 1,
+		.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+	};
+
+	VkSubpassDescription subpass = {
+		.flags = 0,
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.inputAttachmentCount = 0,
+		.pInputAttachments = nullptr,
+		.colorAttachmentCount = 1,
+		.pColorAttachments = &color_reference,
+		.pResolveAttachments = nullptr,
+		.pDepthStencilAttachment = &depth_reference,
+		.preserveAttachmentCount = 0,
+		.pPreserveAttachments = nullptr,
+	};
+
+	/* also orders depth writes of consecutive frames, which all share the one depth image */
+	VkSubpassDependency subpass_dependency = {
+		.srcSubpass = VK_SUBPASS_EXTERNAL,
+		.dstSubpass = 0,
+		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+		.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		.dependencyFlags = 0,
+	};
+
+	VkRenderPassCreateInfo render_pass_create_info = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.attachmentCount = 2,
+		.pAttachments = attachments,
+		.subpassCount = 1,
+		.pSubpasses = &subpass,
+		.dependencyCount = 1,
+		.pDependencies = &subpass_dependency,
+	};
+
+	vkCreateRenderPass(vkstate.device, &render_pass_create_info, vkstate.allocator, &vkstate.render_pass);
+
+	/* only load ops and layouts differ, so the two render passes are compatible and share pipelines */
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[0].initialLayout = color_layout;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	vkCreateRenderPass(vkstate.device, &render_pass_create_info, vkstate.allocator, &vkstate.render_pass_load);
+
+	if (createSwapchainTargets() != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create framebuffers");
+		return 1;
+	}
+
+	std::ifstream vshader_file("assets/shaders/vert.spv", std::ios::ate | std::ios::binary);
+	std::ifstream fshader_file("assets/shaders/frag.spv", std::ios::ate | std::ios::binary);
+	if (!vshader_file.is_open()) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to open assets/shaders/vert.spv");
+		return 1;
+	}
+	if (!fshader_file.is_open()) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_ERROR, "Failed to open assets/shaders/frag.spv");
+		return 1;
+	}
+
+	size_t size = vshader_file.tellg();
+	std::vector<uint8_t> v_spv(size);
+	vshader_file.seekg(0);
+	vshader_file.read(reinterpret_cast<char*>(v_spv.data()), size);
+	vshader_file.close();
+
+	size = fshader_file.tellg();
+	std::vector<uint8_t> f_spv(size);
+	fshader_file.seekg(0);
+	fshader_file.read(reinterpret_cast<char*>(f_spv.data()), size);
+	fshader_file.close();
+
+	VkShaderModuleCreateInfo vshader_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.codeSize = v_spv.size(),
+		.pCode = reinterpret_cast<const uint32_t*>(v_spv.data()),
+	};
+
+	if (vkCreateShaderModule(vkstate.device, &vshader_create_info, vkstate.allocator, &vkstate.vshader) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create vertex shader module");
+		return 1;
+	}
+
+	VkShaderModuleCreateInfo fshader_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.codeSize = f_spv.size(),
+		.pCode = reinterpret_cast<const uint32_t*>(f_spv.data()),
+	};
+
+	if (vkCreateShaderModule(vkstate.device, &fshader_create_info, vkstate.allocator, &vkstate.fshader) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create fragment shader module");
+		return 1;
+	}
+
+	if (createDescriptorLayout() != VK_SUCCESS || createUniformLayout() != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create descriptor set layout");
+		return 1;
+	}
+
+	VkPushConstantRange push_constant_range = {
+		.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+		.offset = 0,
+		.size = sizeof(pushconstants_t),
+	};
+
+	VkDescriptorSetLayout set_layouts[2] = { vkstate.desc_layout, vkstate.uniform_layout };
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.setLayoutCount = 2,
+		.pSetLayouts = set_layouts,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &push_constant_range,
+	};
+
+	if (vkCreatePipelineLayout(vkstate.device, &pipeline_layout_create_info, vkstate.allocator, &vkstate.pipeline_layout) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create pipeline layout");
+		return 1;
+	}
+
+	if (createPipelineCache() != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create pipeline cache");
+		return 1;
+	}
+
+	vkstate.pipelines.hits = 0;
+	vkstate.pipelines.misses = 0;
+	vkstate.pipelines.compile_ns = 0;
+	vkstate.pipelines.max_compile_ns = 0;
+
+	vkstate.shaders.cache_path = state.shader_cache_set ? state.shader_cache_path : GLVK_DEFAULT_SHADER_CACHE_PATH;
+	vkstate.shaders.link_count = 0;
+	vkstate.shaders.cache_hits = 0;
+	vkstate.shaders.compiles = 0;
+	vkstate.shaders.compile_ns = 0;
+#ifdef GLVK_GLSLANG
+	glslang_initialize_process();
+#endif
+
+	/* layout 0 is the built-in vertex format read from the array buffer while no vertex array is bound */
+	vertexlayout_t builtin_layout;
+	memset(&builtin_layout, 0, sizeof(builtin_layout));
+	builtin_layout.binding_count = 1;
+	builtin_layout.attribute_count = 1;
+	builtin_layout.bindings[0] = {
+		.binding = 0,
+		.stride = sizeof(vertex_t),
+		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+	};
+	builtin_layout.attributes[0] = {
+		.location = 0,
+		.binding = 0,
+		.format = VK_FORMAT_R32G32B32_SFLOAT,
+		.offset = offsetof(vertex_t, pos),
+	};
+	vkstate.vertex_layouts.push_back(builtin_layout);
+	vkstate.vertex_layout_lookup[0] = 0;
+
+	/* gl's initial state */
+	glstate.raster = {
+		.cull_face = false,
+		.cull_mode = GL_BACK,
+		.front_face = GL_CCW,
+		.polygon_mode = GL_FILL,
+		.rasterizer_discard = false,
+		.primitive_restart = false,
+		.depth_test = false,
+		.depth_write = true,
+		.depth_func = GL_LESS,
+		.blend = false,
+		.blend_src_rgb = GL_ONE,
+		.blend_dst_rgb = GL_ZERO,
+		.blend_src_alpha = GL_ONE,
+		.blend_dst_alpha = GL_ZERO,
+		.blend_equation_rgb = GL_FUNC_ADD,
+		.blend_equation_alpha = GL_FUNC_ADD,
+		.color_mask = { GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE },
+	};
+	memset(glstate.blend_color, 0, sizeof(glstate.blend_color));
+	glstate.indexed_buffers = {};
+	for (glindexedbinding_t& binding : glstate.indexed_buffers.uniform) {
+		binding.slot = GLVK_NO_DESCRIPTOR;
+	}
+	for (glindexedbinding_t& binding : glstate.indexed_buffers.storage) {
+		binding.slot = GLVK_NO_DESCRIPTOR;
+	}
+	memset(&glstate.bindings, 0xFF, sizeof(glstate.bindings));
+	glstate.binding_set = {};
+	glstate.uniforms = {};
+	glstate.dirty = DIRTY_PIPELINE | DIRTY_VIEWPORT | DIRTY_BLEND_CONSTANTS | DIRTY_DESCRIPTORS | DIRTY_VERTEX_INPUT | DIRTY_VERTEX_BUFFERS;
+	glstate.pipeline = VK_NULL_HANDLE;
+	glstate.topology = VK_PRIMITIVE_TOPOLOGY_MAX_ENUM;
+	glstate.bound_vao = 0;
+	glstate.default_element_array = 0;
+	glstate.vertex_layout = 0;
+	glstate.vertex_input = GLVK_NO_DESCRIPTOR;
+	glstate.vertex_buffers = {};
+	for (gltextureunit_t& unit : glstate.texture_units) {
+		unit = { .texture = 0, .sampler = 0, .slot = GLVK_NO_DESCRIPTOR };
+	}
+	glstate.texture_mask = 0;
+	glstate.active_texture = 0;
+	glstate.program = 0;
+	glstate.unpack = {
+		.alignment = 4,
+		.row_length = 0,
+		.skip_rows = 0,
+		.skip_pixels = 0,
+	};
+	glstate.pack = glstate.unpack;
+	glstate.viewport_set = false;
+	glstate.scissor_set = false;
+	glstate.scissor_test = false;
+	vkstate.state_stats = {};
+
+	vkstate.frame_index = 0;
+	vkstate.frame_number = 0;
+	vkstate.drawn_frame = 0;
+	vkstate.completed_frame = 0;
+	vkstate.frame_prepared = false;
+	vkstate.frame_active = false;
+	vkstate.frames.resize(vkstate.frame_count);
+
+	for (GLVKvkframe& frame : vkstate.frames) {
+		VkCommandPoolCreateInfo command_pool_create_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = vkstate.queue_families.graphics,
+		};
+
+		if (vkCreateCommandPool(vkstate.device, &command_pool_create_info, vkstate.allocator, &frame.command_pool) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create command pool");
+			return 1;
+		}
+
+		VkCommandBufferAllocateInfo command_buffer_allocate_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext = nullptr,
+			.commandPool = frame.command_pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+
+		if (vkAllocateCommandBuffers(vkstate.device, &command_buffer_allocate_info, &frame.command_buffer) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to allocate command buffer");
+			return 1;
+		}
+
+		if (vkAllocateCommandBuffers(vkstate.device, &command_buffer_allocate_info, &frame.upload_buffer) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to allocate command buffer");
+			return 1;
+		}
+
+		VkSemaphoreCreateInfo semaphore_create_info = {
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+		};
+
+		if (vkCreateSemaphore(vkstate.device, &semaphore_create_info, vkstate.allocator, &frame.image_available) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create semaphore");
+			return 1;
+		}
+
+		VkFenceCreateInfo fence_create_info = {
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = VK_FENCE_CREATE_SIGNALED_BIT,
+		};
+
+		if (vkCreateFence(vkstate.device, &fence_create_info, vkstate.allocator, &frame.in_flight_fence) != VK_SUCCESS) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create fence");
+			return 1;
+		}
+
+		frame.query_pool = VK_NULL_HANDLE;
+		if (vkstate.timestamp_bits != 0) {
+			VkQueryPoolCreateInfo query_pool_create_info = {
+				.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+				.pNext = nullptr,
+				.flags = 0,
+				.queryType = VK_QUERY_TYPE_TIMESTAMP,
+				.queryCount = GLVK_FRAME_QUERY_COUNT,
+				.pipelineStatistics = 0,
+			};
+
+			if (vkCreateQueryPool(vkstate.device, &query_pool_create_info, vkstate.allocator, &frame.query_pool) != VK_SUCCESS) {
+				GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create query pool");
+				return 1;
+			}
+		}
+
+		frame.number = 0;
+		frame.image_wait = false;
+		frame.upload_active = false;
+		frame.staging_end = 0;
+		frame.query_count = 0;
+		frame.query_reset_frame = 0;
+		frame.timed = false;
+		frame.uniform_chunk = 0;
+		frame.uniform_offset = 0;
+	}
+	vkstate.frame_stats = {};
+
+	vkstate.staging.size = GLVK_STAGING_SIZE;
+	vkstate.staging.head = 0;
+	vkstate.staging.tail = 0;
+	if (createBuffer(vkstate.staging.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, vkstate.staging.buffer, vkstate.staging.memory) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create staging buffer");
+		return 1;
+	}
+
+	VkCommandPoolCreateInfo immediate_pool_create_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = vkstate.queue_families.graphics,
+	};
+
+	if (vkCreateCommandPool(vkstate.device, &immediate_pool_create_info, vkstate.allocator, &vkstate.immediate_pool) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create command pool");
+		return 1;
+	}
+
+	VkCommandBufferAllocateInfo immediate_buffer_allocate_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.commandPool = vkstate.immediate_pool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	};
+
+	if (vkAllocateCommandBuffers(vkstate.device, &immediate_buffer_allocate_info, &vkstate.immediate_buffer) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to allocate command buffer");
+		return 1;
+	}
+
+	if (createRecorders() != 0) {
+		return 1;
+	}
+
+	if (state.threaded) {
+		commandStart();
+	}
+
+	state.inited = true;
+	GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Initialization success");
+	return 0;
+}
+
+int glvkInit(GLVKwindow window) {
+	return initialize(window, false, 0, 0);
+}
+
+int glvkInitHeadless(unsigned int width, unsigned int height) {
+	return initialize({}, true, width, height);
+}
+
+/* monotonic clock for the frame statistics, in nanoseconds */
+static uint64_t cpuTime() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* nanoseconds between two timestamps of the graphics queue, which wrap at its valid bits */
+static uint64_t timestampDelta(uint64_t begin, uint64_t end) {
+	uint64_t mask = vkstate.timestamp_bits >= 64 ? std::numeric_limits<uint64_t>::max() : (1ull << vkstate.timestamp_bits) - 1;
+	return static_cast<uint64_t>(static_cast<double>((end - begin) & mask) * vkstate.timestamp_period);
+}
+
+/* reads the slot's timestamps as value/availability pairs, fails while the reset that opened them may not have run yet */
+static bool readTimestamps(GLVKvkframe& frame, uint64_t* results) {
+	if (frame.query_count == 0 || frame.query_reset_frame > vkstate.completed_frame) {
+		return false;
+	}
+
+	VkResult res = vkGetQueryPoolResults(vkstate.device, frame.query_pool, 0, frame.query_count, frame.query_count * 2 * sizeof(uint64_t), results, 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	return res == VK_SUCCESS || res == VK_NOT_READY;
+}
+
+/* copies the available timestamps of the slot into the gl queries that wrote them */
+static void resolveQueries(GLVKvkframe& frame, const uint64_t* results) {
+	auto resolved = std::remove_if(frame.timestamp_refs.begin(), frame.timestamp_refs.end(), [results](const timestampref_t& ref) {
+		if (results[ref.index * 2 + 1] == 0) {
+			return false;
+		}
+
+		glquery_t* query = glstate.queries.get(ref.query);
+		if (query != nullptr && query->serial == ref.serial) {
+			query->ticks[ref.which] = results[ref.index * 2];
+			query->pending &= ~(1u << ref.which);
+		}
+		return true;
+	});
+
+	frame.timestamp_refs.erase(resolved, frame.timestamp_refs.end());
+}
+
+/* publishes the timings of the frame that last ran in the slot, results is null when it wrote no timestamps */
+static void reportFrame(GLVKvkframe& frame, const uint64_t* results) {
+	auto elapsed = [results](uint32_t begin, uint32_t end) -> uint64_t {
+		if (results == nullptr || begin == std::numeric_limits<uint32_t>::max() || end == std::numeric_limits<uint32_t>::max() || results[begin * 2 + 1] == 0 || results[end * 2 + 1] == 0) {
+			return 0;
+		}
+		return timestampDelta(results[begin * 2], results[end * 2]);
+	};
+
+	GLVKframestats& stats = vkstate.frame_stats;
+	stats.frame = frame.number;
+	stats.cpu_ns = frame.cpu_ns;
+	stats.fence_ns = frame.fence_ns;
+	stats.acquire_ns = frame.acquire_ns;
+	stats.submit_ns = frame.submit_ns;
+	stats.present_ns = frame.present_ns;
+	stats.gpu_ns = elapsed(0, 1);
+	stats.scope_count = static_cast<unsigned int>(std::min<size_t>(frame.scopes.size(), GLVK_MAX_FRAME_SCOPES));
+	for (unsigned int i = 0; i < stats.scope_count; ++i) {
+		const framescope_t& scope = frame.scopes[i];
+		stats.scopes[i] = {
+			.name = scope.name,
+			.depth = scope.depth,
+			.cpu_ns = scope.cpu_ns,
+			.gpu_ns = elapsed(scope.begin, scope.end),
+		};
+	}
+}
+
+/* waits for the current frame slot to retire so its command buffers may be recorded again */
+static GLVKvkframe& prepareFrame() {
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	if (vkstate.frame_prepared) {
+		return frame;
+	}
+
+	uint64_t fence_begin = cpuTime();
+	vkWaitForFences(vkstate.device, 1, &frame.in_flight_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	uint64_t fence_ns = cpuTime() - fence_begin;
+	vkResetCommandPool(vkstate.device, frame.command_pool, 0);
+	for (GLVKvkrecorder& recorder : recording.recorders) {
+		vkResetCommandPool(vkstate.device, recorder.pools[vkstate.frame_index], 0);
+		recorder.used[vkstate.frame_index] = 0;
+	}
+
+	/* everything this slot copied out of the staging ring has now been consumed */
+	if (frame.staging_end > vkstate.staging.tail) {
+		vkstate.staging.tail = frame.staging_end;
+	}
+
+	if (frame.number > vkstate.completed_frame) {
+		vkstate.completed_frame = frame.number;
+	}
+
+	/* everything the slot wrote is available now, the pool is reset by the next frame */
+	uint64_t results[GLVK_FRAME_QUERY_COUNT * 2];
+	bool timestamps = readTimestamps(frame, results);
+	if (timestamps) {
+		resolveQueries(frame, results);
+	}
+	if (frame.timed) {
+		reportFrame(frame, timestamps ? results : nullptr);
+	}
+
+	frame.push_constants.clear();
+	frame.descriptor_sets.clear();
+	frame.viewports.clear();
+	frame.vertex_buffers.clear();
+	for (VkDescriptorPool pool : frame.descriptor_pools) {
+		vkResetDescriptorPool(vkstate.device, pool, 0);
+	}
+	frame.descriptor_pool_index = 0;
+	frame.descriptor_cache.clear();
+	frame.uniform_chunk = 0;
+	frame.uniform_offset = 0;
+
+	frame.query_count = 0;
+	frame.timestamp_refs.clear();
+	frame.scopes.clear();
+	frame.open_scopes.clear();
+	frame.timed = false;
+	frame.fence_ns = fence_ns;
+	frame.acquire_ns = 0;
+
+	for (bufferstore_t& store : frame.retired_buffers) {
+		recycleBufferStore(store);
+	}
+	frame.retired_buffers.clear();
+	trimBufferPool();
+	for (imagestore_t& store : frame.retired_images) {
+		destroyImageStore(store);
+	}
+	frame.retired_images.clear();
+	for (VkSampler sampler : frame.retired_samplers) {
+		destroySampler(sampler);
+	}
+	frame.retired_samplers.clear();
+	for (VkPipeline pipeline : frame.retired_pipelines) {
+		vkDestroyPipeline(vkstate.device, pipeline, vkstate.allocator);
+	}
+	frame.retired_pipelines.clear();
+
+	frame.upload_active = false;
+	frame.number = ++vkstate.frame_number;
+	frame.record_begin = cpuTime();
+	vkstate.frame_prepared = true;
+	return frame;
+}
+
+/* the viewport and scissor rectangles of the gl state. gl window coordinates are framebuffer coordinates since the viewport is not flipped */
+static viewportstate_t currentViewport() {
+	viewportstate_t current = {
+		.viewport = vkstate.viewport,
+		.scissor = vkstate.scissor,
+	};
+
+	if (glstate.viewport_set) {
+		const VkPhysicalDeviceLimits& limits = vkstate.physical.properties.limits;
+		current.viewport.x = static_cast<float>(glstate.viewport[0]);
+		current.viewport.y = static_cast<float>(glstate.viewport[1]);
+		current.viewport.width = static_cast<float>(std::clamp<uint32_t>(static_cast<uint32_t>(glstate.viewport[2]), 1, limits.maxViewportDimensions[0]));
+		current.viewport.height = static_cast<float>(std::clamp<uint32_t>(static_cast<uint32_t>(glstate.viewport[3]), 1, limits.maxViewportDimensions[1]));
+	}
+
+	if (glstate.scissor_test && glstate.scissor_set) {
+		int64_t x0 = std::max(glstate.scissor_box[0], 0);
+		int64_t y0 = std::max(glstate.scissor_box[1], 0);
+		int64_t x1 = std::min(static_cast<int64_t>(glstate.scissor_box[0]) + glstate.scissor_box[2], static_cast<int64_t>(std::numeric_limits<int32_t>::max()));
+		int64_t y1 = std::min(static_cast<int64_t>(glstate.scissor_box[1]) + glstate.scissor_box[3], static_cast<int64_t>(std::numeric_limits<int32_t>::max()));
+		current.scissor = {
+			.offset = { static_cast<int32_t>(x0), static_cast<int32_t>(y0) },
+			.extent = { static_cast<uint32_t>(std::max<int64_t>(x1 - x0, 0)), static_cast<uint32_t>(std::max<int64_t>(y1 - y0, 0)) },
+		};
+	}
+
+	/* vulkan has no empty viewport, an empty scissor draws the same nothing */
+	if (glstate.viewport_set && (glstate.viewport[2] == 0 || glstate.viewport[3] == 0)) {
+		current.scissor.extent = { 0, 0 };
+	}
+
+	return current;
+}
+
+/* begins the render pass on the acquired image, the dynamic state does not survive it and is set again */
+static void beginRenderPass(GLVKvkframe& frame, VkRenderPass render_pass) {
+	VkClearValue clear_values[2] = {
+		{ .color = { .float32 = { 0.0f, 0.0f, 0.0f, 1.0f } } },
+		{ .depthStencil = { .depth = 1.0f, .stencil = 0 } },
+	};
+
+	VkRenderPassBeginInfo render_pass_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+		.pNext = nullptr,
+		.renderPass = render_pass,
+		.framebuffer = vkstate.framebuffers[vkstate.image_index],
+		.renderArea = {
+			.offset = { 0, 0 },
+			.extent = vkstate.extent,
+		},
+		.clearValueCount = 2,
+		.pClearValues = clear_values,
+	};
+
+	vkstate.active_render_pass = render_pass;
+	/* the bindings are pushed again with the next draw, the dynamic state is set right here */
+	glstate.dirty |= DIRTY_DESCRIPTORS | DIRTY_VERTEX_INPUT | DIRTY_VERTEX_BUFFERS;
+	glstate.dirty &= ~(DIRTY_VIEWPORT | DIRTY_BLEND_CONSTANTS);
+	glstate.uniforms.bound = false;
+	frame.viewports.push_back(currentViewport());
+	if (recordSecondary()) {
+		/* everything inside the pass comes from secondary command buffers, which set the dynamic state themselves */
+		vkCmdBeginRenderPass(frame.command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		memcpy(frame.packet_blend_color, glstate.blend_color, sizeof(frame.packet_blend_color));
+		frame.packet_viewport = static_cast<uint32_t>(frame.viewports.size() - 1);
+		frame.packet_push_constants = GLVK_NO_DESCRIPTOR;
+		frame.packet_descriptor_set = GLVK_NO_DESCRIPTOR;
+		frame.packet_uniform_chunk = GLVK_NO_DESCRIPTOR;
+		frame.packet_vertex_buffers = GLVK_NO_DESCRIPTOR;
+		frame.packet_vertex_input = GLVK_NO_DESCRIPTOR;
+		return;
+	}
+
+	vkCmdBeginRenderPass(frame.command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+	vkCmdSetViewport(frame.command_buffer, 0, 1, &frame.viewports.back().viewport);
+	vkCmdSetScissor(frame.command_buffer, 0, 1, &frame.viewports.back().scissor);
+	vkCmdSetBlendConstants(frame.command_buffer, glstate.blend_color);
+	if (vkstate.bindless.supported) {
+		vkCmdBindDescriptorSets(frame.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkstate.pipeline_layout, 0, 1, &vkstate.bindless.set, 0, nullptr);
+	}
+	collectStateStats(vkstate.bound);
+	vkstate.bound = {};
+}
+
+/* opens the slot's command buffer and the render pass on the acquired image */
+static void beginCommands(GLVKvkframe& frame, VkRenderPass render_pass) {
+	VkCommandBufferBeginInfo command_buffer_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr,
+	};
+
+	vkBeginCommandBuffer(frame.command_buffer, &command_buffer_begin_info);
+
+	/* the frame's first command buffer resets the slot's timestamps and marks where the frame starts */
+	if (frame.query_pool != VK_NULL_HANDLE && frame.query_count == 0) {
+		vkCmdResetQueryPool(frame.command_buffer, frame.query_pool, 0, GLVK_FRAME_QUERY_COUNT);
+		vkCmdWriteTimestamp(frame.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.query_pool, 0);
+		frame.query_count = 2;
+		frame.query_reset_frame = frame.number;
+	}
+
+	beginRenderPass(frame, render_pass);
+}
+
+/* writes a timestamp into the recording frame, returns its query index or UINT32_MAX when the slot has none left */
+static uint32_t writeTimestamp(GLVKvkframe& frame, VkPipelineStageFlagBits stage) {
+	if (frame.query_count == 0 || frame.query_count >= GLVK_FRAME_QUERY_COUNT) {
+		return std::numeric_limits<uint32_t>::max();
+	}
+
+	submitPacket(frame, {
+		.type = PACKET_TIMESTAMP,
+		.count = static_cast<uint32_t>(stage),
+		.instance_count = 0,
+		.first = frame.query_count,
+		.pipeline = VK_NULL_HANDLE,
+		.vertex_buffer = VK_NULL_HANDLE,
+		.index_buffer = VK_NULL_HANDLE,
+		.index_type = VK_INDEX_TYPE_UINT16,
+		.blend_color = {},
+	});
+	return frame.query_count++;
+}
+
+static void endScope(GLVKvkframe& frame) {
+	framescope_t& scope = frame.scopes[frame.open_scopes.back()];
+	frame.open_scopes.pop_back();
+	scope.end = writeTimestamp(frame, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	scope.cpu_ns = cpuTime() - scope.cpu_begin;
+}
+
+/* acquires a swapchain image and opens the slot's command buffer and render pass */
+static bool beginFrame() {
+	if (vkstate.frame_active) {
+		return true;
+	}
+
+	if (vkstate.swapchain_dirty && !recreateSwapchain()) {
+		return false;
+	}
+
+	GLVKvkframe& frame = prepareFrame();
+
+	if (vkstate.headless) {
+		/* the slot's own image, which its fence has already freed */
+		vkstate.image_index = vkstate.frame_index;
+		frame.image_wait = false;
+		beginCommands(frame, vkstate.render_pass);
+		vkstate.frame_active = true;
+		return true;
+	}
+
+	uint64_t acquire_begin = cpuTime();
+	VkResult res = vkAcquireNextImageKHR(vkstate.device, vkstate.swapchain, std::numeric_limits<uint64_t>::max(), frame.image_available, VK_NULL_HANDLE, &vkstate.image_index);
+	if (res == VK_ERROR_OUT_OF_DATE_KHR) {
+		/* nothing was acquired and the semaphore is untouched, so the acquire can simply be retried on the new swapchain */
+		if (!recreateSwapchain()) {
+			return false;
+		}
+
+		res = vkAcquireNextImageKHR(vkstate.device, vkstate.swapchain, std::numeric_limits<uint64_t>::max(), frame.image_available, VK_NULL_HANDLE, &vkstate.image_index);
+	}
+
+	if (res == VK_SUBOPTIMAL_KHR) {
+		/* the image is still presentable, finish this frame and rebuild afterwards */
+		vkstate.swapchain_dirty = true;
+	} else if (res != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to acquire swapchain image");
+		return false;
+	}
+
+	/* with more slots than swapchain images the acquired image may still be rendered to by another slot */
+	VkFence& image_fence = vkstate.image_fences[vkstate.image_index];
+	if (image_fence != VK_NULL_HANDLE && image_fence != frame.in_flight_fence) {
+		vkWaitForFences(vkstate.device, 1, &image_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+	image_fence = frame.in_flight_fence;
+	frame.acquire_ns += cpuTime() - acquire_begin;
+
+	frame.image_wait = true;
+	beginCommands(frame, vkstate.render_pass);
+
+	vkstate.frame_active = true;
+	return true;
+}
+
+/* returns the current slot's upload command buffer, opening it if this is the first upload of the frame */
+static VkCommandBuffer uploadCommandBuffer() {
+	GLVKvkframe& frame = prepareFrame();
+	if (frame.upload_active) {
+		return frame.upload_buffer;
+	}
+
+	VkCommandBufferBeginInfo command_buffer_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr,
+	};
+
+	vkBeginCommandBuffer(frame.upload_buffer, &command_buffer_begin_info);
+
+	/* uploads may land in memory that earlier frames on this queue are still reading */
+	vkCmdPipelineBarrier(frame.upload_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	frame.upload_active = true;
+	return frame.upload_buffer;
+}
+
+/* makes the current slot's uploads visible to everything recorded after them and closes the upload command buffer.
+ * every image written moves back to being sampled in the same barrier */
+static void endUploads(GLVKvkframe& frame) {
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+	};
+
+	vkCmdPipelineBarrier(frame.upload_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, static_cast<uint32_t>(frame.upload_images.size()), frame.upload_images.data());
+	vkEndCommandBuffer(frame.upload_buffer);
+	frame.upload_images.clear();
+
+	frame.upload_active = false;
+	frame.staging_end = vkstate.staging.head;
+}
+
+/* submits everything recorded for the current frame so far and waits for it to finish, recording then continues in the same frame.
+ * used when the cpu needs results of the frame (readbacks, synchronized maps) or the staging ring runs out of space */
+static void flushFrame() {
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	if (!vkstate.frame_prepared || (!frame.upload_active && !vkstate.frame_active)) {
+		return;
+	}
+
+	VkCommandBuffer command_buffers[2];
+	uint32_t command_buffer_count = 0;
+	if (frame.upload_active) {
+		endUploads(frame);
+		command_buffers[command_buffer_count++] = frame.upload_buffer;
+	}
+
+	if (vkstate.frame_active) {
+		recordPackets(frame);
+		vkCmdEndRenderPass(frame.command_buffer);
+		vkEndCommandBuffer(frame.command_buffer);
+		command_buffers[command_buffer_count++] = frame.command_buffer;
+	}
+
+	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = nullptr,
+		.waitSemaphoreCount = frame.image_wait ? 1u : 0u,
+		.pWaitSemaphores = &frame.image_available,
+		.pWaitDstStageMask = wait_stages,
+		.commandBufferCount = command_buffer_count,
+		.pCommandBuffers = command_buffers,
+		.signalSemaphoreCount = 0,
+		.pSignalSemaphores = nullptr,
+	};
+
+	if (vkQueueSubmit(vkstate.graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to submit frame");
+	}
+
+	frame.image_wait = false;
+	vkQueueWaitIdle(vkstate.graphics_queue);
+
+	vkstate.staging.tail = vkstate.staging.head;
+	vkstate.completed_frame = frame.number;
+	frame.number = ++vkstate.frame_number;
+
+	if (vkstate.frame_active) {
+		beginCommands(frame, vkstate.render_pass_load);
+	}
+}
+
+/* waits until the given frame has finished on the gpu, flushing it first if it is still being recorded */
+static void waitForFrame(uint64_t number) {
+	if (number <= vkstate.completed_frame) {
+		return;
+	}
+
+	if (vkstate.frame_prepared && number >= vkstate.frames[vkstate.frame_index].number) {
+		flushFrame();
+		return;
+	}
+
+	/* fences signal in submission order, so the oldest slot at or past number covers it */
+	GLVKvkframe* oldest = nullptr;
+	for (uint32_t i = 0; i < vkstate.frame_count; ++i) {
+		GLVKvkframe& frame = vkstate.frames[i];
+		if (vkstate.frame_prepared && i == vkstate.frame_index) {
+			continue;
+		}
+
+		if (frame.number >= number && (oldest == nullptr || frame.number < oldest->number)) {
+			oldest = &frame;
+		}
+	}
+
+	if (oldest == nullptr) {
+		return;
+	}
+
+	vkWaitForFences(vkstate.device, 1, &oldest->in_flight_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	vkstate.completed_frame = oldest->number;
+}
+
+/* opens the command buffer for synchronous work, submitImmediate runs it and waits */
+static VkCommandBuffer beginImmediate() {
+	VkCommandBufferBeginInfo command_buffer_begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr,
+	};
+
+	vkBeginCommandBuffer(vkstate.immediate_buffer, &command_buffer_begin_info);
+	return vkstate.immediate_buffer;
+}
+
+static void submitImmediate() {
+	vkEndCommandBuffer(vkstate.immediate_buffer);
+
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = nullptr,
+		.waitSemaphoreCount = 0,
+		.pWaitSemaphores = nullptr,
+		.pWaitDstStageMask = nullptr,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &vkstate.immediate_buffer,
+		.signalSemaphoreCount = 0,
+		.pSignalSemaphores = nullptr,
+	};
+
+	if (vkQueueSubmit(vkstate.graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to submit immediate commands");
+	}
+
+	vkQueueWaitIdle(vkstate.graphics_queue);
+}
+
+/* reserves size bytes of the staging ring, returns false when the ring is full until in-flight frames retire */
+static bool stagingReserve(VkDeviceSize size, VkDeviceSize& offset) {
+	if (vkstate.staging.head == vkstate.staging.tail) {
+		/* the ring is empty, restart at its beginning so large reservations are not split by the wrap point */
+		vkstate.staging.head = ((vkstate.staging.head + vkstate.staging.size - 1) / vkstate.staging.size) * vkstate.staging.size;
+		vkstate.staging.tail = vkstate.staging.head;
+	}
+
+	VkDeviceSize start = (vkstate.staging.head + GLVK_STAGING_ALIGNMENT - 1) & ~static_cast<VkDeviceSize>(GLVK_STAGING_ALIGNMENT - 1);
+	if ((start % vkstate.staging.size) + size > vkstate.staging.size) {
+		/* never wrap a reservation around the end of the ring */
+		start += vkstate.staging.size - (start % vkstate.staging.size);
+	}
+
+	if (start + size - vkstate.staging.tail > vkstate.staging.size) {
+		return false;
+	}
+
+	vkstate.staging.head = start + size;
+	offset = start % vkstate.staging.size;
+	return true;
+}
+
+/* orders transfers against earlier transfers in the same command buffer, which may touch the same bytes */
+static void transferBarrier(VkCommandBuffer cb) {
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+	};
+
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+/* reserves size bytes of the staging ring for an upload, flushing the frame or waiting for frames in flight when it is full.
+ * size is at most a quarter of the ring */
+static VkDeviceSize stagingAcquire(VkDeviceSize size) {
+	VkDeviceSize offset;
+	if (!stagingReserve(size, offset)) {
+		flushFrame();
+		if (!stagingReserve(size, offset)) {
+			/* nothing recorded in this frame yet, the remaining space belongs to frames still in flight */
+			vkQueueWaitIdle(vkstate.graphics_queue);
+			vkstate.staging.tail = vkstate.staging.head;
+			stagingReserve(size, offset);
+		}
+	}
+
+	return offset;
+}
+
+/* copies data into dst through the staging ring, the copy executes before the current frame's commands */
+static void uploadBuffer(VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	while (size > 0) {
+		VkDeviceSize chunk = std::min(size, vkstate.staging.size / 4);
+		VkDeviceSize offset = stagingAcquire(chunk);
+
+		memcpy(static_cast<uint8_t*>(vkstate.staging.memory.mapped) + offset, bytes, chunk);
+
+		VkBufferCopy region = {
+			.srcOffset = offset,
+			.dstOffset = dst_offset,
+			.size = chunk,
+		};
+
+		VkCommandBuffer cb = uploadCommandBuffer();
+		transferBarrier(cb);
+		vkCmdCopyBuffer(cb, vkstate.staging.buffer, dst, 1, &region);
+
+		bytes += chunk;
+		dst_offset += chunk;
+		size -= chunk;
+	}
+}
+
+/* closes and submits the current frame slot, presents it and advances to the next slot without waiting on the gpu */
+static void endFrame() {
+	if (!vkstate.frame_active) {
+		return;
+	}
+
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	if (!frame.open_scopes.empty()) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Scopes left open are closed with the frame");
+		while (!frame.open_scopes.empty()) {
+			endScope(frame);
+		}
+	}
+
+	recordPackets(frame);
+	vkCmdEndRenderPass(frame.command_buffer);
+	if (frame.query_count != 0) {
+		vkCmdWriteTimestamp(frame.command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.query_pool, 1);
+	}
+	vkEndCommandBuffer(frame.command_buffer);
+
+	VkCommandBuffer command_buffers[2];
+	uint32_t command_buffer_count = 0;
+	if (frame.upload_active) {
+		endUploads(frame);
+		command_buffers[command_buffer_count++] = frame.upload_buffer;
+	}
+	command_buffers[command_buffer_count++] = frame.command_buffer;
+
+	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = nullptr,
+		.waitSemaphoreCount = frame.image_wait ? 1u : 0u,
+		.pWaitSemaphores = &frame.image_available,
+		.pWaitDstStageMask = wait_stages,
+		.commandBufferCount = command_buffer_count,
+		.pCommandBuffers = command_buffers,
+		.signalSemaphoreCount = vkstate.headless ? 0u : 1u,
+		.pSignalSemaphores = vkstate.headless ? nullptr : &vkstate.render_finished[vkstate.image_index],
+	};
+
+	frame.cpu_ns = cpuTime() - frame.record_begin - frame.acquire_ns;
+	uint64_t submit_begin = cpuTime();
+	vkResetFences(vkstate.device, 1, &frame.in_flight_fence);
+	if (vkQueueSubmit(vkstate.graphics_queue, 1, &submit_info, frame.in_flight_fence) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to submit frame");
+	}
+	frame.submit_ns = cpuTime() - submit_begin;
+	frame.present_ns = 0;
+	frame.timed = true;
+	frame.image_wait = false;
+	vkstate.drawn_frame = frame.number;
+	vkstate.drawn_image = vkstate.image_index;
+
+	/* offscreen images stay where they are until glvkReadFrame */
+	VkResult res = VK_SUCCESS;
+	if (!vkstate.headless) {
+		VkPresentInfoKHR present_info = {
+			.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+			.pNext = nullptr,
+			.waitSemaphoreCount = 1,
+			.pWaitSemaphores = &vkstate.render_finished[vkstate.image_index],
+			.swapchainCount = 1,
+			.pSwapchains = &vkstate.swapchain,
+			.pImageIndices = &vkstate.image_index,
+			.pResults = nullptr,
+		};
+
+		uint64_t present_begin = cpuTime();
+		res = vkQueuePresentKHR(vkstate.present_queue, &present_info);
+		frame.present_ns = cpuTime() - present_begin;
+	}
+
+	vkstate.frame_prepared = false;
+	vkstate.frame_active = false;
+	vkstate.frame_index = (vkstate.frame_index + 1) % vkstate.frame_count;
+
+	if (vkstate.headless) {
+		return;
+	}
+
+	if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR || vkstate.swapchain_dirty) {
+		recreateSwapchain();
+	} else if (res != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to present swapchain image");
+	}
+}
+
+/* hands a store over to the deferred destruction queue of the frame being recorded, it is recycled once that frame retires */
+static void retireBufferStore(bufferstore_t& store) {
+	if (store.buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	if (store.last_use <= vkstate.completed_frame) {
+		recycleBufferStore(store);
+		return;
+	}
+
+	prepareFrame().retired_buffers.push_back(store);
+	store.buffer = VK_NULL_HANDLE;
+}
+
+/* takes a store of at least size bytes from the pool, or creates one when the pool has none of that class */
+static VkResult acquireBufferStore(VkDeviceSize size, bufferplacement_t placement, bufferstore_t& store) {
+	VkDeviceSize capacity = bufferSizeClass(size);
+
+	auto it = vkstate.buffer_pool.find(bufferPoolKey(capacity, placement));
+	if (it != vkstate.buffer_pool.end() && !it->second.empty()) {
+		store = it->second.back();
+		it->second.pop_back();
+		store.last_use = 0;
+		store.last_draw = 0;
+		store.last_write = 0;
+		return VK_SUCCESS;
+	}
+
+	VkMemoryPropertyFlags required;
+	VkMemoryPropertyFlags preferred;
+	placementFlags(placement, required, preferred);
+
+	store = {
+		.buffer = VK_NULL_HANDLE,
+		.memory = {},
+		.capacity = capacity,
+		.placement = placement,
+		.last_use = 0,
+		.last_draw = 0,
+		.last_write = 0,
+	};
+
+	return createBuffer(capacity, GLVK_BUFFER_USAGE, required, preferred, store.buffer, store.memory);
+}
+
+/* gl's initial sampler state */
+static samplerstate_t defaultSamplerState() {
+	samplerstate_t sampler_state;
+	memset(&sampler_state, 0, sizeof(sampler_state));
+	sampler_state.min_filter = GL_NEAREST_MIPMAP_LINEAR;
+	sampler_state.mag_filter = GL_LINEAR;
+	sampler_state.wrap_s = GL_REPEAT;
+	sampler_state.wrap_t = GL_REPEAT;
+	sampler_state.wrap_r = GL_REPEAT;
+	sampler_state.compare_mode = GL_NONE;
+	sampler_state.compare_func = GL_LEQUAL;
+	sampler_state.min_lod = -1000.0f;
+	sampler_state.max_lod = 1000.0f;
+	sampler_state.lod_bias = 0.0f;
+	sampler_state.max_anisotropy = 1.0f;
+	return sampler_state;
+}
+
+/* returns VK_SAMPLER_ADDRESS_MODE_MAX_ENUM for enums that are not wrap modes */
+static VkSamplerAddressMode samplerAddressMode(GLenum wrap) {
+	switch (wrap) {
+		case GL_REPEAT: return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		case GL_MIRRORED_REPEAT: return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+		case GL_CLAMP_TO_EDGE: return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		case GL_CLAMP_TO_BORDER: return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	}
+
+	return VK_SAMPLER_ADDRESS_MODE_MAX_ENUM;
+}
+
+/* returns the sampler of a state with a reference taken, creating it when no other sampler object or texture uses the state.
+ * VK_NULL_HANDLE when it could not be created */
+static VkSampler acquireSampler(const samplerstate_t& sampler_state) {
+	auto it = vkstate.sampler_cache.find(sampler_state);
+	if (it != vkstate.sampler_cache.end()) {
+		++it->second.refs;
+		return it->second.sampler;
+	}
+
+	const VkPhysicalDeviceLimits& limits = vkstate.physical.properties.limits;
+	bool mipmapped = sampler_state.min_filter != GL_NEAREST && sampler_state.min_filter != GL_LINEAR;
+	bool linear_min = sampler_state.min_filter == GL_LINEAR || sampler_state.min_filter == GL_LINEAR_MIPMAP_NEAREST || sampler_state.min_filter == GL_LINEAR_MIPMAP_LINEAR;
+	bool linear_mip = sampler_state.min_filter == GL_NEAREST_MIPMAP_LINEAR || sampler_state.min_filter == GL_LINEAR_MIPMAP_LINEAR;
+	bool anisotropy = vkstate.features.samplerAnisotropy && sampler_state.max_anisotropy > 1.0f;
+	float min_lod = mipmapped ? std::max(sampler_state.min_lod, 0.0f) : 0.0f;
+
+	VkSamplerCreateInfo sampler_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.magFilter = (sampler_state.mag_filter == GL_LINEAR) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST,
+		.minFilter = linear_min ? VK_FILTER_LINEAR : VK_FILTER_NEAREST,
+		.mipmapMode = linear_mip ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = samplerAddressMode(sampler_state.wrap_s),
+		.addressModeV = samplerAddressMode(sampler_state.wrap_t),
+		.addressModeW = samplerAddressMode(sampler_state.wrap_r),
+		.mipLodBias = std::clamp(sampler_state.lod_bias, -limits.maxSamplerLodBias, limits.maxSamplerLodBias),
+		.anisotropyEnable = anisotropy ? VK_TRUE : VK_FALSE,
+		.maxAnisotropy = anisotropy ? std::min(sampler_state.max_anisotropy, limits.maxSamplerAnisotropy) : 1.0f,
+		.compareEnable = (sampler_state.compare_mode == GL_COMPARE_REF_TO_TEXTURE) ? VK_TRUE : VK_FALSE,
+		.compareOp = static_cast<VkCompareOp>(sampler_state.compare_func - GL_NEVER),
+		/* without mipmapping gl samples the base level only, a maximum lod of 0.25 keeps the magnification and minification filters apart */
+		.minLod = min_lod,
+		.maxLod = mipmapped ? std::max(sampler_state.max_lod, min_lod) : 0.25f,
+		.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+		.unnormalizedCoordinates = VK_FALSE,
+	};
+
+	VkSampler sampler;
+	if (vkCreateSampler(vkstate.device, &sampler_create_info, vkstate.allocator, &sampler) != VK_SUCCESS) {
+		GLVKDEBUGF(GLVK_TYPE_VULKAN, GLVK_SEVERITY_WARNING, "Failed to create a sampler, {} are in use", vkstate.sampler_cache.size());
+		return VK_NULL_HANDLE;
+	}
+
+	vkstate.sampler_cache.emplace(sampler_state, samplerentry_t{ .sampler = sampler, .refs = 1 });
+	return sampler;
+}
+
+/* drops the reference to the sampler of a state, if one was taken. the last one retires the sampler with the frame being recorded */
+static void releaseSampler(const samplerstate_t& sampler_state, VkSampler& sampler) {
+	if (sampler == VK_NULL_HANDLE) {
+		return;
+	}
+
+	auto it = vkstate.sampler_cache.find(sampler_state);
+	if (it != vkstate.sampler_cache.end() && --it->second.refs == 0) {
+		prepareFrame().retired_samplers.push_back(it->second.sampler);
+		vkstate.sampler_cache.erase(it);
+	}
+
+	sampler = VK_NULL_HANDLE;
+}
+
+/* the sampler a unit samples its texture with, the bound sampler object's or else the texture's own */
+static VkSampler unitSampler(const gltextureunit_t& unit, gltexture_t& texture) {
+	glsampler_t* sampler = glstate.samplers.get(unit.sampler);
+	if (sampler != nullptr) {
+		if (sampler->sampler == VK_NULL_HANDLE) {
+			sampler->sampler = acquireSampler(sampler->state);
+		}
+		return sampler->sampler;
+	}
+
+	if (texture.sampler == VK_NULL_HANDLE) {
+		texture.sampler = acquireSampler(texture.sampler_state);
+	}
+	return texture.sampler;
+}
+
+/* a texture format and the pixel data uploads to it take. three component data is expanded to four in the image */
+struct textureformat_t {
+	GLenum internal_format;
+	GLenum format;
+	GLenum type;
+	VkFormat vk_format;
+	uint32_t components;
+	uint32_t component_size;
+};
+
+static const textureformat_t texture_formats[] = {
+	{ .internal_format = GL_R8, .format = GL_RED, .type = GL_UNSIGNED_BYTE, .vk_format = VK_FORMAT_R8_UNORM, .components = 1, .component_size = 1 },
+	{ .internal_format = GL_RG8, .format = GL_RG, .type = GL_UNSIGNED_BYTE, .vk_format = VK_FORMAT_R8G8_UNORM, .components = 2, .component_size = 1 },
+	{ .internal_format = GL_RGB8, .format = GL_RGB, .type = GL_UNSIGNED_BYTE, .vk_format = VK_FORMAT_R8G8B8A8_UNORM, .components = 3, .component_size = 1 },
+	{ .internal_format = GL_RGBA8, .format = GL_RGBA, .type = GL_UNSIGNED_BYTE, .vk_format = VK_FORMAT_R8G8B8A8_UNORM, .components = 4, .component_size = 1 },
+	{ .internal_format = GL_SRGB8, .format = GL_RGB, .type = GL_UNSIGNED_BYTE, .vk_format = VK_FORMAT_R8G8B8A8_SRGB, .components = 3, .component_size = 1 },
+	{ .internal_format = GL_SRGB8_ALPHA8, .format = GL_RGBA, .type = GL_UNSIGNED_BYTE, .vk_format = VK_FORMAT_R8G8B8A8_SRGB, .components = 4, .component_size = 1 },
+	{ .internal_format = GL_R16F, .format = GL_RED, .type = GL_HALF_FLOAT, .vk_format = VK_FORMAT_R16_SFLOAT, .components = 1, .component_size = 2 },
+	{ .internal_format = GL_RG16F, .format = GL_RG, .type = GL_HALF_FLOAT, .vk_format = VK_FORMAT_R16G16_SFLOAT, .components = 2, .component_size = 2 },
+	{ .internal_format = GL_RGB16F, .format = GL_RGB, .type = GL_HALF_FLOAT, .vk_format = VK_FORMAT_R16G16B16A16_SFLOAT, .components = 3, .component_size = 2 },
+	{ .internal_format = GL_RGBA16F, .format = GL_RGBA, .type = GL_HALF_FLOAT, .vk_format = VK_FORMAT_R16G16B16A16_SFLOAT, .components = 4, .component_size = 2 },
+	{ .internal_format = GL_R32F, .format = GL_RED, .type = GL_FLOAT, .vk_format = VK_FORMAT_R32_SFLOAT, .components = 1, .component_size = 4 },
+	{ .internal_format = GL_RG32F, .format = GL_RG, .type = GL_FLOAT, .vk_format = VK_FORMAT_R32G32_SFLOAT, .components = 2, .component_size = 4 },
+	{ .internal_format = GL_RGB32F, .format = GL_RGB, .type = GL_FLOAT, .vk_format = VK_FORMAT_R32G32B32A32_SFLOAT, .components = 3, .component_size = 4 },
+	{ .internal_format = GL_RGBA32F, .format = GL_RGBA, .type = GL_FLOAT, .vk_format = VK_FORMAT_R32G32B32A32_SFLOAT, .components = 4, .component_size = 4 },
+};
+
+/* finds a sized internal format, or the format an unsized one (GL_RGBA, ...) stands for with the given pixel type */
+static const textureformat_t* textureFormat(GLenum internal_format, GLenum type) {
+	for (const textureformat_t& format : texture_formats) {
+		if (format.internal_format == internal_format) {
+			return &format;
+		}
+	}
+
+	for (const textureformat_t& format : texture_formats) {
+		if (format.format == internal_format && format.type == type && format.internal_format != GL_SRGB8 && format.internal_format != GL_SRGB8_ALPHA8) {
+			return &format;
+		}
+	}
+
+	return nullptr;
+}
+
+static const textureformat_t* textureFormat(VkFormat vk_format, GLenum internal_format) {
+	for (const textureformat_t& format : texture_formats) {
+		if (format.vk_format == vk_format && format.internal_format == internal_format) {
+			return &format;
+		}
+	}
+
+	return nullptr;
+}
+
+static uint32_t texelSize(const textureformat_t& format) {
+	return (format.components == 3 ? 4 : format.components) * format.component_size;
+}
+
+/* pixel data is not converted beyond filling in alpha and swapping bgra, so it has to come in the texture's own component type */
+static bool uploadFormat(const textureformat_t& texture_format, GLenum format, GLenum type) {
+	if (type != texture_format.type) {
+		return false;
+	}
+
+	return format == texture_format.format || (format == GL_BGRA && texture_format.format == GL_RGBA && texture_format.component_size == 1);
+}
+
+/* copies a row of pixels into the texel layout of the image */
+static void convertRow(const textureformat_t& texture_format, GLenum format, const uint8_t* src, uint8_t* dst, uint32_t width) {
+	uint32_t size = texture_format.component_size;
+	if (format == GL_BGRA) {
+		for (uint32_t i = 0; i < width; ++i, src += 4, dst += 4) {
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = src[3];
+		}
+		return;
+	}
+
+	if (texture_format.components != 3) {
+		memcpy(dst, src, static_cast<size_t>(width) * texture_format.components * size);
+		return;
+	}
+
+	/* alpha is 1 in the component's type */
+	uint8_t one[4] = { 0xFF };
+	if (texture_format.type == GL_HALF_FLOAT) {
+		uint16_t half = 0x3C00;
+		memcpy(one, &half, sizeof(half));
+	} else if (texture_format.type == GL_FLOAT) {
+		float value = 1.0f;
+		memcpy(one, &value, sizeof(value));
+	}
+
+	for (uint32_t i = 0; i < width; ++i, src += 3 * size, dst += 4 * size) {
+		memcpy(dst, src, 3 * size);
+		memcpy(dst + 3 * size, one, size);
+	}
+}
+
+static uint32_t mipLevels(uint32_t width, uint32_t height) {
+	return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+static VkImageMemoryBarrier imageMemoryBarrier(VkImage image, uint32_t base_level, uint32_t levels, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access) {
+	return {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = src_access,
+		.dstAccessMask = dst_access,
+		.oldLayout = old_layout,
+		.newLayout = new_layout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = base_level,
+			.levelCount = levels,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+}
+
+/* changes the layout of levels between transfers of the upload command buffer, which already waits for earlier frames when it begins */
+static void transferImageBarrier(VkCommandBuffer cb, VkImage image, uint32_t base_level, uint32_t levels, VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access) {
+	VkImageMemoryBarrier barrier = imageMemoryBarrier(image, base_level, levels, old_layout, new_layout, src_access, dst_access);
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+/* returns the upload command buffer with the image ready to be copied to. the first write of a frame moves it to TRANSFER_DST_OPTIMAL
+ * and queues the move back for the end of the uploads, later writes are only ordered after the earlier ones */
+static VkCommandBuffer imageUploadCommands(imagestore_t& store, uint32_t levels) {
+	VkCommandBuffer cb = uploadCommandBuffer();
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	store.last_use = frame.number;
+	if (store.upload_frame == frame.number) {
+		transferBarrier(cb);
+		return cb;
+	}
+
+	transferImageBarrier(cb, store.image, 0, levels, store.layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+	frame.upload_images.push_back(imageMemoryBarrier(store.image, 0, levels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+	store.upload_frame = frame.number;
+	store.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	return cb;
+}
+
+/* creates the image of a texture in the sub-allocated device memory blocks, it becomes sampleable with the frame's uploads */
+static VkResult createImageStore(VkFormat format, uint32_t width, uint32_t height, uint32_t levels, imagestore_t& store) {
+	store = {
+		.image = VK_NULL_HANDLE,
+		.view = VK_NULL_HANDLE,
+		.memory = {},
+		.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.upload_frame = 0,
+		.last_use = 0,
+		.last_draw = 0,
+	};
+
+	VkImageCreateInfo image_create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = format,
+		.extent = { width, height, 1 },
+		.mipLevels = levels,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+
+	VkResult res = createImage(image_create_info, store.image, store.memory);
+	if (res != VK_SUCCESS) {
+		store.image = VK_NULL_HANDLE;
+		return res;
+	}
+
+	VkImageViewCreateInfo view_create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.image = store.image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = format,
+		.components = {},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = levels,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+
+	res = vkCreateImageView(vkstate.device, &view_create_info, vkstate.allocator, &store.view);
+	if (res != VK_SUCCESS) {
+		vkDestroyImage(vkstate.device, store.image, vkstate.allocator);
+		freeMemory(store.memory);
+		store.image = VK_NULL_HANDLE;
+		store.view = VK_NULL_HANDLE;
+		return res;
+	}
+
+	/* gl leaves new texture contents undefined, the image only has to be in a layout draws can sample */
+	imageUploadCommands(store, levels);
+	return VK_SUCCESS;
+}
+
+/* hands a store over to the deferred destruction queue of the frame being recorded, it is destroyed once that frame retires */
+static void retireImageStore(imagestore_t& store) {
+	if (store.image == VK_NULL_HANDLE) {
+		return;
+	}
+
+	if (store.last_use <= vkstate.completed_frame) {
+		destroyImageStore(store);
+		return;
+	}
+
+	prepareFrame().retired_images.push_back(store);
+	store.image = VK_NULL_HANDLE;
+	store.view = VK_NULL_HANDLE;
+}
+
+/* moves a texture to a new image with levels levels, carrying the levels both have over on the gpu */
+static VkResult renameTexture(gltexture_t& texture, uint32_t levels) {
+	imagestore_t renamed;
+	VkResult res = createImageStore(texture.format, texture.width, texture.height, levels, renamed);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	imagestore_t& store = texture.store;
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	VkImageLayout layout = (store.upload_frame == frame.number) ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : store.layout;
+	VkCommandBuffer cb = imageUploadCommands(renamed, levels);
+
+	uint32_t copied = std::min(levels, texture.levels);
+	transferImageBarrier(cb, store.image, 0, copied, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+	VkImageCopy regions[32];
+	for (uint32_t level = 0; level < copied; ++level) {
+		regions[level] = {
+			.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+			.srcOffset = { 0, 0, 0 },
+			.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+			.dstOffset = { 0, 0, 0 },
+			.extent = { std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u), 1 },
+		};
+	}
+	vkCmdCopyImage(cb, store.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, renamed.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copied, regions);
+	transferImageBarrier(cb, store.image, 0, copied, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout, VK_ACCESS_TRANSFER_READ_BIT, 0);
+
+	store.last_use = frame.number;
+	retireImageStore(store);
+	store = renamed;
+	texture.levels = levels;
+	return VK_SUCCESS;
+}
+
+/* uploads execute ahead of the frame's draws, so a texture already drawn from this frame is renamed before it is written */
+static VkResult prepareTextureWrite(gltexture_t& texture) {
+	if (!vkstate.frame_prepared || texture.store.last_draw < vkstate.frames[vkstate.frame_index].number) {
+		return VK_SUCCESS;
+	}
+
+	return renameTexture(texture, texture.levels);
+}
+
+/* copies a width x height rectangle of pixels, laid out as the unpack state describes, into a level through the staging ring.
+ * the rows are split into bands so no reservation takes more than a quarter of the ring */
+static void uploadTexture(gltexture_t& texture, const textureformat_t& texture_format, GLenum format, uint32_t level, int32_t x, int32_t y, uint32_t width, uint32_t height, const void* pixels) {
+	const GLVKglpixelstore& unpack = glstate.unpack;
+	uint32_t pixel_size = ((format == GL_BGRA) ? 4 : texture_format.components) * texture_format.component_size;
+	VkDeviceSize row_length = (unpack.row_length > 0) ? unpack.row_length : width;
+	VkDeviceSize src_pitch = (row_length * pixel_size + unpack.alignment - 1) / unpack.alignment * unpack.alignment;
+	const uint8_t* src = static_cast<const uint8_t*>(pixels) + unpack.skip_rows * src_pitch + static_cast<VkDeviceSize>(unpack.skip_pixels) * pixel_size;
+
+	VkDeviceSize dst_pitch = static_cast<VkDeviceSize>(width) * texelSize(texture_format);
+	uint32_t band = static_cast<uint32_t>(std::clamp<VkDeviceSize>((vkstate.staging.size / 4) / dst_pitch, 1, height));
+	for (uint32_t row = 0; row < height; row += band) {
+		uint32_t rows = std::min(band, height - row);
+		VkDeviceSize offset = stagingAcquire(rows * dst_pitch);
+
+		uint8_t* dst = static_cast<uint8_t*>(vkstate.staging.memory.mapped) + offset;
+		for (uint32_t i = 0; i < rows; ++i) {
+			convertRow(texture_format, format, src + (row + i) * src_pitch, dst + i * dst_pitch, width);
+		}
+
+		VkBufferImageCopy region = {
+			.bufferOffset = offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+			.imageOffset = { x, y + static_cast<int32_t>(row), 0 },
+			.imageExtent = { width, rows, 1 },
+		};
+
+		VkCommandBuffer cb = imageUploadCommands(texture.store, texture.levels);
+		vkCmdCopyBufferToImage(cb, vkstate.staging.buffer, texture.store.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	}
+}
+
+/* where the pixels of an upload come from. buffer is nullptr for client memory, otherwise the copy reads the pixel unpack
+ * buffer's rows in place at offset, row_length texels apart */
+struct unpacksource_t {
+	glbuffer_t* buffer;
+	VkDeviceSize offset;
+	uint32_t row_length;
+};
+
+/* resolves the source of a width x height upload, pushing the error when the pixel unpack buffer cannot be read as given.
+ * the copy out of a buffer does no conversion, so its rows have to be in the texel layout of the image already */
+static bool unpackSource(const textureformat_t& texture_format, GLenum format, uint32_t width, uint32_t height, const void* pixels, unpacksource_t& source) {
+	source = {
+		.buffer = nullptr,
+		.offset = 0,
+		.row_length = 0,
+	};
+
+	if (glstate.bound_buffers.pixel_unpack == 0) {
+		return true;
+	}
+
+	glbuffer_t* buffer = glstate.buffers.get(glstate.bound_buffers.pixel_unpack);
+	if (buffer == nullptr || buffer->map_access != 0) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return false;
+	}
+
+	const GLVKglpixelstore& unpack = glstate.unpack;
+	uint32_t texel_size = texelSize(texture_format);
+	uint32_t pixel_size = ((format == GL_BGRA) ? 4 : texture_format.components) * texture_format.component_size;
+	VkDeviceSize row_length = (unpack.row_length > 0) ? unpack.row_length : width;
+	VkDeviceSize pitch = (row_length * pixel_size + unpack.alignment - 1) / unpack.alignment * unpack.alignment;
+	VkDeviceSize offset = reinterpret_cast<uintptr_t>(pixels) + unpack.skip_rows * pitch + static_cast<VkDeviceSize>(unpack.skip_pixels) * pixel_size;
+
+	if (width > 0 && height > 0 && offset + (height - 1) * pitch + static_cast<VkDeviceSize>(width) * pixel_size > buffer->size) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return false;
+	}
+
+	if (format == GL_BGRA || pixel_size != texel_size || pitch % texel_size != 0 || offset % texel_size != 0) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Uploads from a pixel unpack buffer need pixels in the texture's own layout, aligned to whole texels");
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return false;
+	}
+
+	source = {
+		.buffer = buffer,
+		.offset = offset,
+		.row_length = static_cast<uint32_t>(pitch / texel_size),
+	};
+	return true;
+}
+
+/* copies a width x height rectangle from the pixel unpack buffer into a level without going through the cpu or the staging ring */
+static void uploadTextureBuffer(gltexture_t& texture, uint32_t level, int32_t x, int32_t y, uint32_t width, uint32_t height, const unpacksource_t& source) {
+	bufferstore_t& store = source.buffer->store;
+
+	/* a readback into the buffer recorded this frame lands after the frame's uploads, so it has to finish first */
+	if (vkstate.frame_prepared && store.last_write >= vkstate.frames[vkstate.frame_index].number) {
+		flushFrame();
+	}
+
+	VkBufferImageCopy region = {
+		.bufferOffset = source.offset,
+		.bufferRowLength = source.row_length,
+		.bufferImageHeight = 0,
+		.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+		.imageOffset = { x, y, 0 },
+		.imageExtent = { width, height, 1 },
+	};
+
+	/* the buffer may have been written by earlier uploads of the frame */
+	VkCommandBuffer cb = imageUploadCommands(texture.store, texture.levels);
+	transferBarrier(cb);
+	vkCmdCopyBufferToImage(cb, store.buffer, texture.store.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	/* writes to the buffer later in the frame are staged behind this copy instead of landing in its memory directly */
+	store.last_use = vkstate.frame_number;
+}
+
+/* builds levels 1 and up from level 0 with a chain of blits, each level is read once the previous blit wrote it */
+static void generateMips(gltexture_t& texture) {
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(vkstate.physical.device, texture.format, &props);
+	VkFilter filter = (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	VkImage image = texture.store.image;
+	VkCommandBuffer cb = imageUploadCommands(texture.store, texture.levels);
+	for (uint32_t level = 1; level < texture.levels; ++level) {
+		transferImageBarrier(cb, image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+		VkImageBlit blit = {
+			.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 },
+			.srcOffsets = {
+				{ 0, 0, 0 },
+				{ static_cast<int32_t>(std::max(texture.width >> (level - 1), 1u)), static_cast<int32_t>(std::max(texture.height >> (level - 1), 1u)), 1 },
+			},
+			.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+			.dstOffsets = {
+				{ 0, 0, 0 },
+				{ static_cast<int32_t>(std::max(texture.width >> level, 1u)), static_cast<int32_t>(std::max(texture.height >> level, 1u)), 1 },
+			},
+		};
+		vkCmdBlitImage(cb, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+	}
+
+	/* the whole image moves back to being sampled with the rest of the frame's uploads */
+	if (texture.levels > 1) {
+		transferImageBarrier(cb, image, 0, texture.levels - 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	}
+}
+
+void glvkDraw() {
+	GLVK_DEFER(glvkDraw);
+	if (!state.inited) {
+		return;
+	}
+
+	/* a frame without draw calls is still cleared and presented */
+	if (!beginFrame()) {
+		return;
+	}
+
+	endFrame();
+}
+
+int glvkReadFrame(void* pixels) {
+	GLVK_SYNC();
+	if (!state.inited) {
+		return 1;
+	}
+
+	if (!vkstate.headless) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glvkReadFrame requires glvkInitHeadless");
+		return 1;
+	}
+
+	if (vkstate.drawn_frame == 0) {
+		return 1;
+	}
+
+	waitForFrame(vkstate.drawn_frame);
+
+	VkDeviceSize size = static_cast<VkDeviceSize>(vkstate.extent.width) * vkstate.extent.height * 4;
+	VkBuffer readback;
+	allocation_t readback_memory;
+	VkMemoryPropertyFlags required;
+	VkMemoryPropertyFlags preferred;
+	placementFlags(BUFFER_PLACEMENT_READBACK, required, preferred);
+
+	if (createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, required, preferred, readback, readback_memory) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create readback buffer");
+		return 1;
+	}
+
+	/* the render pass already left the image in TRANSFER_SRC_OPTIMAL, this only orders the color writes */
+	VkImageMemoryBarrier image_barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = vkstate.swapchain_images[vkstate.drawn_image],
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+
+	VkBufferImageCopy region = {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = { vkstate.extent.width, vkstate.extent.height, 1 },
+	};
+
+	VkMemoryBarrier host_barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+	};
+
+	VkCommandBuffer cb = beginImmediate();
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+	vkCmdCopyImageToBuffer(cb, image_barrier.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback, 1, &region);
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &host_barrier, 0, nullptr, 0, nullptr);
+	submitImmediate();
+
+	memcpy(pixels, readback_memory.mapped, size);
+	vkDestroyBuffer(vkstate.device, readback, vkstate.allocator);
+	freeMemory(readback_memory);
+	return 0;
+}
+
+void glvkDeinit() {
+	if (!state.inited) {
+		return;
+	}
+
+	/* everything recorded is still executed before the teardown */
+	commandStop();
+	state.inited = false;
+
+	vkDeviceWaitIdle(vkstate.device);
+	destroyRecorders();
+	glstate.buffers.forEach([](glbuffer_t& glbuffer) {
+		destroyBufferStore(glbuffer.store);
+	});
+	glstate.buffers.clear();
+	glstate.bound_buffers = {};
+	glstate.queries.clear();
+	glstate.active_query = 0;
+	glstate.vertex_arrays.clear();
+	glstate.bound_vao = 0;
+	vkstate.vertex_layouts.clear();
+	vkstate.vertex_layout_lookup.clear();
+	glstate.textures.forEach([](gltexture_t& texture) {
+		destroyImageStore(texture.store);
+	});
+	glstate.textures.clear();
+	glstate.samplers.clear();
+	glstate.texture_mask = 0;
+	glstate.shaders.clear();
+	glstate.programs.clear();
+	glstate.program = 0;
+
+	for (GLVKvkframe& frame : vkstate.frames) {
+		for (bufferstore_t& store : frame.retired_buffers) {
+			destroyBufferStore(store);
+		}
+		for (imagestore_t& store : frame.retired_images) {
+			destroyImageStore(store);
+		}
+		for (VkSampler sampler : frame.retired_samplers) {
+			destroySampler(sampler);
+		}
+		for (VkPipeline pipeline : frame.retired_pipelines) {
+			vkDestroyPipeline(vkstate.device, pipeline, vkstate.allocator);
+		}
+	}
+
+	for (auto& [state, entry] : vkstate.sampler_cache) {
+		destroySampler(entry.sampler);
+	}
+	vkstate.sampler_cache.clear();
+
+	for (auto& [key, stores] : vkstate.buffer_pool) {
+		for (bufferstore_t& store : stores) {
+			destroyBufferStore(store);
+		}
+	}
+	vkstate.buffer_pool.clear();
+
+	vkDestroyBuffer(vkstate.device, vkstate.staging.buffer, vkstate.allocator);
+	freeMemory(vkstate.staging.memory);
+	vkFreeCommandBuffers(vkstate.device, vkstate.immediate_pool, 1, &vkstate.immediate_buffer);
+	vkDestroyCommandPool(vkstate.device, vkstate.immediate_pool, vkstate.allocator);
+	for (GLVKvkframe& frame : vkstate.frames) {
+		vkDestroySemaphore(vkstate.device, frame.image_available, vkstate.allocator);
+		vkDestroyFence(vkstate.device, frame.in_flight_fence, vkstate.allocator);
+		vkFreeCommandBuffers(vkstate.device, frame.command_pool, 1, &frame.command_buffer);
+		vkFreeCommandBuffers(vkstate.device, frame.command_pool, 1, &frame.upload_buffer);
+		vkDestroyCommandPool(vkstate.device, frame.command_pool, vkstate.allocator);
+		vkDestroyQueryPool(vkstate.device, frame.query_pool, vkstate.allocator);
+		for (VkDescriptorPool pool : frame.descriptor_pools) {
+			vkDestroyDescriptorPool(vkstate.device, pool, vkstate.allocator);
+		}
+		for (uniformchunk_t& chunk : frame.uniform_chunks) {
+			vkDestroyBuffer(vkstate.device, chunk.buffer, vkstate.allocator);
+			freeMemory(chunk.memory);
+		}
+	}
+	vkstate.frames.clear();
+	vkstate.image_fences.clear();
+	vkstate.frame_prepared = false;
+	vkstate.frame_active = false;
+	vkDestroyShaderModule(vkstate.device, vkstate.vshader, vkstate.allocator);
+	vkDestroyShaderModule(vkstate.device, vkstate.fshader, vkstate.allocator);
+	for (auto& [link, modules] : vkstate.shaders.programs) {
+		destroyProgramModules(modules);
+	}
+	vkstate.shaders.programs.clear();
+#ifdef GLVK_GLSLANG
+	glslang_finalize_process();
+#endif
+	if (vkstate.bindless.pool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(vkstate.device, vkstate.bindless.pool, vkstate.allocator);
+		vkstate.bindless.pool = VK_NULL_HANDLE;
+	}
+	vkDestroyDescriptorSetLayout(vkstate.device, vkstate.desc_layout, vkstate.allocator);
+	vkDestroyDescriptorPool(vkstate.device, vkstate.uniform_pool, vkstate.allocator);
+	vkDestroyDescriptorSetLayout(vkstate.device, vkstate.uniform_layout, vkstate.allocator);
+	vkDestroyPipelineLayout(vkstate.device, vkstate.pipeline_layout, vkstate.allocator);
+	savePipelineCache();
+	destroyPipelines();
+	vkDestroyPipelineCache(vkstate.device, vkstate.pipelines.driver_cache, vkstate.allocator);
+	destroySwapchainTargets();
+	destroyMemoryBlocks();
+	vkDestroyRenderPass(vkstate.device, vkstate.render_pass, vkstate.allocator);
+	vkDestroyRenderPass(vkstate.device, vkstate.render_pass_load, vkstate.allocator);
+	if (vkstate.swapchain != VK_NULL_HANDLE) {
+		vkDestroySwapchainKHR(vkstate.device, vkstate.swapchain, vkstate.allocator);
+		vkstate.swapchain = VK_NULL_HANDLE;
+	}
+	vkDestroyDevice(vkstate.device, vkstate.allocator);
+	if (vkstate.surface != VK_NULL_HANDLE) {
+		vkDestroySurfaceKHR(vkstate.instance, vkstate.surface, vkstate.allocator);
+		vkstate.surface = VK_NULL_HANDLE;
+	}
+	if (vkstate.debug_messenger != VK_NULL_HANDLE) {
+		PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(vkstate.instance, "vkDestroyDebugUtilsMessengerEXT"));
+		if (vkDestroyDebugUtilsMessengerEXT != nullptr) {
+			vkDestroyDebugUtilsMessengerEXT(vkstate.instance, vkstate.debug_messenger, vkstate.allocator);
+		}
+	}
+	vkDestroyInstance(vkstate.instance, nullptr);
+}
+
+GLenum glGetError(void) {
+	GLVK_SYNC();
+	if (glstate.errors.empty()) {
+		return GL_NO_ERROR;
+	}
+
+	GLenum error = glstate.errors.top();
+	glstate.errors.pop();
+
+	return error;
+}
+
+/* answers the implementation limits glvk reports, anisotropy is capped at 1 when the device cannot filter anisotropically */
+void glGetFloatv(GLenum pname, GLfloat* data) {
+	GLVK_SYNC();
+	if (pname == GL_MAX_TEXTURE_MAX_ANISOTROPY) {
+		*data = vkstate.features.samplerAnisotropy ? vkstate.physical.properties.limits.maxSamplerAnisotropy : 1.0f;
+		return;
+	}
+
+	GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glGetFloatv parameter {} is not supported", pname);
+	GLPUSHERROR(GL_INVALID_ENUM);
+}
+
+void glGenBuffers(GLsizei n, GLuint* buffers) {
+	GLVK_SYNC();
+	if (n < 1) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	for (GLsizei i = 0; i < n; ++i) {
+		glbuffer_t buffer = {
+			.id = 0,
+			.store = {},
+			.size = 0,
+			.usage = 0,
+			.map_access = 0,
+			.map_offset = 0,
+			.map_length = 0,
+			.map_pointer = nullptr,
+			.map_shadowed = false,
+			.map_shadow = {},
+			.map_flushed = {},
+		};
+
+		buffers[i] = glstate.buffers.create(buffer);
+		if (buffers[i] == 0) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return;
+		}
+
+		glstate.buffers.get(buffers[i])->id = buffers[i];
+	}
+}
+
+GLboolean glIsBuffer(GLuint buffer) {
+	GLVK_SYNC();
+	return (glstate.buffers.get(buffer) != nullptr) ? GL_TRUE : GL_FALSE;
+}
+
+static GLuint* bufferBinding(GLenum target) {
+	if (target == GL_ARRAY_BUFFER) {
+		return &glstate.bound_buffers.array;
+	} else if (target == GL_ELEMENT_ARRAY_BUFFER) {
+		return &glstate.bound_buffers.element_array;
+	} else if (target == GL_COPY_READ_BUFFER) {
+		return &glstate.bound_buffers.copy_read;
+	} else if (target == GL_COPY_WRITE_BUFFER) {
+		return &glstate.bound_buffers.copy_write;
+	} else if (target == GL_PIXEL_PACK_BUFFER) {
+		return &glstate.bound_buffers.pixel_pack;
+	} else if (target == GL_PIXEL_UNPACK_BUFFER) {
+		return &glstate.bound_buffers.pixel_unpack;
+	} else if (target == GL_TRANSFORM_FEEDBACK_BUFFER) {
+		return &glstate.bound_buffers.transform_feedback;
+	} else if (target == GL_UNIFORM_BUFFER) {
+		return &glstate.bound_buffers.uniform;
+	} else if (target == GL_SHADER_STORAGE_BUFFER) {
+		return &glstate.bound_buffers.shader_storage;
+	} else if (target == GL_TEXTURE_BUFFER) {
+		return &glstate.bound_buffers.texture;
+	}
+
+	return nullptr;
+}
+
+/* marks the dirty groups of a state change, a call leaving the state as it was only counts as redundant */
+static void markState(bool changed, uint32_t dirty) {
+	if (!changed) {
+		++vkstate.state_stats.redundant_state;
+		return;
+	}
+
+	glstate.dirty |= dirty;
+}
+
+void glBindBuffer(GLenum target, GLuint buffer) {
+	GLVK_DEFER(glBindBuffer, target, buffer);
+	GLuint* binding = bufferBinding(target);
+	if (binding == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (buffer != 0 && glstate.buffers.get(buffer) == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	markState(*binding != buffer, 0);
+	*binding = buffer;
+}
+
+/* only records the range, it is resolved to a bindless descriptor by the next draw */
+static void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size, bool whole) {
+	glindexedbinding_t* bindings;
+	uint32_t* mask;
+	uint32_t* indices;
+	descriptorkey_t* set_keys;
+	uint32_t count;
+	VkDeviceSize alignment;
+	if (target == GL_UNIFORM_BUFFER) {
+		bindings = glstate.indexed_buffers.uniform;
+		mask = &glstate.indexed_buffers.uniform_mask;
+		indices = glstate.bindings.uniform_buffers;
+		set_keys = glstate.binding_set.uniform_buffers;
+		count = GLVK_MAX_UNIFORM_BUFFER_BINDINGS;
+		alignment = vkstate.physical.properties.limits.minUniformBufferOffsetAlignment;
+	} else if (target == GL_SHADER_STORAGE_BUFFER) {
+		bindings = glstate.indexed_buffers.storage;
+		mask = &glstate.indexed_buffers.storage_mask;
+		indices = glstate.bindings.storage_buffers;
+		set_keys = glstate.binding_set.storage_buffers;
+		count = GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS;
+		alignment = vkstate.physical.properties.limits.minStorageBufferOffsetAlignment;
+	} else {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (index >= count) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (buffer != 0 && glstate.buffers.get(buffer) == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	if (!whole && buffer != 0 && (offset < 0 || size <= 0 || (alignment != 0 && static_cast<VkDeviceSize>(offset) % alignment != 0))) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	glindexedbinding_t& binding = bindings[index];
+	markState(binding.buffer != buffer || binding.offset != (whole ? 0 : offset) || binding.size != (whole ? 0 : size), 0);
+	binding.buffer = buffer;
+	binding.offset = whole ? 0 : offset;
+	binding.size = whole ? 0 : size;
+
+	if (buffer != 0) {
+		*mask |= 1u << index;
+	} else {
+		*mask &= ~(1u << index);
+		if (indices[index] != GLVK_NO_DESCRIPTOR || set_keys[index].handle != 0) {
+			indices[index] = GLVK_NO_DESCRIPTOR;
+			set_keys[index] = {};
+			glstate.dirty |= DIRTY_DESCRIPTORS;
+		}
+	}
+
+	/* like in gl, the generic binding point is changed as well */
+	*bufferBinding(target) = buffer;
+}
+
+void glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	GLVK_DEFER(glBindBufferBase, target, index, buffer);
+	bindBufferRange(target, index, buffer, 0, 0, true);
+}
+
+void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	GLVK_DEFER(glBindBufferRange, target, index, buffer, offset, size);
+	bindBufferRange(target, index, buffer, offset, size, false);
+}
+
+/* writes count elements of columns slots each into the default uniform block from location on, dropping the ones past the
+ * last location the way gl drops elements past the end of a uniform array. slots only count as changed when their bytes do */
+static void setUniforms(GLint location, GLsizei count, uint32_t components, uint32_t columns, GLboolean transpose, const void* value) {
+	if (commandThreaded()) {
+		size_t size = 0;
+		if (count > 0 && location >= 0 && location < GLVK_MAX_UNIFORM_LOCATIONS) {
+			count = std::min(count, static_cast<GLsizei>((GLVK_MAX_UNIFORM_LOCATIONS - location) / columns));
+			size = static_cast<size_t>(count) * components * columns * sizeof(uint32_t);
+		}
+		deferCommand<setUniforms>(location, count, components, columns, transpose, commandCopy(value, size));
+		return;
+	}
+
+	if (count < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (location == -1) {
+		return;
+	}
+
+	if (location < 0 || location >= GLVK_MAX_UNIFORM_LOCATIONS) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	gluniformblock_t& block = glstate.uniforms;
+	bool changed = false;
+	const uint32_t* words = static_cast<const uint32_t*>(value);
+	uint32_t element_count = std::min(static_cast<uint32_t>(count), (GLVK_MAX_UNIFORM_LOCATIONS - location) / columns);
+	for (uint32_t e = 0; e < element_count; ++e) {
+		const uint32_t* element = words + e * components * columns;
+		for (uint32_t c = 0; c < columns; ++c) {
+			/* matrices are stored column major, one column per slot */
+			uint32_t column[4];
+			for (uint32_t r = 0; r < components; ++r) {
+				column[r] = transpose ? element[r * columns + c] : element[c * components + r];
+			}
+
+			uint8_t* slot = block.data + (location + e * columns + c) * 16;
+			if (memcmp(slot, column, components * sizeof(uint32_t)) != 0) {
+				memcpy(slot, column, components * sizeof(uint32_t));
+				changed = true;
+			}
+		}
+	}
+
+	uint32_t end = (location + element_count * columns) * 16;
+	if (end > block.size) {
+		block.size = end;
+		changed = true;
+	}
+
+	/* the block has its own dirty flag, it is copied rather than emitted */
+	markState(changed, 0);
+	block.dirty = block.dirty || changed;
+}
+
+void glUniform1f(GLint location, GLfloat v0) {
+	GLVK_DEFER(glUniform1f, location, v0);
+	GLfloat value[1] = { v0 };
+	setUniforms(location, 1, 1, 1, GL_FALSE, value);
+}
+
+void glUniform1i(GLint location, GLint v0) {
+	GLVK_DEFER(glUniform1i, location, v0);
+	GLint value[1] = { v0 };
+	setUniforms(location, 1, 1, 1, GL_FALSE, value);
+}
+
+void glUniform1ui(GLint location, GLuint v0) {
+	GLVK_DEFER(glUniform1ui, location, v0);
+	GLuint value[1] = { v0 };
+	setUniforms(location, 1, 1, 1, GL_FALSE, value);
+}
+
+void glUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+	GLVK_DEFER(glUniform2f, location, v0, v1);
+	GLfloat value[2] = { v0, v1 };
+	setUniforms(location, 1, 2, 1, GL_FALSE, value);
+}
+
+void glUniform2i(GLint location, GLint v0, GLint v1) {
+	GLVK_DEFER(glUniform2i, location, v0, v1);
+	GLint value[2] = { v0, v1 };
+	setUniforms(location, 1, 2, 1, GL_FALSE, value);
+}
+
+void glUniform2ui(GLint location, GLuint v0, GLuint v1) {
+	GLVK_DEFER(glUniform2ui, location, v0, v1);
+	GLuint value[2] = { v0, v1 };
+	setUniforms(location, 1, 2, 1, GL_FALSE, value);
+}
+
+void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+	GLVK_DEFER(glUniform3f, location, v0, v1, v2);
+	GLfloat value[3] = { v0, v1, v2 };
+	setUniforms(location, 1, 3, 1, GL_FALSE, value);
+}
+
+void glUniform3i(GLint location, GLint v0, GLint v1, GLint v2) {
+	GLVK_DEFER(glUniform3i, location, v0, v1, v2);
+	GLint value[3] = { v0, v1, v2 };
+	setUniforms(location, 1, 3, 1, GL_FALSE, value);
+}
+
+void glUniform3ui(GLint location, GLuint v0, GLuint v1, GLuint v2) {
+	GLVK_DEFER(glUniform3ui, location, v0, v1, v2);
+	GLuint value[3] = { v0, v1, v2 };
+	setUniforms(location, 1, 3, 1, GL_FALSE, value);
+}
+
+void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+	GLVK_DEFER(glUniform4f, location, v0, v1, v2, v3);
+	GLfloat value[4] = { v0, v1, v2, v3 };
+	setUniforms(location, 1, 4, 1, GL_FALSE, value);
+}
+
+void glUniform4i(GLint location, GLint v0, GLint v1, GLint v2, GLint v3) {
+	GLVK_DEFER(glUniform4i, location, v0, v1, v2, v3);
+	GLint value[4] = { v0, v1, v2, v3 };
+	setUniforms(location, 1, 4, 1, GL_FALSE, value);
+}
+
+void glUniform4ui(GLint location, GLuint v0, GLuint v1, GLuint v2, GLuint v3) {
+	GLVK_DEFER(glUniform4ui, location, v0, v1, v2, v3);
+	GLuint value[4] = { v0, v1, v2, v3 };
+	setUniforms(location, 1, 4, 1, GL_FALSE, value);
+}
+
+void glUniform1fv(GLint location, GLsizei count, const GLfloat* value) {
+	setUniforms(location, count, 1, 1, GL_FALSE, value);
+}
+
+void glUniform1iv(GLint location, GLsizei count, const GLint* value) {
+	setUniforms(location, count, 1, 1, GL_FALSE, value);
+}
+
+void glUniform1uiv(GLint location, GLsizei count, const GLuint* value) {
+	setUniforms(location, count, 1, 1, GL_FALSE, value);
+}
+
+void glUniform2fv(GLint location, GLsizei count, const GLfloat* value) {
+	setUniforms(location, count, 2, 1, GL_FALSE, value);
+}
+
+void glUniform2iv(GLint location, GLsizei count, const GLint* value) {
+	setUniforms(location, count, 2, 1, GL_FALSE, value);
+}
+
+void glUniform2uiv(GLint location, GLsizei count, const GLuint* value) {
+	setUniforms(location, count, 2, 1, GL_FALSE, value);
+}
+
+void glUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+	setUniforms(location, count, 3, 1, GL_FALSE, value);
+}
+
+void glUniform3iv(GLint location, GLsizei count, const GLint* value) {
+	setUniforms(location, count, 3, 1, GL_FALSE, value);
+}
+
+void glUniform3uiv(GLint location, GLsizei count, const GLuint* value) {
+	setUniforms(location, count, 3, 1, GL_FALSE, value);
+}
+
+void glUniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+	setUniforms(location, count, 4, 1, GL_FALSE, value);
+}
+
+void glUniform4iv(GLint location, GLsizei count, const GLint* value) {
+	setUniforms(location, count, 4, 1, GL_FALSE, value);
+}
+
+void glUniform4uiv(GLint location, GLsizei count, const GLuint* value) {
+	setUniforms(location, count, 4, 1, GL_FALSE, value);
+}
+
+void glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+	setUniforms(location, count, 2, 2, transpose, value);
+}
+
+void glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+	setUniforms(location, count, 3, 3, transpose, value);
+}
+
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+	setUniforms(location, count, 4, 4, transpose, value);
+}
+
+/* writes into a buffer object with gl ordering: commands recorded before the write keep seeing the old contents */
+static VkResult writeBuffer(glbuffer_t& glbuffer, VkDeviceSize offset, const void* data, VkDeviceSize size) {
+	bufferstore_t& store = glbuffer.store;
+	if (store.memory.mapped != nullptr && store.last_use <= vkstate.completed_frame) {
+		memcpy(static_cast<uint8_t*>(store.memory.mapped) + offset, data, size);
+		return VK_SUCCESS;
+	}
+
+	/* a readback recorded this frame lands after the frame's uploads, so it has to finish before the write is staged */
+	if (vkstate.frame_prepared && store.last_write >= vkstate.frames[vkstate.frame_index].number) {
+		flushFrame();
+	}
+
+	/* uploads execute ahead of the frame's draws, so a store already drawn from this frame is renamed and its other bytes carried over on the gpu */
+	if (vkstate.frame_prepared && store.last_draw >= vkstate.frames[vkstate.frame_index].number) {
+		bufferstore_t renamed;
+		VkResult res = acquireBufferStore(glbuffer.size, store.placement, renamed);
+		if (res != VK_SUCCESS) {
+			return res;
+		}
+
+		VkBufferCopy region = {
+			.srcOffset = 0,
+			.dstOffset = 0,
+			.size = glbuffer.size,
+		};
+
+		VkCommandBuffer cb = uploadCommandBuffer();
+		transferBarrier(cb);
+		vkCmdCopyBuffer(cb, store.buffer, renamed.buffer, 1, &region);
+
+		store.last_use = vkstate.frame_number;
+		retireBufferStore(store);
+		store = renamed;
+	}
+
+	uploadBuffer(store.buffer, offset, data, size);
+	store.last_use = vkstate.frame_number;
+	return VK_SUCCESS;
+}
+
+/* reads back a range of a store, waiting for every gpu access recorded so far */
+static VkResult readBuffer(bufferstore_t& store, VkDeviceSize offset, void* data, VkDeviceSize size) {
+	waitForFrame(store.last_use);
+	if (store.memory.mapped != nullptr) {
+		memcpy(data, static_cast<uint8_t*>(store.memory.mapped) + offset, size);
+		return VK_SUCCESS;
+	}
+
+	VkBuffer readback;
+	allocation_t readback_memory;
+	VkMemoryPropertyFlags required;
+	VkMemoryPropertyFlags preferred;
+	placementFlags(BUFFER_PLACEMENT_READBACK, required, preferred);
+
+	VkResult res = createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, required, preferred, readback, readback_memory);
+	if (res != VK_SUCCESS) {
+		return res;
+	}
+
+	VkBufferCopy region = {
+		.srcOffset = offset,
+		.dstOffset = 0,
+		.size = size,
+	};
+
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+	};
+
+	VkCommandBuffer cb = beginImmediate();
+	vkCmdCopyBuffer(cb, store.buffer, readback, 1, &region);
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	submitImmediate();
+
+	memcpy(data, readback_memory.mapped, size);
+	vkDestroyBuffer(vkstate.device, readback, vkstate.allocator);
+	freeMemory(readback_memory);
+	return VK_SUCCESS;
+}
+
+static void unmapBuffer(glbuffer_t& glbuffer) {
+	glbuffer.map_access = 0;
+	glbuffer.map_offset = 0;
+	glbuffer.map_length = 0;
+	glbuffer.map_pointer = nullptr;
+	glbuffer.map_shadowed = false;
+	glbuffer.map_shadow.clear();
+	glbuffer.map_flushed.clear();
+}
+
+void glBufferData(GLenum target, GLsizei size, const GLvoid* data, GLenum usage) {
+	if (commandThreaded()) {
+		/* small data travels through the ring, large uploads run on the gl thread once the worker is idle */
+		if (data == nullptr || size <= GLVK_COMMAND_DATA_LIMIT) {
+			deferCommand<glBufferData>(target, size, commandCopy(data, size > 0 ? size : 0), usage);
+			return;
+		}
+	}
+	GLVK_SYNC();
+
+	GLuint* binding = bufferBinding(target);
+	if (binding == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	GLuint buffer = *binding;
+	glbuffer_t* glbuffer = glstate.buffers.get(buffer);
+	if (glbuffer == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	if (size < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (
+		usage != GL_STREAM_DRAW  &&
+		usage != GL_STREAM_READ  &&
+		usage != GL_STREAM_COPY  &&
+		usage != GL_STATIC_DRAW  &&
+		usage != GL_STATIC_READ  &&
+		usage != GL_STATIC_COPY  &&
+		usage != GL_DYNAMIC_DRAW &&
+		usage != GL_DYNAMIC_READ &&
+		usage != GL_DYNAMIC_COPY
+	) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	/* orphan the current store instead of destroying it, frames in flight may still read from it */
+	retireBufferStore(glbuffer->store);
+	unmapBuffer(*glbuffer);
+
+	glbuffer->usage = usage;
+	glbuffer->size = 0;
+	if (size == 0) {
+		return;
+	}
+
+	VkResult res = acquireBufferStore(static_cast<VkDeviceSize>(size), bufferPlacement(usage), glbuffer->store);
+	if (res != VK_SUCCESS) {
+		if (res == VK_ERROR_OUT_OF_HOST_MEMORY || res == VK_ERROR_OUT_OF_DEVICE_MEMORY || res == VK_ERROR_TOO_MANY_OBJECTS) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+		} else {
+			GLPUSHERROR(GL_INVALID_OPERATION);
+		}
+		return;
+	}
+
+	if (data != nullptr) {
+		if (glbuffer->store.memory.mapped != nullptr) {
+			memcpy(glbuffer->store.memory.mapped, data, size);
+		} else {
+			uploadBuffer(glbuffer->store.buffer, 0, data, size);
+			glbuffer->store.last_use = vkstate.frame_number;
+		}
+	}
+
+	glbuffer->size = size;
+}
+
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data) {
+	if (commandThreaded()) {
+		if (data == nullptr || size <= GLVK_COMMAND_DATA_LIMIT) {
+			deferCommand<glBufferSubData>(target, offset, size, commandCopy(data, size > 0 ? size : 0));
+			return;
+		}
+	}
+	GLVK_SYNC();
+
+	GLuint* binding = bufferBinding(target);
+	if (binding == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	glbuffer_t* glbuffer = glstate.buffers.get(*binding);
+	if (glbuffer == nullptr || glbuffer->map_access != 0) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	if (offset < 0 || size < 0 || static_cast<VkDeviceSize>(offset + size) > glbuffer->size) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (size == 0 || data == nullptr) {
+		return;
+	}
+
+	if (writeBuffer(*glbuffer, offset, data, size) != VK_SUCCESS) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+	}
+}
+
+void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	GLVK_SYNC();
+	GLuint* binding = bufferBinding(target);
+	if (binding == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return nullptr;
+	}
+
+	glbuffer_t* glbuffer = glstate.buffers.get(*binding);
+	if (glbuffer == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return nullptr;
+	}
+
+	const GLbitfield known = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_FLUSH_EXPLICIT_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	if (offset < 0 || length <= 0 || static_cast<VkDeviceSize>(offset + length) > glbuffer->size || (access & ~known) != 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return nullptr;
+	}
+
+	if (
+		glbuffer->map_access != 0 ||
+		(access & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)) == 0 ||
+		((access & GL_MAP_READ_BIT) && (access & (GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT))) ||
+		((access & GL_MAP_FLUSH_EXPLICIT_BIT) && !(access & GL_MAP_WRITE_BIT))
+	) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return nullptr;
+	}
+
+	/* invalidating the whole buffer is an orphan, the new store is idle so the mapping never waits */
+	if (access & GL_MAP_INVALIDATE_BUFFER_BIT) {
+		retireBufferStore(glbuffer->store);
+		if (acquireBufferStore(glbuffer->size, bufferPlacement(glbuffer->usage), glbuffer->store) != VK_SUCCESS) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return nullptr;
+		}
+	}
+
+	bufferstore_t& store = glbuffer->store;
+	bool busy = store.last_use > vkstate.completed_frame;
+	bool shadowed = store.memory.mapped == nullptr;
+	if (!shadowed && busy && !(access & GL_MAP_UNSYNCHRONIZED_BIT)) {
+		if (access & GL_MAP_INVALIDATE_RANGE_BIT) {
+			/* the old bytes are not needed, write into a shadow that is uploaded in order on unmap instead of stalling */
+			shadowed = true;
+		} else {
+			waitForFrame(store.last_use);
+		}
+	}
+
+	glbuffer->map_access = access;
+	glbuffer->map_offset = offset;
+	glbuffer->map_length = length;
+	glbuffer->map_shadowed = shadowed;
+
+	if (!shadowed) {
+		glbuffer->map_pointer = static_cast<uint8_t*>(store.memory.mapped) + offset;
+		return glbuffer->map_pointer;
+	}
+
+	glbuffer->map_shadow.resize(length);
+	if ((access & GL_MAP_READ_BIT) && readBuffer(store, offset, glbuffer->map_shadow.data(), length) != VK_SUCCESS) {
+		unmapBuffer(*glbuffer);
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+		return nullptr;
+	}
+
+	glbuffer->map_pointer = glbuffer->map_shadow.data();
+	return glbuffer->map_pointer;
+}
+
+void glFlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length) {
+	GLVK_SYNC();
+	GLuint* binding = bufferBinding(target);
+	if (binding == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	glbuffer_t* glbuffer = glstate.buffers.get(*binding);
+	if (glbuffer == nullptr || glbuffer->map_access == 0 || !(glbuffer->map_access & GL_MAP_FLUSH_EXPLICIT_BIT)) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	if (offset < 0 || length < 0 || static_cast<VkDeviceSize>(offset + length) > glbuffer->map_length) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* direct mappings are host coherent so only shadows need to remember what to upload */
+	if (glbuffer->map_shadowed && length > 0) {
+		glbuffer->map_flushed.push_back({ static_cast<VkDeviceSize>(offset), static_cast<VkDeviceSize>(length) });
+	}
+}
+
+GLboolean glUnmapBuffer(GLenum target) {
+	GLVK_SYNC();
+	GLuint* binding = bufferBinding(target);
+	if (binding == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return GL_FALSE;
+	}
+
+	glbuffer_t* glbuffer = glstate.buffers.get(*binding);
+	if (glbuffer == nullptr || glbuffer->map_access == 0) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return GL_FALSE;
+	}
+
+	VkResult res = VK_SUCCESS;
+	if (glbuffer->map_shadowed && (glbuffer->map_access & GL_MAP_WRITE_BIT)) {
+		if (glbuffer->map_access & GL_MAP_FLUSH_EXPLICIT_BIT) {
+			for (std::pair<VkDeviceSize, VkDeviceSize>& range : glbuffer->map_flushed) {
+				if (res == VK_SUCCESS) {
+					res = writeBuffer(*glbuffer, glbuffer->map_offset + range.first, glbuffer->map_shadow.data() + range.first, range.second);
+				}
+			}
+		} else {
+			res = writeBuffer(*glbuffer, glbuffer->map_offset, glbuffer->map_shadow.data(), glbuffer->map_length);
+		}
+	}
+
+	unmapBuffer(*glbuffer);
+	if (res != VK_SUCCESS) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+	}
+
+	return GL_TRUE;
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint *buffers) {
+	if (commandThreaded()) {
+		if (n < 1 || buffers == nullptr || static_cast<size_t>(n) * sizeof(GLuint) <= GLVK_COMMAND_DATA_LIMIT) {
+			deferCommand<glDeleteBuffers>(n, static_cast<const GLuint*>(commandCopy(buffers, n > 0 ? n * sizeof(GLuint) : 0)));
+			return;
+		}
+	}
+	GLVK_SYNC();
+
+	if (n < 1 || buffers == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* unused names and 0 are silently ignored, deleted buffers are unbound from every target */
+	for (GLsizei i = 0; i < n; ++i) {
+		glbuffer_t* glbuffer = glstate.buffers.get(buffers[i]);
+		if (glbuffer == nullptr) {
+			continue;
+		}
+
+		retireBufferStore(glbuffer->store);
+		unmapBuffer(*glbuffer);
+
+		GLuint* bindings[] = {
+			&glstate.bound_buffers.array,
+			&glstate.bound_buffers.element_array,
+			&glstate.bound_buffers.copy_read,
+			&glstate.bound_buffers.copy_write,
+			&glstate.bound_buffers.pixel_pack,
+			&glstate.bound_buffers.pixel_unpack,
+			&glstate.bound_buffers.transform_feedback,
+			&glstate.bound_buffers.uniform,
+			&glstate.bound_buffers.shader_storage,
+			&glstate.bound_buffers.texture,
+		};
+
+		for (GLuint* binding : bindings) {
+			if (*binding == buffers[i]) {
+				*binding = 0;
+			}
+		}
+
+		/* attachments of vertex arrays other than the bound one are left alone, their generation no longer resolves */
+		glvertexarray_t* vao = glstate.vertex_arrays.get(glstate.bound_vao);
+		if (vao != nullptr) {
+			for (glvertexattrib_t& attrib : vao->attribs) {
+				if (attrib.buffer == buffers[i]) {
+					attrib.buffer = 0;
+					vao->dirty = true;
+				}
+			}
+		}
+
+		for (GLuint index = 0; index < GLVK_MAX_UNIFORM_BUFFER_BINDINGS; ++index) {
+			if (glstate.indexed_buffers.uniform[index].buffer == buffers[i]) {
+				bindBufferRange(GL_UNIFORM_BUFFER, index, 0, 0, 0, true);
+			}
+		}
+		for (GLuint index = 0; index < GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS; ++index) {
+			if (glstate.indexed_buffers.storage[index].buffer == buffers[i]) {
+				bindBufferRange(GL_SHADER_STORAGE_BUFFER, index, 0, 0, 0, true);
+			}
+		}
+
+		glstate.buffers.destroy(buffers[i]);
+	}
+}
+
+void glGenVertexArrays(GLsizei n, GLuint* arrays) {
+	GLVK_SYNC();
+	if (n < 1) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	for (GLsizei i = 0; i < n; ++i) {
+		glvertexarray_t vao = {
+			.id = 0,
+			.attribs = {},
+			.element_array = 0,
+			.dirty = true,
+			.layout = 0,
+			.layout_hash = 0,
+			.binding_count = 0,
+			.binding_buffers = {},
+			.binding_offsets = {},
+		};
+		for (glvertexattrib_t& attrib : vao.attribs) {
+			attrib.size = 4;
+			attrib.type = GL_FLOAT;
+		}
+
+		arrays[i] = glstate.vertex_arrays.create(vao);
+		if (arrays[i] == 0) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return;
+		}
+
+		glstate.vertex_arrays.get(arrays[i])->id = arrays[i];
+	}
+}
+
+/* the element array binding is part of the vertex array, everything else is compared against the last draw by the next one */
+static void bindVertexArray(GLuint array) {
+	markState(array != glstate.bound_vao, 0);
+	if (array == glstate.bound_vao) {
+		return;
+	}
+
+	glvertexarray_t* current = glstate.vertex_arrays.get(glstate.bound_vao);
+	if (current != nullptr) {
+		current->element_array = glstate.bound_buffers.element_array;
+	} else {
+		glstate.default_element_array = glstate.bound_buffers.element_array;
+	}
+
+	glvertexarray_t* vao = glstate.vertex_arrays.get(array);
+	glstate.bound_buffers.element_array = (vao != nullptr) ? vao->element_array : glstate.default_element_array;
+	glstate.bound_vao = array;
+}
+
+void glDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+	if (commandThreaded()) {
+		if (n < 1 || arrays == nullptr || static_cast<size_t>(n) * sizeof(GLuint) <= GLVK_COMMAND_DATA_LIMIT) {
+			deferCommand<glDeleteVertexArrays>(n, static_cast<const GLuint*>(commandCopy(arrays, n > 0 ? n * sizeof(GLuint) : 0)));
+			return;
+		}
+	}
+	GLVK_SYNC();
+
+	if (n < 1 || arrays == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* unused names and 0 are silently ignored, deleting the bound vertex array binds 0 */
+	for (GLsizei i = 0; i < n; ++i) {
+		if (glstate.vertex_arrays.get(arrays[i]) == nullptr) {
+			continue;
+		}
+
+		if (glstate.bound_vao == arrays[i]) {
+			bindVertexArray(0);
+		}
+		glstate.vertex_arrays.destroy(arrays[i]);
+	}
+}
+
+void glBindVertexArray(GLuint array) {
+	GLVK_DEFER(glBindVertexArray, array);
+	if (array != 0 && glstate.vertex_arrays.get(array) == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	bindVertexArray(array);
+}
+
+GLboolean glIsVertexArray(GLuint array) {
+	GLVK_SYNC();
+	return (glstate.vertex_arrays.get(array) != nullptr) ? GL_TRUE : GL_FALSE;
+}
+
+/* the bound vertex array when index names one of its attributes, nullptr with the error pushed otherwise */
+static glvertexarray_t* attribArray(GLuint index) {
+	if (index >= GLVK_MAX_VERTEX_ATTRIBS) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return nullptr;
+	}
+
+	/* vertex array 0 only exists to read the built-in vertex format */
+	glvertexarray_t* vao = glstate.vertex_arrays.get(glstate.bound_vao);
+	if (vao == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return nullptr;
+	}
+
+	return vao;
+}
+
+static void setAttribEnabled(GLuint index, bool enabled) {
+	glvertexarray_t* vao = attribArray(index);
+	if (vao == nullptr) {
+		return;
+	}
+
+	bool changed = vao->attribs[index].enabled != enabled;
+	markState(changed, 0);
+	vao->attribs[index].enabled = enabled;
+	vao->dirty |= changed;
+}
+
+void glEnableVertexAttribArray(GLuint index) {
+	GLVK_DEFER(glEnableVertexAttribArray, index);
+	setAttribEnabled(index, true);
+}
+
+void glDisableVertexAttribArray(GLuint index) {
+	GLVK_DEFER(glDisableVertexAttribArray, index);
+	setAttribEnabled(index, false);
+}
+
+static void vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer, bool integer) {
+	if (size < 1 || size > 4 || stride < 0 || stride > GLVK_MAX_VERTEX_ATTRIB_STRIDE) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	bool packed = type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV;
+	bool valid_type =
+		type == GL_BYTE || type == GL_UNSIGNED_BYTE ||
+		type == GL_SHORT || type == GL_UNSIGNED_SHORT ||
+		type == GL_INT || type == GL_UNSIGNED_INT;
+	if (!integer) {
+		valid_type |= type == GL_HALF_FLOAT || type == GL_FLOAT || type == GL_FIXED || type == GL_DOUBLE || packed;
+	}
+	if (!valid_type) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (packed && size != 4) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	glvertexarray_t* vao = attribArray(index);
+	if (vao == nullptr) {
+		return;
+	}
+
+	/* client side arrays are not supported, pointer is an offset into the array buffer */
+	GLuint buffer = glstate.bound_buffers.array;
+	if (buffer == 0 && pointer != nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	glvertexattrib_t& attrib = vao->attribs[index];
+	GLintptr offset = static_cast<GLintptr>(reinterpret_cast<uintptr_t>(pointer));
+	bool changed =
+		attrib.integer != integer || attrib.normalized != normalized || attrib.size != size || attrib.type != type ||
+		attrib.stride != stride || attrib.buffer != buffer || attrib.offset != offset;
+	markState(changed, 0);
+
+	attrib.integer = integer;
+	attrib.normalized = integer ? GL_FALSE : normalized;
+	attrib.size = size;
+	attrib.type = type;
+	attrib.stride = stride;
+	attrib.buffer = buffer;
+	attrib.offset = offset;
+	vao->dirty |= changed;
+}
+
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+	GLVK_DEFER(glVertexAttribPointer, index, size, type, normalized, stride, pointer);
+	vertexAttribPointer(index, size, type, normalized, stride, pointer, false);
+}
+
+void glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer) {
+	GLVK_DEFER(glVertexAttribIPointer, index, size, type, stride, pointer);
+	vertexAttribPointer(index, size, type, GL_FALSE, stride, pointer, true);
+}
+
+void glVertexAttribDivisor(GLuint index, GLuint divisor) {
+	GLVK_DEFER(glVertexAttribDivisor, index, divisor);
+	glvertexarray_t* vao = attribArray(index);
+	if (vao == nullptr) {
+		return;
+	}
+
+	bool changed = vao->attribs[index].divisor != divisor;
+	markState(changed, 0);
+	vao->attribs[index].divisor = divisor;
+	vao->dirty |= changed;
+}
+
+void glGenTextures(GLsizei n, GLuint* textures) {
+	GLVK_SYNC();
+	if (n < 1) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	for (GLsizei i = 0; i < n; ++i) {
+		gltexture_t texture = {
+			.id = 0,
+			.target = 0,
+			.store = {},
+			.internal_format = 0,
+			.format = VK_FORMAT_UNDEFINED,
+			.width = 0,
+			.height = 0,
+			.levels = 0,
+			.immutable = false,
+			.sampler_state = defaultSamplerState(),
+			.sampler = VK_NULL_HANDLE,
+		};
+
+		textures[i] = glstate.textures.create(texture);
+		if (textures[i] == 0) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return;
+		}
+
+		glstate.textures.get(textures[i])->id = textures[i];
+	}
+}
+
+/* binds texture to a unit, draws resolve the unit to a descriptor */
+static void bindTexture(uint32_t unit, GLuint texture) {
+	gltextureunit_t& binding = glstate.texture_units[unit];
+	markState(binding.texture != texture, 0);
+	binding.texture = texture;
+
+	if (texture != 0) {
+		glstate.texture_mask |= 1u << unit;
+		return;
+	}
+
+	glstate.texture_mask &= ~(1u << unit);
+	if (glstate.bindings.textures[unit] != GLVK_NO_DESCRIPTOR || glstate.binding_set.textures[unit].handle != 0) {
+		glstate.bindings.textures[unit] = GLVK_NO_DESCRIPTOR;
+		glstate.binding_set.textures[unit] = {};
+		glstate.dirty |= DIRTY_DESCRIPTORS;
+	}
+}
+
+void glDeleteTextures(GLsizei n, const GLuint* textures) {
+	if (commandThreaded()) {
+		if (n < 1 || textures == nullptr || static_cast<size_t>(n) * sizeof(GLuint) <= GLVK_COMMAND_DATA_LIMIT) {
+			deferCommand<glDeleteTextures>(n, static_cast<const GLuint*>(commandCopy(textures, n > 0 ? n * sizeof(GLuint) : 0)));
+			return;
+		}
+	}
+	GLVK_SYNC();
+
+	if (n < 1 || textures == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* unused names and 0 are silently ignored, deleted textures are unbound from every unit */
+	for (GLsizei i = 0; i < n; ++i) {
+		gltexture_t* texture = glstate.textures.get(textures[i]);
+		if (texture == nullptr) {
+			continue;
+		}
+
+		retireImageStore(texture->store);
+		releaseSampler(texture->sampler_state, texture->sampler);
+		for (uint32_t unit = 0; unit < GLVK_MAX_TEXTURE_UNITS; ++unit) {
+			if (glstate.texture_units[unit].texture == textures[i]) {
+				bindTexture(unit, 0);
+			}
+		}
+
+		glstate.textures.destroy(textures[i]);
+	}
+}
+
+GLboolean glIsTexture(GLuint texture) {
+	GLVK_SYNC();
+	/* a generated name only becomes a texture object once it is bound */
+	gltexture_t* object = glstate.textures.get(texture);
+	return (object != nullptr && object->target != 0) ? GL_TRUE : GL_FALSE;
+}
+
+void glActiveTexture(GLenum texture) {
+	GLVK_DEFER(glActiveTexture, texture);
+	if (texture < GL_TEXTURE0 || texture >= GL_TEXTURE0 + GLVK_MAX_TEXTURE_UNITS) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	markState(glstate.active_texture != texture - GL_TEXTURE0, 0);
+	glstate.active_texture = texture - GL_TEXTURE0;
+}
+
+void glBindTexture(GLenum target, GLuint texture) {
+	GLVK_DEFER(glBindTexture, target, texture);
+	/* the bindless texture array holds sampler2D descriptors, other view types have nowhere to go */
+	if (target != GL_TEXTURE_2D) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Texture target {} is not supported", target);
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	gltexture_t* object = glstate.textures.get(texture);
+	if (texture != 0 && (object == nullptr || (object->target != 0 && object->target != target))) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	if (object != nullptr) {
+		object->target = target;
+	}
+	bindTexture(glstate.active_texture, texture);
+}
+
+/* the texture bound to target on the active unit, nullptr with the error pushed when there is none */
+static gltexture_t* boundTexture(GLenum target) {
+	if (target != GL_TEXTURE_2D) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return nullptr;
+	}
+
+	/* there is no default texture object */
+	gltexture_t* texture = glstate.textures.get(glstate.texture_units[glstate.active_texture].texture);
+	if (texture == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return nullptr;
+	}
+
+	return texture;
+}
+
+/* gives a texture a new image, the old one is orphaned for frames in flight that still sample it */
+static bool specifyTexture(gltexture_t& texture, const textureformat_t& format, uint32_t width, uint32_t height, uint32_t levels) {
+	retireImageStore(texture.store);
+	texture.internal_format = format.internal_format;
+	texture.format = format.vk_format;
+	texture.width = width;
+	texture.height = height;
+	texture.levels = 0;
+	if (width == 0 || height == 0) {
+		return true;
+	}
+
+	VkResult res = createImageStore(format.vk_format, width, height, levels, texture.store);
+	if (res != VK_SUCCESS) {
+		if (res == VK_ERROR_OUT_OF_HOST_MEMORY || res == VK_ERROR_OUT_OF_DEVICE_MEMORY || res == VK_ERROR_TOO_MANY_OBJECTS) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+		} else {
+			GLPUSHERROR(GL_INVALID_OPERATION);
+		}
+		return false;
+	}
+
+	texture.levels = levels;
+	return true;
+}
+
+static bool validTextureSize(GLsizei width, GLsizei height) {
+	GLsizei max_size = static_cast<GLsizei>(vkstate.physical.properties.limits.maxImageDimension2D);
+	return width >= 0 && height >= 0 && width <= max_size && height <= max_size;
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+	/* pixels are read with the unpack state the worker holds, so only calls without any are deferred */
+	if (pixels == nullptr) {
+		GLVK_DEFER(glTexImage2D, target, level, internalformat, width, height, border, format, type, pixels);
+	}
+	GLVK_SYNC();
+
+	gltexture_t* texture = boundTexture(target);
+	if (texture == nullptr) {
+		return;
+	}
+
+	if (level < 0 || level >= 32 || border != 0 || !validTextureSize(width, height)) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	const textureformat_t* texture_format = textureFormat(static_cast<GLenum>(internalformat), type);
+	if (texture_format == nullptr) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Texture format {} with type {} is not supported", internalformat, type);
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (texture->immutable || !uploadFormat(*texture_format, format, type)) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	uint32_t level_width = static_cast<uint32_t>(width);
+	uint32_t level_height = static_cast<uint32_t>(height);
+	unpacksource_t source;
+	if (!unpackSource(*texture_format, format, level_width, level_height, pixels, source)) {
+		return;
+	}
+
+	if (level == 0) {
+		/* re-specifying level 0 as it is keeps the image and its other levels */
+		bool same = texture->store.image != VK_NULL_HANDLE && texture->internal_format == texture_format->internal_format && texture->width == level_width && texture->height == level_height;
+		if (!same && !specifyTexture(*texture, *texture_format, level_width, level_height, 1)) {
+			return;
+		}
+	} else {
+		/* levels are kept in one image, so they have to continue the chain level 0 started */
+		if (texture->store.image == VK_NULL_HANDLE || texture->internal_format != texture_format->internal_format ||
+			level_width != std::max(texture->width >> level, 1u) || level_height != std::max(texture->height >> level, 1u) ||
+			static_cast<uint32_t>(level) >= mipLevels(texture->width, texture->height)) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Texture levels have to match the size and format of level 0");
+			GLPUSHERROR(GL_INVALID_OPERATION);
+			return;
+		}
+
+		if (static_cast<uint32_t>(level) >= texture->levels && renameTexture(*texture, mipLevels(texture->width, texture->height)) != VK_SUCCESS) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return;
+		}
+	}
+
+	/* with a pixel unpack buffer bound pixels is an offset into it, 0 included */
+	if ((pixels == nullptr && source.buffer == nullptr) || width == 0 || height == 0) {
+		return;
+	}
+
+	if (prepareTextureWrite(*texture) != VK_SUCCESS) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+		return;
+	}
+
+	if (source.buffer != nullptr) {
+		uploadTextureBuffer(*texture, static_cast<uint32_t>(level), 0, 0, level_width, level_height, source);
+	} else {
+		uploadTexture(*texture, *texture_format, format, static_cast<uint32_t>(level), 0, 0, level_width, level_height, pixels);
+	}
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+	if (pixels == nullptr) {
+		GLVK_DEFER(glTexSubImage2D, target, level, xoffset, yoffset, width, height, format, type, pixels);
+	}
+	GLVK_SYNC();
+
+	gltexture_t* texture = boundTexture(target);
+	if (texture == nullptr) {
+		return;
+	}
+
+	if (level < 0 || static_cast<uint32_t>(level) >= texture->levels || xoffset < 0 || yoffset < 0 || width < 0 || height < 0 ||
+		static_cast<uint64_t>(xoffset) + width > std::max(texture->width >> level, 1u) ||
+		static_cast<uint64_t>(yoffset) + height > std::max(texture->height >> level, 1u)) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	const textureformat_t* texture_format = textureFormat(texture->format, texture->internal_format);
+	if (texture_format == nullptr || !uploadFormat(*texture_format, format, type)) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	unpacksource_t source;
+	if (!unpackSource(*texture_format, format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), pixels, source)) {
+		return;
+	}
+
+	if ((pixels == nullptr && source.buffer == nullptr) || width == 0 || height == 0) {
+		return;
+	}
+
+	if (prepareTextureWrite(*texture) != VK_SUCCESS) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+		return;
+	}
+
+	if (source.buffer != nullptr) {
+		uploadTextureBuffer(*texture, static_cast<uint32_t>(level), xoffset, yoffset, static_cast<uint32_t>(width), static_cast<uint32_t>(height), source);
+	} else {
+		uploadTexture(*texture, *texture_format, format, static_cast<uint32_t>(level), xoffset, yoffset, static_cast<uint32_t>(width), static_cast<uint32_t>(height), pixels);
+	}
+}
+
+void glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height) {
+	GLVK_DEFER(glTexStorage2D, target, levels, internalformat, width, height);
+	gltexture_t* texture = boundTexture(target);
+	if (texture == nullptr) {
+		return;
+	}
+
+	if (levels < 1 || width < 1 || height < 1 || !validTextureSize(width, height)) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* storage takes sized formats only */
+	const textureformat_t* texture_format = textureFormat(internalformat, 0);
+	if (texture_format == nullptr || texture_format->internal_format != internalformat) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (texture->immutable || static_cast<uint32_t>(levels) > mipLevels(width, height)) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	if (specifyTexture(*texture, *texture_format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint32_t>(levels))) {
+		texture->immutable = true;
+	}
+}
+
+void glGenerateMipmap(GLenum target) {
+	GLVK_DEFER(glGenerateMipmap, target);
+	gltexture_t* texture = boundTexture(target);
+	if (texture == nullptr) {
+		return;
+	}
+
+	if (texture->store.image == VK_NULL_HANDLE) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	if (prepareTextureWrite(*texture) != VK_SUCCESS) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+		return;
+	}
+
+	/* a mutable texture gets its full chain now, storage textures fill the levels they were given */
+	uint32_t levels = mipLevels(texture->width, texture->height);
+	if (!texture->immutable && texture->levels < levels && renameTexture(*texture, levels) != VK_SUCCESS) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+		return;
+	}
+
+	generateMips(*texture);
+}
+
+void glPixelStorei(GLenum pname, GLint param) {
+	GLVK_DEFER(glPixelStorei, pname, param);
+	GLint* value = nullptr;
+	if (pname == GL_UNPACK_ALIGNMENT || pname == GL_PACK_ALIGNMENT) {
+		if (param != 1 && param != 2 && param != 4 && param != 8) {
+			GLPUSHERROR(GL_INVALID_VALUE);
+			return;
+		}
+		value = (pname == GL_UNPACK_ALIGNMENT) ? &glstate.unpack.alignment : &glstate.pack.alignment;
+	} else if (pname == GL_UNPACK_ROW_LENGTH) {
+		value = &glstate.unpack.row_length;
+	} else if (pname == GL_UNPACK_SKIP_ROWS) {
+		value = &glstate.unpack.skip_rows;
+	} else if (pname == GL_UNPACK_SKIP_PIXELS) {
+		value = &glstate.unpack.skip_pixels;
+	} else if (pname == GL_PACK_ROW_LENGTH) {
+		value = &glstate.pack.row_length;
+	} else if (pname == GL_PACK_SKIP_ROWS) {
+		value = &glstate.pack.skip_rows;
+	} else if (pname == GL_PACK_SKIP_PIXELS) {
+		value = &glstate.pack.skip_pixels;
+	} else if (pname == GL_UNPACK_IMAGE_HEIGHT || pname == GL_UNPACK_SKIP_IMAGES || pname == GL_PACK_IMAGE_HEIGHT || pname == GL_PACK_SKIP_IMAGES) {
+		/* only 2d images are transferred, which never read these */
+		if (param < 0) {
+			GLPUSHERROR(GL_INVALID_VALUE);
+		} else if (param != 0) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Pixel store parameter {} is ignored, there are no 3d textures", pname);
+		}
+		return;
+	} else if (pname == GL_UNPACK_SWAP_BYTES || pname == GL_UNPACK_LSB_FIRST || pname == GL_PACK_SWAP_BYTES || pname == GL_PACK_LSB_FIRST) {
+		if (param != 0) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Pixel store parameter {} is not supported, pixels are read in host byte order", pname);
+		}
+		return;
+	} else {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (param < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	markState(*value != param, 0);
+	*value = param;
+}
+
+/* applies a glSamplerParameter/glTexParameter value to a state, dropping the reference to the old state's sampler when it changes.
+ * enum parameters read ivalue, the others fvalue. the border color only comes from the vector entry points, ivalue is non-zero when it is not transparent black */
+static void samplerParameter(samplerstate_t& sampler_state, VkSampler& sampler, GLenum pname, GLint ivalue, GLfloat fvalue, bool vector) {
+	samplerstate_t changed = sampler_state;
+	GLenum value = static_cast<GLenum>(ivalue);
+	if (pname == GL_TEXTURE_BORDER_COLOR) {
+		/* borders are always transparent black, the one gl border color that needs no custom border color support */
+		if (!vector) {
+			GLPUSHERROR(GL_INVALID_ENUM);
+		} else if (ivalue != 0) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Border colors other than transparent black are not supported");
+		}
+		return;
+	} else if (pname == GL_TEXTURE_MIN_FILTER) {
+		if (value != GL_NEAREST && value != GL_LINEAR && value != GL_NEAREST_MIPMAP_NEAREST && value != GL_LINEAR_MIPMAP_NEAREST &&
+			value != GL_NEAREST_MIPMAP_LINEAR && value != GL_LINEAR_MIPMAP_LINEAR) {
+			GLPUSHERROR(GL_INVALID_ENUM);
+			return;
+		}
+		changed.min_filter = value;
+	} else if (pname == GL_TEXTURE_MAG_FILTER) {
+		if (value != GL_NEAREST && value != GL_LINEAR) {
+			GLPUSHERROR(GL_INVALID_ENUM);
+			return;
+		}
+		changed.mag_filter = value;
+	} else if (pname == GL_TEXTURE_WRAP_S || pname == GL_TEXTURE_WRAP_T || pname == GL_TEXTURE_WRAP_R) {
+		if (samplerAddressMode(value) == VK_SAMPLER_ADDRESS_MODE_MAX_ENUM) {
+			GLPUSHERROR(GL_INVALID_ENUM);
+			return;
+		}
+		GLenum& wrap = (pname == GL_TEXTURE_WRAP_S) ? changed.wrap_s : (pname == GL_TEXTURE_WRAP_T) ? changed.wrap_t : changed.wrap_r;
+		wrap = value;
+	} else if (pname == GL_TEXTURE_COMPARE_MODE) {
+		if (value != GL_NONE && value != GL_COMPARE_REF_TO_TEXTURE) {
+			GLPUSHERROR(GL_INVALID_ENUM);
+			return;
+		}
+		changed.compare_mode = value;
+	} else if (pname == GL_TEXTURE_COMPARE_FUNC) {
+		if (value < GL_NEVER || value > GL_ALWAYS) {
+			GLPUSHERROR(GL_INVALID_ENUM);
+			return;
+		}
+		changed.compare_func = value;
+	} else if (pname == GL_TEXTURE_MIN_LOD) {
+		changed.min_lod = fvalue;
+	} else if (pname == GL_TEXTURE_MAX_LOD) {
+		changed.max_lod = fvalue;
+	} else if (pname == GL_TEXTURE_LOD_BIAS) {
+		changed.lod_bias = fvalue;
+	} else if (pname == GL_TEXTURE_MAX_ANISOTROPY) {
+		if (fvalue < 1.0f) {
+			GLPUSHERROR(GL_INVALID_VALUE);
+			return;
+		}
+		changed.max_anisotropy = fvalue;
+	} else {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Sampler parameter {} is not supported", pname);
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	bool modified = !samplerstateequal_t()(changed, sampler_state);
+	markState(modified, 0);
+	if (modified) {
+		releaseSampler(sampler_state, sampler);
+		sampler_state = changed;
+	}
+}
+
+void glGenSamplers(GLsizei count, GLuint* samplers) {
+	GLVK_SYNC();
+	if (count < 1) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	for (GLsizei i = 0; i < count; ++i) {
+		glsampler_t sampler = {
+			.id = 0,
+			.state = defaultSamplerState(),
+			.sampler = VK_NULL_HANDLE,
+		};
+
+		samplers[i] = glstate.samplers.create(sampler);
+		if (samplers[i] == 0) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return;
+		}
+
+		glstate.samplers.get(samplers[i])->id = samplers[i];
+	}
+}
+
+void glDeleteSamplers(GLsizei count, const GLuint* samplers) {
+	if (commandThreaded()) {
+		if (count < 1 || samplers == nullptr || static_cast<size_t>(count) * sizeof(GLuint) <= GLVK_COMMAND_DATA_LIMIT) {
+			deferCommand<glDeleteSamplers>(count, static_cast<const GLuint*>(commandCopy(samplers, count > 0 ? count * sizeof(GLuint) : 0)));
+			return;
+		}
+	}
+	GLVK_SYNC();
+
+	if (count < 1 || samplers == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* unused names and 0 are silently ignored, deleted samplers are unbound from every unit */
+	for (GLsizei i = 0; i < count; ++i) {
+		glsampler_t* sampler = glstate.samplers.get(samplers[i]);
+		if (sampler == nullptr) {
+			continue;
+		}
+
+		releaseSampler(sampler->state, sampler->sampler);
+		for (gltextureunit_t& unit : glstate.texture_units) {
+			if (unit.sampler == samplers[i]) {
+				unit.sampler = 0;
+			}
+		}
+
+		glstate.samplers.destroy(samplers[i]);
+	}
+}
+
+GLboolean glIsSampler(GLuint sampler) {
+	GLVK_SYNC();
+	return (glstate.samplers.get(sampler) != nullptr) ? GL_TRUE : GL_FALSE;
+}
+
+void glBindSampler(GLuint unit, GLuint sampler) {
+	GLVK_DEFER(glBindSampler, unit, sampler);
+	if (unit >= GLVK_MAX_TEXTURE_UNITS) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (sampler != 0 && glstate.samplers.get(sampler) == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	markState(glstate.texture_units[unit].sampler != sampler, 0);
+	glstate.texture_units[unit].sampler = sampler;
+}
+
+/* applies a glSamplerParameter value to a sampler object, vector is set for the entry points that take the border color */
+static void samplerObjectParameter(GLuint sampler, GLenum pname, GLint ivalue, GLfloat fvalue, bool vector) {
+	GLVK_DEFER(samplerObjectParameter, sampler, pname, ivalue, fvalue, vector);
+	glsampler_t* object = glstate.samplers.get(sampler);
+	if (object == nullptr) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	samplerParameter(object->state, object->sampler, pname, ivalue, fvalue, vector);
+}
+
+/* the ivalue of a vector parameter, for the border color whether it is other than transparent black */
+template<typename T>
+static GLint vectorParameter(GLenum pname, const T* params) {
+	if (pname != GL_TEXTURE_BORDER_COLOR) {
+		return static_cast<GLint>(params[0]);
+	}
+
+	return (params[0] != 0 || params[1] != 0 || params[2] != 0 || params[3] != 0) ? 1 : 0;
+}
+
+void glSamplerParameteri(GLuint sampler, GLenum pname, GLint param) {
+	samplerObjectParameter(sampler, pname, param, static_cast<GLfloat>(param), false);
+}
+
+void glSamplerParameterf(GLuint sampler, GLenum pname, GLfloat param) {
+	samplerObjectParameter(sampler, pname, static_cast<GLint>(param), param, false);
+}
+
+void glSamplerParameteriv(GLuint sampler, GLenum pname, const GLint* params) {
+	samplerObjectParameter(sampler, pname, vectorParameter(pname, params), static_cast<GLfloat>(params[0]), true);
+}
+
+void glSamplerParameterfv(GLuint sampler, GLenum pname, const GLfloat* params) {
+	samplerObjectParameter(sampler, pname, vectorParameter(pname, params), params[0], true);
+}
+
+/* applies a glTexParameter value to the texture bound to target. level ranges are not sampler state and not supported beyond their defaults */
+static void texParameter(GLenum target, GLenum pname, GLint ivalue, GLfloat fvalue, bool vector) {
+	GLVK_DEFER(texParameter, target, pname, ivalue, fvalue, vector);
+	gltexture_t* texture = boundTexture(target);
+	if (texture == nullptr) {
+		return;
+	}
+
+	if (pname == GL_TEXTURE_BASE_LEVEL || pname == GL_TEXTURE_MAX_LEVEL) {
+		if (ivalue < 0) {
+			GLPUSHERROR(GL_INVALID_VALUE);
+		} else if (pname == GL_TEXTURE_BASE_LEVEL ? ivalue != 0 : ivalue < 1000) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Texture level ranges are not supported, every level is sampled");
+		}
+		return;
+	}
+
+	samplerParameter(texture->sampler_state, texture->sampler, pname, ivalue, fvalue, vector);
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+	texParameter(target, pname, param, static_cast<GLfloat>(param), false);
+}
+
+void glTexParameterf(GLenum target, GLenum pname, GLfloat param) {
+	texParameter(target, pname, static_cast<GLint>(param), param, false);
+}
+
+void glTexParameteriv(GLenum target, GLenum pname, const GLint* params) {
+	texParameter(target, pname, vectorParameter(pname, params), static_cast<GLfloat>(params[0]), true);
+}
+
+void glTexParameterfv(GLenum target, GLenum pname, const GLfloat* params) {
+	texParameter(target, pname, vectorParameter(pname, params), params[0], true);
+}
+
+GLuint glCreateShader(GLenum type) {
+	GLVK_SYNC();
+	if (type != GL_VERTEX_SHADER && type != GL_FRAGMENT_SHADER) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Shader type {} is not supported", type);
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return 0;
+	}
+
+	glshader_t shader = {
+		.id = 0,
+		.type = type,
+		.source = "",
+		.spirv = {},
+		.info_log = "",
+		.compiled = false,
+		.delete_pending = false,
+		.attach_count = 0,
+	};
+
+	GLuint name = glstate.shaders.create(shader);
+	if (name == 0) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+		return 0;
+	}
+
+	glstate.shaders.get(name)->id = name;
+	return name;
+}
+
+/* destroys a shader once it is deleted and no longer attached to any program */
+static void releaseShader(GLuint name) {
+	glshader_t* shader = glstate.shaders.get(name);
+	if (shader != nullptr && shader->delete_pending && shader->attach_count == 0) {
+		glstate.shaders.destroy(name);
+	}
+}
+
+void glDeleteShader(GLuint shader) {
+	GLVK_DEFER(glDeleteShader, shader);
+	if (shader == 0) {
+		return;
+	}
+
+	glshader_t* object = glstate.shaders.get(shader);
+	if (object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	object->delete_pending = true;
+	releaseShader(shader);
+}
+
+GLboolean glIsShader(GLuint shader) {
+	GLVK_SYNC();
+	return (glstate.shaders.get(shader) != nullptr) ? GL_TRUE : GL_FALSE;
+}
+
+void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+	GLVK_SYNC();
+	glshader_t* object = glstate.shaders.get(shader);
+	if (object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (count < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* a negative or missing length means the string is null terminated */
+	object->source.clear();
+	for (GLsizei i = 0; i < count; ++i) {
+		if (length != nullptr && length[i] >= 0) {
+			object->source.append(string[i], length[i]);
+		} else {
+			object->source.append(string[i]);
+		}
+	}
+}
+
+void glCompileShader(GLuint shader) {
+	GLVK_DEFER(glCompileShader, shader);
+	glshader_t* object = glstate.shaders.get(shader);
+	if (object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	compileShader(*object);
+	if (!object->compiled) {
+		GLVKDEBUGF(GLVK_TYPE_OPENGL, GLVK_SEVERITY_WARNING, "Shader {} failed to compile:\n{}", shader, object->info_log);
+	}
+}
+
+/* copies an info log the way glGet*InfoLog do, truncated to size including the terminator */
+static void copyInfoLog(const std::string& log, GLsizei size, GLsizei* length, GLchar* info_log) {
+	if (size < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	GLsizei count = (size > 0) ? std::min(size - 1, static_cast<GLsizei>(log.size())) : 0;
+	if (size > 0 && info_log != nullptr) {
+		memcpy(info_log, log.data(), count);
+		info_log[count] = '\0';
+	}
+
+	if (length != nullptr) {
+		*length = count;
+	}
+}
+
+void glGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+	GLVK_SYNC();
+	glshader_t* object = glstate.shaders.get(shader);
+	if (object == nullptr) {
+		if (glstate.programs.get(shader) != nullptr) {
+			GLPUSHERROR(GL_INVALID_OPERATION);
+		} else {
+			GLPUSHERROR(GL_INVALID_VALUE);
+		}
+		return;
+	}
+
+	switch (pname) {
+	case GL_SHADER_TYPE:
+		*params = static_cast<GLint>(object->type);
+		break;
+	case GL_DELETE_STATUS:
+		*params = object->delete_pending ? GL_TRUE : GL_FALSE;
+		break;
+	case GL_COMPILE_STATUS:
+		*params = object->compiled ? GL_TRUE : GL_FALSE;
+		break;
+	case GL_INFO_LOG_LENGTH:
+		*params = object->info_log.empty() ? 0 : static_cast<GLint>(object->info_log.size() + 1);
+		break;
+	case GL_SHADER_SOURCE_LENGTH:
+		*params = object->source.empty() ? 0 : static_cast<GLint>(object->source.size() + 1);
+		break;
+	default:
+		GLPUSHERROR(GL_INVALID_ENUM);
+		break;
+	}
+}
+
+void glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+	GLVK_SYNC();
+	glshader_t* object = glstate.shaders.get(shader);
+	if (object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	copyInfoLog(object->info_log, bufSize, length, infoLog);
+}
+
+GLuint glCreateProgram(void) {
+	GLVK_SYNC();
+	glprogram_t program = {
+		.id = 0,
+		.shaders = {},
+		.link = 0,
+		.linked = false,
+		.info_log = "",
+		.delete_pending = false,
+	};
+
+	GLuint name = glstate.programs.create(program);
+	if (name == 0) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+		return 0;
+	}
+
+	glstate.programs.get(name)->id = name;
+	return name;
+}
+
+/* drops the modules of the program's executable. pipelines built from them leave the cache and are retired with the frame
+ * being recorded, link numbers are never reused so nothing looks them up again */
+static void unlinkProgram(glprogram_t& program) {
+	auto it = vkstate.shaders.programs.find(program.link);
+	if (it != vkstate.shaders.programs.end()) {
+		destroyProgramModules(it->second);
+		vkstate.shaders.programs.erase(it);
+	}
+
+	auto& cache = vkstate.pipelines.cache;
+	for (auto entry = cache.begin(); program.link != 0 && entry != cache.end();) {
+		if (entry->first.program != program.link) {
+			++entry;
+			continue;
+		}
+
+		if (entry->second != VK_NULL_HANDLE) {
+			prepareFrame().retired_pipelines.push_back(entry->second);
+			if (glstate.pipeline == entry->second) {
+				glstate.pipeline = VK_NULL_HANDLE;
+				glstate.dirty |= DIRTY_PIPELINE;
+			}
+		}
+		entry = cache.erase(entry);
+	}
+
+	program.link = 0;
+}
+
+static void destroyProgram(GLuint name) {
+	glprogram_t* program = glstate.programs.get(name);
+	unlinkProgram(*program);
+
+	std::vector<GLuint> shaders = std::move(program->shaders);
+	glstate.programs.destroy(name);
+	for (GLuint shader : shaders) {
+		glshader_t* object = glstate.shaders.get(shader);
+		if (object != nullptr) {
+			--object->attach_count;
+			releaseShader(shader);
+		}
+	}
+}
+
+void glDeleteProgram(GLuint program) {
+	GLVK_DEFER(glDeleteProgram, program);
+	if (program == 0) {
+		return;
+	}
+
+	glprogram_t* object = glstate.programs.get(program);
+	if (object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* the current program keeps drawing until another one is used */
+	if (glstate.program == program) {
+		object->delete_pending = true;
+		return;
+	}
+
+	destroyProgram(program);
+}
+
+GLboolean glIsProgram(GLuint program) {
+	GLVK_SYNC();
+	return (glstate.programs.get(program) != nullptr) ? GL_TRUE : GL_FALSE;
+}
+
+void glAttachShader(GLuint program, GLuint shader) {
+	GLVK_DEFER(glAttachShader, program, shader);
+	glprogram_t* object = glstate.programs.get(program);
+	glshader_t* shader_object = glstate.shaders.get(shader);
+	if (object == nullptr || shader_object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (std::find(object->shaders.begin(), object->shaders.end(), shader) != object->shaders.end()) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	object->shaders.push_back(shader);
+	++shader_object->attach_count;
+}
+
+void glDetachShader(GLuint program, GLuint shader) {
+	GLVK_DEFER(glDetachShader, program, shader);
+	glprogram_t* object = glstate.programs.get(program);
+	glshader_t* shader_object = glstate.shaders.get(shader);
+	if (object == nullptr || shader_object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	auto it = std::find(object->shaders.begin(), object->shaders.end(), shader);
+	if (it == object->shaders.end()) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	object->shaders.erase(it);
+	--shader_object->attach_count;
+	releaseShader(shader);
+}
+
+/* builds the modules of a program from its attached shaders, returns false with the reason in the info log */
+static bool linkProgram(glprogram_t& program, programmodules_t& modules) {
+	glshader_t* vertex = nullptr;
+	glshader_t* fragment = nullptr;
+	for (GLuint name : program.shaders) {
+		glshader_t* shader = glstate.shaders.get(name);
+		glshader_t*& stage = (shader->type == GL_VERTEX_SHADER) ? vertex : fragment;
+		if (stage != nullptr) {
+			program.info_log = "ERROR: more than one shader of a stage is attached\n";
+			return false;
+		}
+
+		if (!shader->compiled) {
+			program.info_log = "ERROR: shader " + std::to_string(name) + " is not compiled\n";
+			return false;
+		}
+
+		stage = shader;
+	}
+
+	if (vertex == nullptr || fragment == nullptr) {
+		program.info_log = "ERROR: programs need a vertex and a fragment shader\n";
+		return false;
+	}
+
+	modules.vertex = createShaderModule(vertex->spirv);
+	modules.fragment = createShaderModule(fragment->spirv);
+	if (modules.vertex == VK_NULL_HANDLE || modules.fragment == VK_NULL_HANDLE) {
+		program.info_log = "ERROR: failed to create shader modules\n";
+		destroyProgramModules(modules);
+		return false;
+	}
+
+	return true;
+}
+
+void glLinkProgram(GLuint program) {
+	GLVK_DEFER(glLinkProgram, program);
+	glprogram_t* object = glstate.programs.get(program);
+	if (object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	object->info_log.clear();
+	programmodules_t modules = { .vertex = VK_NULL_HANDLE, .fragment = VK_NULL_HANDLE };
+	object->linked = linkProgram(*object, modules);
+	if (!object->linked) {
+		GLVKDEBUGF(GLVK_TYPE_OPENGL, GLVK_SEVERITY_WARNING, "Program {} failed to link:\n{}", program, object->info_log);
+		/* a current program keeps its last executable until it links again or another one is used */
+		if (glstate.program != program) {
+			unlinkProgram(*object);
+		}
+		return;
+	}
+
+	unlinkProgram(*object);
+	object->link = ++vkstate.shaders.link_count;
+	vkstate.shaders.programs.emplace(object->link, modules);
+	if (glstate.program == program) {
+		glstate.dirty |= DIRTY_PIPELINE;
+	}
+}
+
+void glUseProgram(GLuint program) {
+	GLVK_DEFER(glUseProgram, program);
+	if (program != 0) {
+		glprogram_t* object = glstate.programs.get(program);
+		if (object == nullptr) {
+			GLPUSHERROR(GL_INVALID_VALUE);
+			return;
+		}
+
+		if (!object->linked) {
+			GLPUSHERROR(GL_INVALID_OPERATION);
+			return;
+		}
+	}
+
+	GLuint previous = glstate.program;
+	markState(previous != program, DIRTY_PIPELINE);
+	glstate.program = program;
+
+	glprogram_t* previous_object = glstate.programs.get(previous);
+	if (previous != program && previous_object != nullptr && previous_object->delete_pending) {
+		destroyProgram(previous);
+	}
+}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+	GLVK_SYNC();
+	glprogram_t* object = glstate.programs.get(program);
+	if (object == nullptr) {
+		if (glstate.shaders.get(program) != nullptr) {
+			GLPUSHERROR(GL_INVALID_OPERATION);
+		} else {
+			GLPUSHERROR(GL_INVALID_VALUE);
+		}
+		return;
+	}
+
+	switch (pname) {
+	case GL_DELETE_STATUS:
+		*params = object->delete_pending ? GL_TRUE : GL_FALSE;
+		break;
+	case GL_LINK_STATUS:
+		*params = object->linked ? GL_TRUE : GL_FALSE;
+		break;
+	case GL_INFO_LOG_LENGTH:
+		*params = object->info_log.empty() ? 0 : static_cast<GLint>(object->info_log.size() + 1);
+		break;
+	case GL_ATTACHED_SHADERS:
+		*params = static_cast<GLint>(object->shaders.size());
+		break;
+	default:
+		GLPUSHERROR(GL_INVALID_ENUM);
+		break;
+	}
+}
+
+void glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+	GLVK_SYNC();
+	glprogram_t* object = glstate.programs.get(program);
+	if (object == nullptr) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	copyInfoLog(object->info_log, bufSize, length, infoLog);
+}
+
+static bool* capability(GLenum cap) {
+	if (cap == GL_BLEND) {
+		return &glstate.raster.blend;
+	} else if (cap == GL_CULL_FACE) {
+		return &glstate.raster.cull_face;
+	} else if (cap == GL_DEPTH_TEST) {
+		return &glstate.raster.depth_test;
+	} else if (cap == GL_PRIMITIVE_RESTART_FIXED_INDEX) {
+		return &glstate.raster.primitive_restart;
+	} else if (cap == GL_RASTERIZER_DISCARD) {
+		return &glstate.raster.rasterizer_discard;
+	} else if (cap == GL_SCISSOR_TEST) {
+		return &glstate.scissor_test;
+	}
+
+	return nullptr;
+}
+
+void glEnable(GLenum cap) {
+	GLVK_DEFER(glEnable, cap);
+	bool* enabled = capability(cap);
+	if (enabled == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	markState(!*enabled, (cap == GL_SCISSOR_TEST) ? DIRTY_VIEWPORT : DIRTY_PIPELINE);
+	*enabled = true;
+}
+
+void glDisable(GLenum cap) {
+	GLVK_DEFER(glDisable, cap);
+	bool* enabled = capability(cap);
+	if (enabled == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	markState(*enabled, (cap == GL_SCISSOR_TEST) ? DIRTY_VIEWPORT : DIRTY_PIPELINE);
+	*enabled = false;
+}
+
+GLboolean glIsEnabled(GLenum cap) {
+	GLVK_SYNC();
+	bool* enabled = capability(cap);
+	if (enabled == nullptr) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return GL_FALSE;
+	}
+
+	return *enabled ? GL_TRUE : GL_FALSE;
+}
+
+void glBlendFunc(GLenum sfactor, GLenum dfactor) {
+	GLVK_DEFER(glBlendFunc, sfactor, dfactor);
+	glBlendFuncSeparate(sfactor, dfactor, sfactor, dfactor);
+}
+
+void glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+	GLVK_DEFER(glBlendFuncSeparate, srcRGB, dstRGB, srcAlpha, dstAlpha);
+	if (
+		blendFactor(srcRGB) == VK_BLEND_FACTOR_MAX_ENUM ||
+		blendFactor(dstRGB) == VK_BLEND_FACTOR_MAX_ENUM ||
+		blendFactor(srcAlpha) == VK_BLEND_FACTOR_MAX_ENUM ||
+		blendFactor(dstAlpha) == VK_BLEND_FACTOR_MAX_ENUM
+	) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	const GLVKglraster& raster = glstate.raster;
+	markState(raster.blend_src_rgb != srcRGB || raster.blend_dst_rgb != dstRGB || raster.blend_src_alpha != srcAlpha || raster.blend_dst_alpha != dstAlpha, DIRTY_PIPELINE);
+	glstate.raster.blend_src_rgb = srcRGB;
+	glstate.raster.blend_dst_rgb = dstRGB;
+	glstate.raster.blend_src_alpha = srcAlpha;
+	glstate.raster.blend_dst_alpha = dstAlpha;
+}
+
+void glBlendEquation(GLenum mode) {
+	GLVK_DEFER(glBlendEquation, mode);
+	glBlendEquationSeparate(mode, mode);
+}
+
+void glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+	GLVK_DEFER(glBlendEquationSeparate, modeRGB, modeAlpha);
+	if (blendOp(modeRGB) == VK_BLEND_OP_MAX_ENUM || blendOp(modeAlpha) == VK_BLEND_OP_MAX_ENUM) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	markState(glstate.raster.blend_equation_rgb != modeRGB || glstate.raster.blend_equation_alpha != modeAlpha, DIRTY_PIPELINE);
+	glstate.raster.blend_equation_rgb = modeRGB;
+	glstate.raster.blend_equation_alpha = modeAlpha;
+}
+
+void glBlendColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	GLVK_DEFER(glBlendColor, red, green, blue, alpha);
+	GLfloat color[4] = {
+		std::clamp(red, 0.0f, 1.0f),
+		std::clamp(green, 0.0f, 1.0f),
+		std::clamp(blue, 0.0f, 1.0f),
+		std::clamp(alpha, 0.0f, 1.0f),
+	};
+
+	/* dynamic state, so the next draw sets it instead of selecting another pipeline */
+	markState(memcmp(glstate.blend_color, color, sizeof(color)) != 0, DIRTY_BLEND_CONSTANTS);
+	memcpy(glstate.blend_color, color, sizeof(color));
+}
+
+void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+	GLVK_DEFER(glColorMask, red, green, blue, alpha);
+	const GLboolean* mask = glstate.raster.color_mask;
+	markState(mask[0] != red || mask[1] != green || mask[2] != blue || mask[3] != alpha, DIRTY_PIPELINE);
+	glstate.raster.color_mask[0] = red;
+	glstate.raster.color_mask[1] = green;
+	glstate.raster.color_mask[2] = blue;
+	glstate.raster.color_mask[3] = alpha;
+}
+
+void glCullFace(GLenum mode) {
+	GLVK_DEFER(glCullFace, mode);
+	if (mode != GL_FRONT && mode != GL_BACK && mode != GL_FRONT_AND_BACK) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	markState(glstate.raster.cull_mode != mode, DIRTY_PIPELINE);
+	glstate.raster.cull_mode = mode;
+}
+
+void glFrontFace(GLenum mode) {
+	GLVK_DEFER(glFrontFace, mode);
+	if (mode != GL_CW && mode != GL_CCW) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	markState(glstate.raster.front_face != mode, DIRTY_PIPELINE);
+	glstate.raster.front_face = mode;
+}
+
+void glPolygonMode(GLenum face, GLenum mode) {
+	GLVK_DEFER(glPolygonMode, face, mode);
+	if (face != GL_FRONT_AND_BACK || (mode != GL_POINT && mode != GL_LINE && mode != GL_FILL)) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (mode != GL_FILL && !vkstate.features.fillModeNonSolid) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Device does not support fillModeNonSolid, polygons are filled");
+	}
+
+	markState(glstate.raster.polygon_mode != mode, DIRTY_PIPELINE);
+	glstate.raster.polygon_mode = mode;
+}
+
+void glDepthFunc(GLenum func) {
+	GLVK_DEFER(glDepthFunc, func);
+	if (func < GL_NEVER || func > GL_ALWAYS) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	markState(glstate.raster.depth_func != func, DIRTY_PIPELINE);
+	glstate.raster.depth_func = func;
+}
+
+void glDepthMask(GLboolean flag) {
+	GLVK_DEFER(glDepthMask, flag);
+	markState(glstate.raster.depth_write != (flag != GL_FALSE), DIRTY_PIPELINE);
+	glstate.raster.depth_write = (flag != GL_FALSE);
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	GLVK_DEFER(glViewport, x, y, width, height);
+	if (width < 0 || height < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	GLint* viewport = glstate.viewport;
+	markState(!glstate.viewport_set || viewport[0] != x || viewport[1] != y || viewport[2] != width || viewport[3] != height, DIRTY_VIEWPORT);
+	glstate.viewport_set = true;
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+}
+
+void glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+	GLVK_DEFER(glScissor, x, y, width, height);
+	if (width < 0 || height < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* the box only matters while the scissor test is enabled */
+	GLint* box = glstate.scissor_box;
+	markState(!glstate.scissor_set || box[0] != x || box[1] != y || box[2] != width || box[3] != height, glstate.scissor_test ? DIRTY_VIEWPORT : 0);
+	glstate.scissor_set = true;
+	box[0] = x;
+	box[1] = y;
+	box[2] = width;
+	box[3] = height;
+}
+
+static bool validDrawMode(GLenum mode) {
+	return
+		mode == GL_POINTS ||
+		mode == GL_LINES ||
+		mode == GL_LINE_LOOP ||
+		mode == GL_LINE_STRIP ||
+		mode == GL_TRIANGLES ||
+		mode == GL_TRIANGLE_STRIP ||
+		mode == GL_TRIANGLE_FAN ||
+		mode == GL_LINES_ADJACENCY ||
+		mode == GL_LINE_STRIP_ADJACENCY ||
+		mode == GL_TRIANGLES_ADJACENCY ||
+		mode == GL_TRIANGLE_STRIP_ADJACENCY ||
+		mode == GL_PATCHES;
+}
+
+/* the range an indexed binding points at right now, null when nothing usable is bound */
+static glbuffer_t* bindingRange(descriptortype_t type, const glindexedbinding_t& binding, descriptorkey_t& key) {
+	glbuffer_t* glbuffer = glstate.buffers.get(binding.buffer);
+	if (glbuffer == nullptr || glbuffer->store.buffer == VK_NULL_HANDLE || static_cast<VkDeviceSize>(binding.offset) >= glbuffer->size) {
+		return nullptr;
+	}
+
+	const VkPhysicalDeviceLimits& limits = vkstate.physical.properties.limits;
+	VkDeviceSize available = glbuffer->size - binding.offset;
+	VkDeviceSize range = (binding.size == 0) ? available : std::min(static_cast<VkDeviceSize>(binding.size), available);
+	range = std::min(range, static_cast<VkDeviceSize>((type == DESCRIPTOR_UNIFORM_BUFFER) ? limits.maxUniformBufferRange : limits.maxStorageBufferRange));
+
+	key = {
+		.handle = reinterpret_cast<uint64_t>(glbuffer->store.buffer),
+		.offset = static_cast<uint64_t>(binding.offset),
+		.range = range,
+	};
+	return glbuffer;
+}
+
+/* points a push constant index at the descriptor of an indexed binding. the buffer's store may have been renamed since it was bound,
+ * so this runs per draw, but only looks a descriptor up when the binding's last one points elsewhere */
+static void resolveBufferBinding(descriptortype_t type, glindexedbinding_t& binding, uint32_t& index, uint64_t frame_number) {
+	descriptorkey_t key;
+	glbuffer_t* glbuffer = bindingRange(type, binding, key);
+	uint32_t slot = GLVK_NO_DESCRIPTOR;
+	if (glbuffer != nullptr) {
+		descriptorarray_t& array = vkstate.bindless.arrays[type];
+		if (binding.slot < array.slots.size() && array.slots[binding.slot].used && descriptorkeyequal_t()(array.slots[binding.slot].key, key)) {
+			slot = binding.slot;
+		} else {
+			slot = acquireDescriptor(type, key);
+			binding.slot = slot;
+		}
+
+		if (slot != GLVK_NO_DESCRIPTOR) {
+			array.slots[slot].last_use = frame_number;
+			glbuffer->store.last_use = frame_number;
+			glbuffer->store.last_draw = frame_number;
+		}
+	}
+
+	if (index != slot) {
+		index = slot;
+		glstate.dirty |= DIRTY_DESCRIPTORS;
+	}
+}
+
+/* without descriptor indexing the binding's range goes straight into the contents of the next descriptor set */
+static void resolveFallbackBinding(descriptortype_t type, const glindexedbinding_t& binding, descriptorkey_t& current, uint64_t frame_number) {
+	descriptorkey_t key = {};
+	glbuffer_t* glbuffer = bindingRange(type, binding, key);
+	if (glbuffer != nullptr) {
+		glbuffer->store.last_use = frame_number;
+		glbuffer->store.last_draw = frame_number;
+	}
+
+	if (!descriptorkeyequal_t()(current, key)) {
+		current = key;
+		glstate.dirty |= DIRTY_DESCRIPTORS;
+	}
+}
+
+/* the descriptor of a unit's texture, nullptr when it has no image to sample or no sampler to sample it with */
+static gltexture_t* textureKey(const gltextureunit_t& unit, descriptorkey_t& key) {
+	gltexture_t* texture = glstate.textures.get(unit.texture);
+	if (texture == nullptr || texture->store.image == VK_NULL_HANDLE) {
+		return nullptr;
+	}
+
+	VkSampler sampler = unitSampler(unit, *texture);
+	if (sampler == VK_NULL_HANDLE) {
+		return nullptr;
+	}
+
+	key = {
+		.handle = reinterpret_cast<uint64_t>(texture->store.view),
+		.offset = reinterpret_cast<uint64_t>(sampler),
+		.range = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+	return texture;
+}
+
+/* points a push constant index at the descriptor of a unit's texture, whose image may have been renamed since it was bound */
+static void resolveTextureBinding(gltextureunit_t& unit, uint32_t& index, uint64_t frame_number) {
+	descriptorkey_t key;
+	gltexture_t* texture = textureKey(unit, key);
+	uint32_t slot = GLVK_NO_DESCRIPTOR;
+	if (texture != nullptr) {
+		descriptorarray_t& array = vkstate.bindless.arrays[DESCRIPTOR_TEXTURE];
+		if (unit.slot < array.slots.size() && array.slots[unit.slot].used && descriptorkeyequal_t()(array.slots[unit.slot].key, key)) {
+			slot = unit.slot;
+		} else {
+			slot = acquireDescriptor(DESCRIPTOR_TEXTURE, key);
+			unit.slot = slot;
+		}
+
+		if (slot != GLVK_NO_DESCRIPTOR) {
+			array.slots[slot].last_use = frame_number;
+			texture->store.last_use = frame_number;
+			texture->store.last_draw = frame_number;
+		}
+	}
+
+	if (index != slot) {
+		index = slot;
+		glstate.dirty |= DIRTY_DESCRIPTORS;
+	}
+}
+
+static void resolveFallbackTexture(const gltextureunit_t& unit, descriptorkey_t& current, uint64_t frame_number) {
+	descriptorkey_t key = {};
+	gltexture_t* texture = textureKey(unit, key);
+	if (texture != nullptr) {
+		texture->store.last_use = frame_number;
+		texture->store.last_draw = frame_number;
+	}
+
+	if (!descriptorkeyequal_t()(current, key)) {
+		current = key;
+		glstate.dirty |= DIRTY_DESCRIPTORS;
+	}
+}
+
+/* returns a set of the slot with the given contents, allocated linearly from the slot's pools, which are reset together when it retires.
+ * draws of a frame with the same bindings share one set */
+static VkDescriptorSet frameDescriptorSet(GLVKvkframe& frame, const descriptorsetkey_t& key) {
+	auto it = frame.descriptor_cache.find(key);
+	if (it != frame.descriptor_cache.end()) {
+		return it->second;
+	}
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	for (;;) {
+		bool created = frame.descriptor_pool_index == frame.descriptor_pools.size();
+		if (created) {
+			VkDescriptorPoolSize pool_sizes[DESCRIPTOR_TYPE_COUNT] = {
+				{ .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = GLVK_DESCRIPTOR_POOL_SETS * GLVK_MAX_UNIFORM_BUFFER_BINDINGS },
+				{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = GLVK_DESCRIPTOR_POOL_SETS * GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS },
+				{ .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = GLVK_DESCRIPTOR_POOL_SETS * GLVK_MAX_TEXTURE_UNITS },
+			};
+
+			VkDescriptorPoolCreateInfo pool_create_info = {
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+				.pNext = nullptr,
+				.flags = 0,
+				.maxSets = GLVK_DESCRIPTOR_POOL_SETS,
+				.poolSizeCount = DESCRIPTOR_TYPE_COUNT,
+				.pPoolSizes = pool_sizes,
+			};
+
+			VkDescriptorPool pool;
+			if (vkCreateDescriptorPool(vkstate.device, &pool_create_info, vkstate.allocator, &pool) != VK_SUCCESS) {
+				GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create descriptor pool");
+				return VK_NULL_HANDLE;
+			}
+			frame.descriptor_pools.push_back(pool);
+		}
+
+		VkDescriptorSetAllocateInfo set_allocate_info = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.pNext = nullptr,
+			.descriptorPool = frame.descriptor_pools[frame.descriptor_pool_index],
+			.descriptorSetCount = 1,
+			.pSetLayouts = &vkstate.desc_layout,
+		};
+
+		VkResult res = vkAllocateDescriptorSets(vkstate.device, &set_allocate_info, &set);
+		if (res == VK_SUCCESS) {
+			break;
+		}
+
+		if (created || (res != VK_ERROR_OUT_OF_POOL_MEMORY && res != VK_ERROR_FRAGMENTED_POOL)) {
+			GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to allocate descriptor set");
+			return VK_NULL_HANDLE;
+		}
+
+		/* the pool is full, it stays full until the slot retires */
+		++frame.descriptor_pool_index;
+	}
+
+	VkDescriptorBufferInfo buffer_infos[GLVK_MAX_UNIFORM_BUFFER_BINDINGS + GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS];
+	VkDescriptorImageInfo image_infos[GLVK_MAX_TEXTURE_UNITS];
+	VkWriteDescriptorSet writes[GLVK_MAX_UNIFORM_BUFFER_BINDINGS + GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS + GLVK_MAX_TEXTURE_UNITS];
+	uint32_t buffer_count = 0;
+	uint32_t image_count = 0;
+	uint32_t write_count = 0;
+
+	const descriptorkey_t* keys = &key.uniform_buffers[0];
+	for (uint32_t binding = 0; binding < GLVK_FALLBACK_BINDING_COUNT; ++binding) {
+		if (keys[binding].handle == 0) {
+			continue;
+		}
+
+		bool texture = binding >= GLVK_FALLBACK_TEXTURE_BINDING;
+		if (texture) {
+			image_infos[image_count] = {
+				.sampler = reinterpret_cast<VkSampler>(keys[binding].offset),
+				.imageView = reinterpret_cast<VkImageView>(keys[binding].handle),
+				.imageLayout = static_cast<VkImageLayout>(keys[binding].range),
+			};
+		} else {
+			buffer_infos[buffer_count] = {
+				.buffer = reinterpret_cast<VkBuffer>(keys[binding].handle),
+				.offset = keys[binding].offset,
+				.range = keys[binding].range,
+			};
+		}
+
+		writes[write_count++] = {
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext = nullptr,
+			.dstSet = set,
+			.dstBinding = binding,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = texture ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : (binding >= GLVK_FALLBACK_STORAGE_BINDING) ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.pImageInfo = texture ? &image_infos[image_count++] : nullptr,
+			.pBufferInfo = texture ? nullptr : &buffer_infos[buffer_count++],
+			.pTexelBufferView = nullptr,
+		};
+	}
+
+	if (write_count != 0) {
+		vkUpdateDescriptorSets(vkstate.device, write_count, writes, 0, nullptr);
+	}
+
+	frame.descriptor_cache.emplace(key, set);
+	return set;
+}
+
+static void submitBindingsPacket(GLVKvkframe& frame, packettype_t type, uint32_t index) {
+	submitPacket(frame, {
+		.type = type,
+		.count = 0,
+		.instance_count = 0,
+		.first = index,
+		.pipeline = VK_NULL_HANDLE,
+		.vertex_buffer = VK_NULL_HANDLE,
+		.index_buffer = VK_NULL_HANDLE,
+		.index_type = VK_INDEX_TYPE_UINT16,
+		.blend_color = {},
+	});
+}
+
+/* resolves the indexed bindings and, when they changed since the last draw, pushes their bindless indices or binds a set holding them */
+static void resolveBindings(GLVKvkframe& frame) {
+	GLVKglindexedbuffers& indexed = glstate.indexed_buffers;
+	if (!vkstate.bindless.supported) {
+		for (uint32_t mask = indexed.uniform_mask; mask != 0; mask &= mask - 1) {
+			uint32_t i = static_cast<uint32_t>(std::countr_zero(mask));
+			resolveFallbackBinding(DESCRIPTOR_UNIFORM_BUFFER, indexed.uniform[i], glstate.binding_set.uniform_buffers[i], frame.number);
+		}
+
+		for (uint32_t mask = indexed.storage_mask; mask != 0; mask &= mask - 1) {
+			uint32_t i = static_cast<uint32_t>(std::countr_zero(mask));
+			resolveFallbackBinding(DESCRIPTOR_STORAGE_BUFFER, indexed.storage[i], glstate.binding_set.storage_buffers[i], frame.number);
+		}
+
+		for (uint32_t mask = glstate.texture_mask; mask != 0; mask &= mask - 1) {
+			uint32_t i = static_cast<uint32_t>(std::countr_zero(mask));
+			resolveFallbackTexture(glstate.texture_units[i], glstate.binding_set.textures[i], frame.number);
+		}
+
+		if (!(glstate.dirty & DIRTY_DESCRIPTORS)) {
+			return;
+		}
+
+		VkDescriptorSet set = frameDescriptorSet(frame, glstate.binding_set);
+		if (set == VK_NULL_HANDLE) {
+			return;
+		}
+
+		frame.descriptor_sets.push_back(set);
+		submitBindingsPacket(frame, PACKET_BIND_DESCRIPTOR_SET, static_cast<uint32_t>(frame.descriptor_sets.size() - 1));
+		glstate.dirty &= ~DIRTY_DESCRIPTORS;
+		return;
+	}
+
+	for (uint32_t mask = indexed.uniform_mask; mask != 0; mask &= mask - 1) {
+		uint32_t i = static_cast<uint32_t>(std::countr_zero(mask));
+		resolveBufferBinding(DESCRIPTOR_UNIFORM_BUFFER, indexed.uniform[i], glstate.bindings.uniform_buffers[i], frame.number);
+	}
+
+	for (uint32_t mask = indexed.storage_mask; mask != 0; mask &= mask - 1) {
+		uint32_t i = static_cast<uint32_t>(std::countr_zero(mask));
+		resolveBufferBinding(DESCRIPTOR_STORAGE_BUFFER, indexed.storage[i], glstate.bindings.storage_buffers[i], frame.number);
+	}
+
+	for (uint32_t mask = glstate.texture_mask; mask != 0; mask &= mask - 1) {
+		uint32_t i = static_cast<uint32_t>(std::countr_zero(mask));
+		resolveTextureBinding(glstate.texture_units[i], glstate.bindings.textures[i], frame.number);
+	}
+
+	if (!(glstate.dirty & DIRTY_DESCRIPTORS)) {
+		return;
+	}
+
+	frame.push_constants.push_back(glstate.bindings);
+	submitBindingsPacket(frame, PACKET_PUSH_CONSTANTS, static_cast<uint32_t>(frame.push_constants.size() - 1));
+	glstate.dirty &= ~DIRTY_DESCRIPTORS;
+}
+
+/* creates the next chunk of the frame slot's uniform ring, host visible so blocks are written in place */
+static bool createUniformChunk(GLVKvkframe& frame) {
+	if (frame.uniform_chunks.size() >= GLVK_MAX_UNIFORM_CHUNKS) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Uniform ring is full, default uniform block not updated");
+		return false;
+	}
+
+	uniformchunk_t chunk;
+	if (createBuffer(GLVK_UNIFORM_CHUNK_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, chunk.buffer, chunk.memory) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create uniform buffer");
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo set_allocate_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.descriptorPool = vkstate.uniform_pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &vkstate.uniform_layout,
+	};
+
+	if (vkAllocateDescriptorSets(vkstate.device, &set_allocate_info, &chunk.set) != VK_SUCCESS) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to allocate descriptor set");
+		vkDestroyBuffer(vkstate.device, chunk.buffer, vkstate.allocator);
+		freeMemory(chunk.memory);
+		return false;
+	}
+
+	VkDescriptorBufferInfo buffer_info = {
+		.buffer = chunk.buffer,
+		.offset = 0,
+		.range = GLVK_UNIFORM_BLOCK_SIZE,
+	};
+
+	VkWriteDescriptorSet write = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.pNext = nullptr,
+		.dstSet = chunk.set,
+		.dstBinding = 0,
+		.dstArrayElement = 0,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.pImageInfo = nullptr,
+		.pBufferInfo = &buffer_info,
+		.pTexelBufferView = nullptr,
+	};
+	vkUpdateDescriptorSets(vkstate.device, 1, &write, 0, nullptr);
+
+	frame.uniform_chunks.push_back(chunk);
+	return true;
+}
+
+/* copies size bytes into the frame slot's uniform ring. the set binds GLVK_UNIFORM_BLOCK_SIZE bytes from the dynamic offset,
+ * so that much has to stay inside the chunk */
+static bool copyUniforms(GLVKvkframe& frame, const void* data, uint32_t size, uint32_t& chunk, uint32_t& offset) {
+	uint32_t alignment = std::max(static_cast<uint32_t>(vkstate.physical.properties.limits.minUniformBufferOffsetAlignment), 16u);
+	uint32_t aligned = (frame.uniform_offset + alignment - 1) & ~(alignment - 1);
+	if (aligned + GLVK_UNIFORM_BLOCK_SIZE > GLVK_UNIFORM_CHUNK_SIZE) {
+		++frame.uniform_chunk;
+		aligned = 0;
+	}
+
+	if (frame.uniform_chunk == frame.uniform_chunks.size() && !createUniformChunk(frame)) {
+		return false;
+	}
+
+	uniformchunk_t& target = frame.uniform_chunks[frame.uniform_chunk];
+	memcpy(static_cast<uint8_t*>(target.memory.mapped) + aligned, data, size);
+	frame.uniform_offset = aligned + size;
+	chunk = frame.uniform_chunk;
+	offset = aligned;
+	return true;
+}
+
+/* copies the default uniform block when it changed or was last copied in another frame, and binds the copy at its dynamic offset.
+ * draws that leave the block alone reuse the bound copy without touching the ring */
+static void resolveUniforms(GLVKvkframe& frame) {
+	gluniformblock_t& block = glstate.uniforms;
+	if (block.dirty || block.upload_frame != frame.number) {
+		/* at least one slot so the set always points at something a shader may read */
+		if (!copyUniforms(frame, block.data, std::max(block.size, 16u), block.chunk, block.offset)) {
+			return;
+		}
+		block.dirty = false;
+		block.upload_frame = frame.number;
+		block.bound = false;
+	}
+
+	if (block.bound) {
+		return;
+	}
+
+	submitPacket(frame, {
+		.type = PACKET_BIND_UNIFORMS,
+		.count = block.chunk,
+		.instance_count = 0,
+		.first = block.offset,
+		.pipeline = VK_NULL_HANDLE,
+		.vertex_buffer = VK_NULL_HANDLE,
+		.index_buffer = VK_NULL_HANDLE,
+		.index_type = VK_INDEX_TYPE_UINT16,
+		.blend_color = {},
+	});
+	block.bound = true;
+}
+
+static VkFormat componentFormat(GLint size, VkFormat r, VkFormat rg, VkFormat rgb, VkFormat rgba) {
+	VkFormat formats[4] = { r, rg, rgb, rgba };
+	return formats[size - 1];
+}
+
+/* vulkan format fetching size components of type the way gl converts them, integer attributes are not converted to float.
+ * VK_FORMAT_UNDEFINED when vulkan has no such format */
+static VkFormat vertexFormat(GLint size, GLenum type, bool normalized, bool integer) {
+	switch (type) {
+	case GL_BYTE:
+		if (integer) {
+			return componentFormat(size, VK_FORMAT_R8_SINT, VK_FORMAT_R8G8_SINT, VK_FORMAT_R8G8B8_SINT, VK_FORMAT_R8G8B8A8_SINT);
+		}
+		return normalized ?
+			componentFormat(size, VK_FORMAT_R8_SNORM, VK_FORMAT_R8G8_SNORM, VK_FORMAT_R8G8B8_SNORM, VK_FORMAT_R8G8B8A8_SNORM) :
+			componentFormat(size, VK_FORMAT_R8_SSCALED, VK_FORMAT_R8G8_SSCALED, VK_FORMAT_R8G8B8_SSCALED, VK_FORMAT_R8G8B8A8_SSCALED);
+	case GL_UNSIGNED_BYTE:
+		if (integer) {
+			return componentFormat(size, VK_FORMAT_R8_UINT, VK_FORMAT_R8G8_UINT, VK_FORMAT_R8G8B8_UINT, VK_FORMAT_R8G8B8A8_UINT);
+		}
+		return normalized ?
+			componentFormat(size, VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_R8G8B8A8_UNORM) :
+			componentFormat(size, VK_FORMAT_R8_USCALED, VK_FORMAT_R8G8_USCALED, VK_FORMAT_R8G8B8_USCALED, VK_FORMAT_R8G8B8A8_USCALED);
+	case GL_SHORT:
+		if (integer) {
+			return componentFormat(size, VK_FORMAT_R16_SINT, VK_FORMAT_R16G16_SINT, VK_FORMAT_R16G16B16_SINT, VK_FORMAT_R16G16B16A16_SINT);
+		}
+		return normalized ?
+			componentFormat(size, VK_FORMAT_R16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16B16_SNORM, VK_FORMAT_R16G16B16A16_SNORM) :
+			componentFormat(size, VK_FORMAT_R16_SSCALED, VK_FORMAT_R16G16_SSCALED, VK_FORMAT_R16G16B16_SSCALED, VK_FORMAT_R16G16B16A16_SSCALED);
+	case GL_UNSIGNED_SHORT:
+		if (integer) {
+			return componentFormat(size, VK_FORMAT_R16_UINT, VK_FORMAT_R16G16_UINT, VK_FORMAT_R16G16B16_UINT, VK_FORMAT_R16G16B16A16_UINT);
+		}
+		return normalized ?
+			componentFormat(size, VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16A16_UNORM) :
+			componentFormat(size, VK_FORMAT_R16_USCALED, VK_FORMAT_R16G16_USCALED, VK_FORMAT_R16G16B16_USCALED, VK_FORMAT_R16G16B16A16_USCALED);
+	case GL_INT:
+		/* there are no 32 bit scaled or normalized formats */
+		return integer ? componentFormat(size, VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT) : VK_FORMAT_UNDEFINED;
+	case GL_UNSIGNED_INT:
+		return integer ? componentFormat(size, VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT) : VK_FORMAT_UNDEFINED;
+	case GL_HALF_FLOAT:
+		return componentFormat(size, VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT);
+	case GL_FLOAT:
+		return componentFormat(size, VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT);
+	/* gl packs x into the low bits like vulkan's A2B10G10R10 packs r */
+	case GL_INT_2_10_10_10_REV:
+		return normalized ? VK_FORMAT_A2B10G10R10_SNORM_PACK32 : VK_FORMAT_A2B10G10R10_SSCALED_PACK32;
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+		return normalized ? VK_FORMAT_A2B10G10R10_UNORM_PACK32 : VK_FORMAT_A2B10G10R10_USCALED_PACK32;
+	}
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+static uint32_t vertexTypeSize(GLenum type) {
+	if (type == GL_BYTE || type == GL_UNSIGNED_BYTE) {
+		return 1;
+	} else if (type == GL_SHORT || type == GL_UNSIGNED_SHORT || type == GL_HALF_FLOAT) {
+		return 2;
+	}
+
+	return 4;
+}
+
+static bool vertexFormatSupported(VkFormat format) {
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(vkstate.physical.device, format, &props);
+	return (props.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT) != 0;
+}
+
+/* returns the index of layout, adding it on first use. layouts live until shutdown, programs only ever use a handful.
+ * hash 0 stays reserved for the built-in vertex format */
+static uint32_t registerVertexLayout(const vertexlayout_t& layout, uint64_t& hash) {
+	hash = hashBytes(&layout, sizeof(layout));
+	if (hash == 0) {
+		hash = 1;
+	}
+
+	auto it = vkstate.vertex_layout_lookup.find(hash);
+	if (it != vkstate.vertex_layout_lookup.end()) {
+		return it->second;
+	}
+
+	uint32_t index = static_cast<uint32_t>(vkstate.vertex_layouts.size());
+	vkstate.vertex_layouts.push_back(layout);
+	vkstate.vertex_layout_lookup[hash] = index;
+	return index;
+}
+
+/* compiles the enabled attributes of vao into a registered vertex layout. attributes reading the same buffer with the same stride and
+ * rate share a binding at the offset of the first of them, so one bind covers an interleaved vertex. false when an attribute has no format */
+static bool compileVertexArray(glvertexarray_t& vao) {
+	vertexlayout_t layout;
+	memset(&layout, 0, sizeof(layout));
+	vao.binding_count = 0;
+
+	VkDeviceSize max_offset = vkstate.physical.properties.limits.maxVertexInputAttributeOffset;
+	for (uint32_t i = 0; i < GLVK_MAX_VERTEX_ATTRIBS; ++i) {
+		const glvertexattrib_t& attrib = vao.attribs[i];
+		if (!attrib.enabled) {
+			continue;
+		}
+
+		bool packed = attrib.type == GL_INT_2_10_10_10_REV || attrib.type == GL_UNSIGNED_INT_2_10_10_10_REV;
+		uint32_t component_size = vertexTypeSize(attrib.type);
+		uint32_t stride = attrib.stride != 0 ? static_cast<uint32_t>(attrib.stride) : (packed ? 4 : attrib.size * component_size);
+
+		/* instanced attributes advance once per instance, vulkan has no other divisor without an extension */
+		if (attrib.divisor > 1) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Vertex attribute divisor {} is not supported, attribute {} advances every instance", attrib.divisor, i);
+		}
+		VkVertexInputRate rate = attrib.divisor > 0 ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
+
+		uint32_t binding = vao.binding_count;
+		for (uint32_t j = 0; j < vao.binding_count; ++j) {
+			if (vao.binding_buffers[j] == attrib.buffer && layout.bindings[j].stride == stride && layout.bindings[j].inputRate == rate &&
+				attrib.offset >= vao.binding_offsets[j] && static_cast<VkDeviceSize>(attrib.offset - vao.binding_offsets[j]) <= max_offset) {
+				binding = j;
+				break;
+			}
+		}
+
+		if (binding == vao.binding_count) {
+			layout.bindings[binding] = {
+				.binding = binding,
+				.stride = stride,
+				.inputRate = rate,
+			};
+			vao.binding_buffers[binding] = attrib.buffer;
+			vao.binding_offsets[binding] = attrib.offset;
+			++vao.binding_count;
+		}
+
+		uint32_t offset = static_cast<uint32_t>(attrib.offset - vao.binding_offsets[binding]);
+		VkFormat format = vertexFormat(attrib.size, attrib.type, attrib.normalized, attrib.integer);
+
+		/* three component formats are optional, the fourth component is fetched too when it stays inside the vertex and ignored by the shader */
+		if (format != VK_FORMAT_UNDEFINED && !vertexFormatSupported(format)) {
+			format = VK_FORMAT_UNDEFINED;
+			if (attrib.size == 3 && offset + 4 * component_size <= stride) {
+				format = vertexFormat(4, attrib.type, attrib.normalized, attrib.integer);
+			}
+		}
+
+		if (format == VK_FORMAT_UNDEFINED) {
+			GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Vertex attribute {} with size {} and type {} is not supported", i, attrib.size, attrib.type);
+			return false;
+		}
+
+		layout.attributes[layout.attribute_count++] = {
+			.location = i,
+			.binding = binding,
+			.format = format,
+			.offset = offset,
+		};
+	}
+
+	layout.binding_count = vao.binding_count;
+	vao.layout = registerVertexLayout(layout, vao.layout_hash);
+	return true;
+}
+
+/* resolves the buffers behind vao's bindings and binds them unless the last draw bound the same, false when one has no storage to read */
+static bool resolveVertexBuffers(GLVKvkframe& frame, const glvertexarray_t& vao) {
+	vertexbuffers_t buffers;
+	memset(&buffers, 0, sizeof(buffers));
+	buffers.count = vao.binding_count;
+
+	for (uint32_t i = 0; i < vao.binding_count; ++i) {
+		glbuffer_t* glbuffer = glstate.buffers.get(vao.binding_buffers[i]);
+		if (glbuffer == nullptr || glbuffer->store.buffer == VK_NULL_HANDLE || static_cast<VkDeviceSize>(vao.binding_offsets[i]) >= glbuffer->size) {
+			return false;
+		}
+
+		buffers.buffers[i] = glbuffer->store.buffer;
+		buffers.offsets[i] = vao.binding_offsets[i];
+		glbuffer->store.last_use = frame.number;
+		glbuffer->store.last_draw = frame.number;
+	}
+
+	if (!(glstate.dirty & DIRTY_VERTEX_BUFFERS) && memcmp(&buffers, &glstate.vertex_buffers, sizeof(buffers)) == 0) {
+		++vkstate.state_stats.redundant_state;
+		return true;
+	}
+
+	glstate.vertex_buffers = buffers;
+	glstate.dirty &= ~DIRTY_VERTEX_BUFFERS;
+	if (buffers.count != 0) {
+		frame.vertex_buffers.push_back(buffers);
+		submitBindingsPacket(frame, PACKET_VERTEX_BUFFERS, static_cast<uint32_t>(frame.vertex_buffers.size() - 1));
+	}
+	return true;
+}
+
+/* records the viewport and blend constants when they changed since the last draw */
+static void resolveDynamicState(GLVKvkframe& frame) {
+	if (glstate.dirty & DIRTY_VIEWPORT) {
+		frame.viewports.push_back(currentViewport());
+		submitBindingsPacket(frame, PACKET_VIEWPORT, static_cast<uint32_t>(frame.viewports.size() - 1));
+	}
+
+	if (glstate.dirty & DIRTY_BLEND_CONSTANTS) {
+		drawpacket_t packet = {
+			.type = PACKET_BLEND_CONSTANTS,
+			.count = 0,
+			.instance_count = 0,
+			.first = 0,
+			.pipeline = VK_NULL_HANDLE,
+			.vertex_buffer = VK_NULL_HANDLE,
+			.index_buffer = VK_NULL_HANDLE,
+			.index_type = VK_INDEX_TYPE_UINT16,
+			.blend_color = {},
+		};
+		memcpy(packet.blend_color, glstate.blend_color, sizeof(packet.blend_color));
+		submitPacket(frame, packet);
+	}
+
+	glstate.dirty &= ~(DIRTY_VIEWPORT | DIRTY_BLEND_CONSTANTS);
+}
+
+/* opens the frame if needed and resolves the pipeline and vertex buffer of a draw into packet, returns false when nothing can be recorded */
+static bool beginDraw(GLenum mode, drawpacket_t& packet) {
+	VkPrimitiveTopology topology;
+	if (!drawTopology(mode, topology)) {
+		return false;
+	}
+
+	/* without a vertex array the array buffer is read with the built-in vertex format */
+	glvertexarray_t* vao = glstate.vertex_arrays.get(glstate.bound_vao);
+	glbuffer_t* array = nullptr;
+	if (vao != nullptr) {
+		for (const glvertexattrib_t& attrib : vao->attribs) {
+			glbuffer_t* glbuffer = attrib.enabled ? glstate.buffers.get(attrib.buffer) : nullptr;
+			if (glbuffer != nullptr && glbuffer->map_access != 0) {
+				GLPUSHERROR(GL_INVALID_OPERATION);
+				return false;
+			}
+		}
+
+		if (vao->dirty) {
+			if (!compileVertexArray(*vao)) {
+				GLPUSHERROR(GL_INVALID_OPERATION);
+				return false;
+			}
+			vao->dirty = false;
+		}
+	} else {
+		array = glstate.buffers.get(glstate.bound_buffers.array);
+		if (array != nullptr && array->map_access != 0) {
+			GLPUSHERROR(GL_INVALID_OPERATION);
+			return false;
+		}
+	}
+
+	if (!beginFrame()) {
+		return false;
+	}
+
+	/* without dynamic vertex input a different layout is a different pipeline */
+	uint32_t layout = (vao != nullptr) ? vao->layout : 0;
+	uint64_t layout_hash = (vao != nullptr) ? vao->layout_hash : 0;
+	if (!vkstate.vertex_input_dynamic && layout_hash != glstate.vertex_layout) {
+		glstate.vertex_layout = layout_hash;
+		glstate.dirty |= DIRTY_PIPELINE;
+	}
+
+	/* the key is only built and looked up again once something it is built from changed */
+	if (topology != glstate.topology) {
+		glstate.topology = topology;
+		glstate.dirty |= DIRTY_PIPELINE;
+	}
+	if (glstate.dirty & DIRTY_PIPELINE) {
+		glstate.pipeline = findPipeline(pipelineKey(topology));
+		glstate.dirty &= ~DIRTY_PIPELINE;
+	}
+
+	packet.pipeline = glstate.pipeline;
+	if (packet.pipeline == VK_NULL_HANDLE) {
+		return false;
+	}
+
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	resolveDynamicState(frame);
+	resolveBindings(frame);
+	resolveUniforms(frame);
+
+	if (vkstate.vertex_input_dynamic) {
+		if (layout != glstate.vertex_input || (glstate.dirty & DIRTY_VERTEX_INPUT)) {
+			submitBindingsPacket(frame, PACKET_VERTEX_INPUT, layout);
+			glstate.vertex_input = layout;
+		} else {
+			++vkstate.state_stats.redundant_state;
+		}
+	}
+	glstate.dirty &= ~DIRTY_VERTEX_INPUT;
+
+	packet.vertex_buffer = VK_NULL_HANDLE;
+	if (vao != nullptr) {
+		return resolveVertexBuffers(frame, *vao);
+	}
+
+	/* binding 0 is rebound here, so the next vertex array binds its buffers again */
+	glstate.dirty |= DIRTY_VERTEX_BUFFERS;
+	if (array != nullptr && array->store.buffer != VK_NULL_HANDLE) {
+		packet.vertex_buffer = array->store.buffer;
+		array->store.last_use = frame.number;
+		array->store.last_draw = frame.number;
+	}
+
+	return true;
+}
+
+/* fills a store with the indices of a line loop drawn as a strip: count indices followed by the first one again. without elements
+ * they count up from first, otherwise they are copied on the gpu from index_size byte indices at offset of the element store.
+ * the store is only read by the draw it was made for and retired with the frame right after */
+static bool lineLoopIndices(bufferstore_t* elements, VkDeviceSize offset, VkDeviceSize index_size, uint32_t first, uint32_t count, bufferstore_t& store) {
+	VkDeviceSize size = static_cast<VkDeviceSize>(count + 1) * ((elements != nullptr) ? index_size : sizeof(uint32_t));
+	if (acquireBufferStore(size, BUFFER_PLACEMENT_DEVICE, store) != VK_SUCCESS) {
+		return false;
+	}
+
+	if (elements == nullptr) {
+		std::vector<uint32_t> indices(count + 1);
+		for (uint32_t i = 0; i < count; ++i) {
+			indices[i] = first + i;
+		}
+		indices[count] = first;
+		uploadBuffer(store.buffer, 0, indices.data(), size);
+		store.last_use = vkstate.frame_number;
+		return true;
+	}
+
+	/* a readback recorded this frame lands after the frame's uploads, the copy below would miss it */
+	if (vkstate.frame_prepared && elements->last_write >= vkstate.frames[vkstate.frame_index].number) {
+		flushFrame();
+	}
+
+	VkBufferCopy regions[2] = {
+		{
+			.srcOffset = offset,
+			.dstOffset = 0,
+			.size = count * index_size,
+		},
+		{
+			.srcOffset = offset,
+			.dstOffset = count * index_size,
+			.size = index_size,
+		},
+	};
+
+	VkCommandBuffer cb = uploadCommandBuffer();
+	transferBarrier(cb);
+	vkCmdCopyBuffer(cb, elements->buffer, store.buffer, 2, regions);
+	store.last_use = vkstate.frame_number;
+	elements->last_use = vkstate.frame_number;
+	return true;
+}
+
+static void drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+	if (!state.inited) {
+		return;
+	}
+
+	if (!validDrawMode(mode)) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (first < 0 || count < 0 || instancecount < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* a loop of one vertex has no segments */
+	if (count == 0 || instancecount == 0 || (mode == GL_LINE_LOOP && count < 2)) {
+		return;
+	}
+
+	drawpacket_t packet = {
+		.type = PACKET_DRAW,
+		.count = static_cast<uint32_t>(count),
+		.instance_count = static_cast<uint32_t>(instancecount),
+		.first = static_cast<uint32_t>(first),
+		.pipeline = VK_NULL_HANDLE,
+		.vertex_buffer = VK_NULL_HANDLE,
+		.index_buffer = VK_NULL_HANDLE,
+		.index_type = VK_INDEX_TYPE_UINT16,
+		.blend_color = {},
+	};
+
+	bufferstore_t loop = {};
+	if (mode == GL_LINE_LOOP) {
+		if (!lineLoopIndices(nullptr, 0, 0, packet.first, packet.count, loop)) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return;
+		}
+
+		packet.type = PACKET_DRAW_INDEXED;
+		packet.count += 1;
+		packet.first = 0;
+		packet.index_buffer = loop.buffer;
+		packet.index_type = VK_INDEX_TYPE_UINT32;
+	}
+
+	if (beginDraw(mode, packet)) {
+		submitPacket(vkstate.frames[vkstate.frame_index], packet);
+		++vkstate.state_stats.draws;
+	}
+
+	if (loop.buffer != VK_NULL_HANDLE) {
+		loop.last_use = vkstate.frame_number;
+		retireBufferStore(loop);
+	}
+}
+
+static void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount) {
+	if (!state.inited) {
+		return;
+	}
+
+	if (!validDrawMode(mode)) {
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	VkIndexType index_type;
+	VkDeviceSize index_size;
+	if (type == GL_UNSIGNED_SHORT) {
+		index_type = VK_INDEX_TYPE_UINT16;
+		index_size = 2;
+	} else if (type == GL_UNSIGNED_INT) {
+		index_type = VK_INDEX_TYPE_UINT32;
+		index_size = 4;
+	} else {
+		if (type == GL_UNSIGNED_BYTE) {
+			GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "GL_UNSIGNED_BYTE indices are not supported");
+		}
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (count < 0 || instancecount < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* client side index arrays are not supported, indices is an offset into the element array buffer */
+	glbuffer_t* elements = glstate.buffers.get(glstate.bound_buffers.element_array);
+	VkDeviceSize offset = reinterpret_cast<uintptr_t>(indices);
+	if (elements == nullptr || elements->map_access != 0 || offset % index_size != 0) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	if (count == 0 || instancecount == 0 || elements->store.buffer == VK_NULL_HANDLE || (mode == GL_LINE_LOOP && count < 2)) {
+		return;
+	}
+
+	drawpacket_t packet = {
+		.type = PACKET_DRAW_INDEXED,
+		.count = static_cast<uint32_t>(count),
+		.instance_count = static_cast<uint32_t>(instancecount),
+		.first = static_cast<uint32_t>(offset / index_size),
+		.pipeline = VK_NULL_HANDLE,
+		.vertex_buffer = VK_NULL_HANDLE,
+		.index_buffer = elements->store.buffer,
+		.index_type = index_type,
+		.blend_color = {},
+	};
+
+	bufferstore_t loop = {};
+	if (mode == GL_LINE_LOOP) {
+		if (!lineLoopIndices(&elements->store, offset, index_size, 0, packet.count, loop)) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return;
+		}
+
+		packet.count += 1;
+		packet.first = 0;
+		packet.index_buffer = loop.buffer;
+	}
+
+	if (beginDraw(mode, packet)) {
+		GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+		elements->store.last_use = frame.number;
+		elements->store.last_draw = frame.number;
+
+		submitPacket(frame, packet);
+		++vkstate.state_stats.draws;
+	}
+
+	if (loop.buffer != VK_NULL_HANDLE) {
+		loop.last_use = vkstate.frame_number;
+		retireBufferStore(loop);
+	}
+}
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+	GLVK_DEFER(glDrawArrays, mode, first, count);
+	drawArrays(mode, first, count, 1);
+}
+
+void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+	GLVK_DEFER(glDrawArraysInstanced, mode, first, count, instancecount);
+	drawArrays(mode, first, count, instancecount);
+}
+
+void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+	GLVK_DEFER(glDrawElements, mode, count, type, indices);
+	drawElements(mode, count, type, indices, 1);
+}
+
+void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount) {
+	GLVK_DEFER(glDrawElementsInstanced, mode, count, type, indices, instancecount);
+	drawElements(mode, count, type, indices, instancecount);
+}
+
+/* vulkan format with the byte order gl asked for, keeping the color buffer's srgb encoding so a conversion leaves the values alone */
+static VkFormat packFormat(GLenum format) {
+	bool srgb = vkstate.surface_format.format == VK_FORMAT_B8G8R8A8_SRGB || vkstate.surface_format.format == VK_FORMAT_R8G8B8A8_SRGB;
+	if (format == GL_BGRA) {
+		return srgb ? VK_FORMAT_B8G8R8A8_SRGB : VK_FORMAT_B8G8R8A8_UNORM;
+	}
+
+	return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+/* records a copy of rect of the frame's color buffer into buffer, pausing the render pass around it.
+ * a color buffer in another byte order is blitted into the slot's readback image first */
+static VkResult recordReadPixels(GLVKvkframe& frame, VkRect2D rect, VkFormat format, VkBuffer buffer, VkDeviceSize buffer_offset, uint32_t row_length) {
+	bool convert = format != vkstate.surface_format.format;
+	if (convert) {
+		VkFormatProperties src_props;
+		VkFormatProperties dst_props;
+		vkGetPhysicalDeviceFormatProperties(vkstate.physical.device, vkstate.surface_format.format, &src_props);
+		vkGetPhysicalDeviceFormatProperties(vkstate.physical.device, format, &dst_props);
+		if (!(src_props.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) || !(dst_props.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT)) {
+			return VK_ERROR_FORMAT_NOT_SUPPORTED;
+		}
+
+		if (frame.readback.image != VK_NULL_HANDLE && frame.readback.format != format) {
+			/* commands recorded in this frame may still use the old image */
+			flushFrame();
+			destroyAttachment(frame.readback);
+		}
+
+		if (frame.readback.image == VK_NULL_HANDLE) {
+			VkResult res = createAttachment(frame.readback, format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT, vkstate.extent.width, vkstate.extent.height);
+			if (res != VK_SUCCESS) {
+				destroyAttachment(frame.readback);
+				return res;
+			}
+		}
+	}
+
+	recordPackets(frame);
+	VkCommandBuffer cb = frame.command_buffer;
+	vkCmdEndRenderPass(cb);
+
+	VkImageSubresourceLayers layers = {
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.mipLevel = 0,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	};
+
+	VkImageMemoryBarrier barriers[2] = {
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.pNext = nullptr,
+			.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+			.oldLayout = colorLayout(),
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = vkstate.swapchain_images[vkstate.image_index],
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		},
+		{
+			/* the previous contents are not needed, only earlier copies out of it have to finish */
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.pNext = nullptr,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = frame.readback.image,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		},
+	};
+
+	/* the copy writes buffer bytes earlier commands of this or previous frames may still be reading */
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, convert ? 2 : 1, barriers);
+
+	VkImage source = barriers[0].image;
+	VkOffset3D source_offset = { rect.offset.x, rect.offset.y, 0 };
+	if (convert) {
+		VkImageBlit blit = {
+			.srcSubresource = layers,
+			.srcOffsets = {
+				{ rect.offset.x, rect.offset.y, 0 },
+				{ rect.offset.x + static_cast<int32_t>(rect.extent.width), rect.offset.y + static_cast<int32_t>(rect.extent.height), 1 },
+			},
+			.dstSubresource = layers,
+			.dstOffsets = {
+				{ 0, 0, 0 },
+				{ static_cast<int32_t>(rect.extent.width), static_cast<int32_t>(rect.extent.height), 1 },
+			},
+		};
+
+		vkCmdBlitImage(cb, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame.readback.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_NEAREST);
+
+		barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barriers[1]);
+
+		source = frame.readback.image;
+		source_offset = { 0, 0, 0 };
+	}
+
+	VkBufferImageCopy region = {
+		.bufferOffset = buffer_offset,
+		.bufferRowLength = row_length,
+		.bufferImageHeight = 0,
+		.imageSubresource = layers,
+		.imageOffset = source_offset,
+		.imageExtent = { rect.extent.width, rect.extent.height, 1 },
+	};
+
+	vkCmdCopyImageToBuffer(cb, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+	barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].newLayout = colorLayout();
+
+	/* the result is read by later draws, by uploads of later frames and by the host once the frame fence signals */
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_HOST_READ_BIT,
+	};
+
+	vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 1, &barriers[0]);
+
+	beginRenderPass(frame, vkstate.render_pass_load);
+	return VK_SUCCESS;
+}
+
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* pixels) {
+	GLVK_SYNC();
+	if (!state.inited) {
+		return;
+	}
+
+	if (format != GL_RGBA && format != GL_BGRA) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glReadPixels format {} is not supported", format);
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	/* the packed 8_8_8_8_REV type has the same byte layout as unsigned bytes on little endian hosts */
+	if (type != GL_UNSIGNED_BYTE && type != GL_UNSIGNED_INT_8_8_8_8_REV) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glReadPixels type {} is not supported", type);
+		GLPUSHERROR(GL_INVALID_ENUM);
+		return;
+	}
+
+	if (width < 0 || height < 0) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
+	}
+
+	/* rows of 4 byte pixels start GL_PACK_ROW_LENGTH pixels apart, rounded up to GL_PACK_ALIGNMENT, after the skipped rows and pixels */
+	const GLVKglpixelstore& pixel_store = glstate.pack;
+	VkDeviceSize row_pixels = (pixel_store.row_length > 0) ? pixel_store.row_length : width;
+	VkDeviceSize stride = (row_pixels * 4 + pixel_store.alignment - 1) / pixel_store.alignment * pixel_store.alignment;
+	VkDeviceSize base = static_cast<VkDeviceSize>(pixel_store.skip_rows) * stride + static_cast<VkDeviceSize>(pixel_store.skip_pixels) * 4;
+	VkDeviceSize size = (width == 0 || height == 0) ? 0 : base + static_cast<VkDeviceSize>(height - 1) * stride + static_cast<VkDeviceSize>(width) * 4;
+
+	glbuffer_t* pack = nullptr;
+	VkDeviceSize pack_offset = reinterpret_cast<uintptr_t>(pixels);
+	if (glstate.bound_buffers.pixel_pack != 0) {
+		pack = glstate.buffers.get(glstate.bound_buffers.pixel_pack);
+		if (pack == nullptr || pack->map_access != 0 || pack_offset + size > pack->size) {
+			GLPUSHERROR(GL_INVALID_OPERATION);
+			return;
+		}
+	} else if (pixels == nullptr) {
+		return;
+	}
+
+	if (!vkstate.headless && !(vkstate.surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_WARNING, "The surface does not allow copying out of swapchain images");
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	/* pixels outside the color buffer are undefined in gl, only the part inside it is copied */
+	int64_t x0 = std::max<int64_t>(x, 0);
+	int64_t y0 = std::max<int64_t>(y, 0);
+	int64_t x1 = std::min<int64_t>(static_cast<int64_t>(x) + width, vkstate.extent.width);
+	int64_t y1 = std::min<int64_t>(static_cast<int64_t>(y) + height, vkstate.extent.height);
+	if (x0 >= x1 || y0 >= y1) {
+		return;
 	}
 
-	VkCommandPoolCreateInfo command_pool_create_info = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-		.queueFamilyIndex = vkstate.queue_families.graphics,
+	VkRect2D rect = {
+		.offset = { static_cast<int32_t>(x0), static_cast<int32_t>(y0) },
+		.extent = { static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0) },
 	};
 
-	if (vkCreateCommandPool(vkstate.device, &command_pool_create_info, vkstate.allocator, &vkstate.command_pool) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create command pool");
-		return 1;
+	/* gl rows are bottom up, which is the order the unflipped viewport leaves them in */
+	VkDeviceSize skip = base + static_cast<VkDeviceSize>(y0 - y) * stride + static_cast<VkDeviceSize>(x0 - x) * 4;
+	if (pack != nullptr && (pack_offset + skip) % 4 != 0) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glReadPixels into a pack buffer needs a 4 byte aligned offset");
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
 	}
 
-	VkCommandBufferAllocateInfo command_buffer_allocate_info = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.pNext = nullptr,
-		.commandPool = vkstate.command_pool,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = 1,
-	};
+	/* the copy into a pack buffer cannot overlap its own rows */
+	if (pack != nullptr && stride / 4 < rect.extent.width) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glReadPixels into a pack buffer needs GL_PACK_ROW_LENGTH of at least the width");
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
 
-	if (vkAllocateCommandBuffers(vkstate.device, &command_buffer_allocate_info, &vkstate.command_buffer) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to allocate command buffer");
-		return 1;
+	if (!beginFrame()) {
+		return;
 	}
 
-	VkSemaphoreCreateInfo semaphore_create_info = {
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-	};
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	VkFormat pack_format = packFormat(format);
 
-	if (vkCreateSemaphore(vkstate.device, &semaphore_create_info, vkstate.allocator, &vkstate.render_finished) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create semaphore");
-		return 1;
-	}
+	/* with a pack buffer bound the copy runs with the frame, mapping the buffer waits for it like for any other gpu write */
+	if (pack != nullptr) {
+		VkResult res = recordReadPixels(frame, rect, pack_format, pack->store.buffer, pack_offset + skip, static_cast<uint32_t>(stride / 4));
+		if (res != VK_SUCCESS) {
+			GLenum error = res == VK_ERROR_FORMAT_NOT_SUPPORTED ? GL_INVALID_OPERATION : GL_OUT_OF_MEMORY;
+			GLPUSHERROR(error);
+			return;
+		}
 
-	if (vkCreateSemaphore(vkstate.device, &semaphore_create_info, vkstate.allocator, &vkstate.image_available) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create semaphore");
-		return 1;
+		pack->store.last_use = frame.number;
+		pack->store.last_write = frame.number;
+		return;
 	}
 
-	VkFenceCreateInfo fence_create_info = {
-		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = VK_FENCE_CREATE_SIGNALED_BIT,
-	};
+	VkBuffer readback;
+	allocation_t readback_memory;
+	VkMemoryPropertyFlags required;
+	VkMemoryPropertyFlags preferred;
+	placementFlags(BUFFER_PLACEMENT_READBACK, required, preferred);
 
-	if (vkCreateFence(vkstate.device, &fence_create_info, vkstate.allocator, &vkstate.in_flight_fence) != VK_SUCCESS) {
-		GLVKDEBUG(GLVK_TYPE_VULKAN, GLVK_SEVERITY_ERROR, "Failed to create fence");
-		return 1;
+	VkDeviceSize row_size = static_cast<VkDeviceSize>(rect.extent.width) * 4;
+	if (createBuffer(row_size * rect.extent.height, VK_BUFFER_USAGE_TRANSFER_DST_BIT, required, preferred, readback, readback_memory) != VK_SUCCESS) {
+		GLPUSHERROR(GL_OUT_OF_MEMORY);
+		return;
 	}
 
-	state.inited = true;
-	GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_VERBOSE, "Initialization success");
-	return 0;
-}
-
-void glvkDraw() {
-	if (!state.inited) {
+	VkResult res = recordReadPixels(frame, rect, pack_format, readback, 0, rect.extent.width);
+	if (res != VK_SUCCESS) {
+		vkDestroyBuffer(vkstate.device, readback, vkstate.allocator);
+		freeMemory(readback_memory);
+		GLenum error = res == VK_ERROR_FORMAT_NOT_SUPPORTED ? GL_INVALID_OPERATION : GL_OUT_OF_MEMORY;
+		GLPUSHERROR(error);
 		return;
 	}
 
-	vkWaitForFences(vkstate.device, 1, &vkstate.in_flight_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
-	vkResetFences(vkstate.device, 1, &vkstate.in_flight_fence);
+	/* no pack buffer, the caller needs the pixels now */
+	flushFrame();
 
-	uint32_t image_index = 0;
-	vkAcquireNextImageKHR(vkstate.device, vkstate.swapchain, std::numeric_limits<uint64_t>::max(), vkstate.image_available, VK_NULL_HANDLE, &image_index);
+	const uint8_t* src = static_cast<const uint8_t*>(readback_memory.mapped);
+	uint8_t* dst = static_cast<uint8_t*>(pixels) + skip;
+	for (uint32_t row = 0; row < rect.extent.height; ++row) {
+		memcpy(dst + row * stride, src + row * row_size, row_size);
+	}
 
-	vkResetCommandBuffer(vkstate.command_buffer, 0);
+	vkDestroyBuffer(vkstate.device, readback, vkstate.allocator);
+	freeMemory(readback_memory);
+}
 
-	VkCommandBufferBeginInfo command_buffer_begin_info = {
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.pNext = nullptr,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-		.pInheritanceInfo = nullptr,
-	};
+void glvkGetFrameStats(GLVKframestats* stats) {
+	GLVK_SYNC();
+	if (stats == nullptr) {
+		return;
+	}
 
-	vkBeginCommandBuffer(vkstate.command_buffer, &command_buffer_begin_info);
+	*stats = vkstate.frame_stats;
+}
 
-	VkClearValue clear_value = {
-		.color = { 0.0f, 0.0f, 0.0f, 1.0f },
-	};
+void glvkBeginScope(const char* name) {
+	GLVK_DEFER(glvkBeginScope, name);
+	if (!state.inited || !beginFrame()) {
+		return;
+	}
 
-	VkRenderPassBeginInfo render_pass_begin_info = {
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-		.pNext = nullptr,
-		.renderPass = vkstate.render_pass,
-		.framebuffer = vkstate.framebuffers[image_index],
-		.renderArea = {
-			.offset = { 0, 0 },
-			.extent = vkstate.extent,
-		},
-		.clearValueCount = 1,
-		.pClearValues = &clear_value,
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	framescope_t scope = {
+		.name = (name != nullptr) ? name : "",
+		.depth = static_cast<uint32_t>(frame.open_scopes.size()),
+		.begin = writeTimestamp(frame, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+		.end = std::numeric_limits<uint32_t>::max(),
+		.cpu_begin = cpuTime(),
+		.cpu_ns = 0,
 	};
 
-	vkCmdBeginRenderPass(vkstate.command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(vkstate.command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vkstate.pipeline);
-
-	vkCmdSetViewport(vkstate.command_buffer, 0, 1, &vkstate.viewport);
-	vkCmdSetScissor(vkstate.command_buffer, 0, 1, &vkstate.scissor);
+	frame.open_scopes.push_back(static_cast<uint32_t>(frame.scopes.size()));
+	frame.scopes.push_back(scope);
+}
 
-	vkCmdDraw(vkstate.command_buffer, 3, 1, 0, 0);
-	vkCmdEndRenderPass(vkstate.command_buffer);
+void glvkEndScope() {
+	GLVK_DEFER(glvkEndScope);
+	/* scopes opened while no frame could be begun were never recorded */
+	if (!state.inited || !vkstate.frame_active) {
+		return;
+	}
 
-	vkEndCommandBuffer(vkstate.command_buffer);
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	if (frame.open_scopes.empty()) {
+		GLVKDEBUG(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "glvkEndScope without a matching glvkBeginScope in this frame");
+		return;
+	}
 
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	VkSubmitInfo submit_info = {
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.pNext = nullptr,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &vkstate.image_available,
-		.pWaitDstStageMask = wait_stages,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &vkstate.command_buffer,
-		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &vkstate.render_finished,
-	};
+	endScope(frame);
+}
 
-	vkQueueSubmit(vkstate.graphics_queue, 1, &submit_info, vkstate.in_flight_fence);
+/* writes one of a query's timestamps into the recording frame, timestamps that cannot be written read as 0 */
+static void queryTimestamp(glquery_t& query, uint32_t which) {
+	query.ticks[which] = 0;
+	if (!beginFrame()) {
+		return;
+	}
 
-	VkPresentInfoKHR present_info = {
-		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-		.pNext = nullptr,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &vkstate.render_finished,
-		.swapchainCount = 1,
-		.pSwapchains = &vkstate.swapchain,
-		.pImageIndices = &image_index,
-		.pResults = nullptr,
-	};
+	GLVKvkframe& frame = vkstate.frames[vkstate.frame_index];
+	uint32_t index = writeTimestamp(frame, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	if (index == std::numeric_limits<uint32_t>::max()) {
+		return;
+	}
 
-	vkQueuePresentKHR(vkstate.present_queue, &present_info);
-	vkQueueWaitIdle(vkstate.present_queue);
+	query.written |= 1u << which;
+	query.pending |= 1u << which;
+	query.frames[which] = frame.number;
+	query.slots[which] = vkstate.frame_index;
+	frame.timestamp_refs.push_back({
+		.index = index,
+		.query = query.id,
+		.serial = query.serial,
+		.which = which,
+	});
 }
 
-void glvkDeinit() {
-	if (!state.inited) {
+/* notices a submitted slot's fence having signalled without waiting on it */
+static void pollFrame(uint32_t slot) {
+	GLVKvkframe& frame = vkstate.frames[slot];
+	if (vkstate.frame_prepared && slot == vkstate.frame_index) {
 		return;
 	}
-	state.inited = false;
 
-	for (size_t i = 0; i < glstate.buffers.size(); ++i) {
-		glDeleteBuffers(1, &glstate.buffers[i].id);
+	if (frame.number > vkstate.completed_frame && vkGetFenceStatus(vkstate.device, frame.in_flight_fence) == VK_SUCCESS) {
+		vkstate.completed_frame = frame.number;
 	}
+}
 
-	vkDeviceWaitIdle(vkstate.device);
-	vkDestroySemaphore(vkstate.device, vkstate.image_available, vkstate.allocator);
-	vkDestroySemaphore(vkstate.device, vkstate.render_finished, vkstate.allocator);
-	vkDestroyFence(vkstate.device, vkstate.in_flight_fence, vkstate.allocator);
-	vkFreeCommandBuffers(vkstate.device, vkstate.command_pool, 1, &vkstate.command_buffer);
-	vkDestroyCommandPool(vkstate.device, vkstate.command_pool, vkstate.allocator);
-	vkDestroyShaderModule(vkstate.device, vkstate.vshader, vkstate.allocator);
-	vkDestroyShaderModule(vkstate.device, vkstate.fshader, vkstate.allocator);
-	vkDestroyDescriptorSetLayout(vkstate.device, vkstate.desc_layout, vkstate.allocator);
-	vkDestroyPipelineLayout(vkstate.device, vkstate.pipeline_layout, vkstate.allocator);
-	vkDestroyPipeline(vkstate.device, vkstate.pipeline, vkstate.allocator);
-	for (size_t i = 0; i < vkstate.swapchain_image_count; ++i) {
-		vkDestroyFramebuffer(vkstate.device, vkstate.framebuffers[i], vkstate.allocator);
+/* fetches the value of an ended query in nanoseconds, waiting for the frames that wrote it when wait is set.
+ * returns false while the result is not available yet */
+static bool queryValue(glquery_t& query, bool wait, uint64_t& value) {
+	uint64_t results[GLVK_FRAME_QUERY_COUNT * 2];
+	for (uint32_t which = 0; which < 2; ++which) {
+		if (!(query.pending & (1u << which))) {
+			continue;
+		}
+
+		if (wait) {
+			waitForFrame(query.frames[which]);
+		} else {
+			pollFrame(query.slots[which]);
+		}
+
+		GLVKvkframe& frame = vkstate.frames[query.slots[which]];
+		if (readTimestamps(frame, results)) {
+			resolveQueries(frame, results);
+		}
 	}
-	vkDestroyRenderPass(vkstate.device, vkstate.render_pass, vkstate.allocator);
-	for (size_t i = 0; i < vkstate.swapchain_image_count; ++i) {
-		vkDestroyImageView(vkstate.device, vkstate.swapchain_views[i], vkstate.allocator);
+
+	value = 0;
+	if (query.pending != 0) {
+		return false;
 	}
-	vkDestroySwapchainKHR(vkstate.device, vkstate.swapchain, vkstate.allocator);
-	vkDestroyDevice(vkstate.device, vkstate.allocator);
-	vkDestroySurfaceKHR(vkstate.instance, vkstate.surface, vkstate.allocator);
-	if (vkstate.debug_messenger != VK_NULL_HANDLE) {
-		PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(vkstate.instance, "vkDestroyDebugUtilsMessengerEXT"));
-		if (vkDestroyDebugUtilsMessengerEXT != nullptr) {
-			vkDestroyDebugUtilsMessengerEXT(vkstate.instance, vkstate.debug_messenger, vkstate.allocator);
+
+	if (query.target == GL_TIMESTAMP) {
+		if (query.written & 1u) {
+			value = timestampDelta(0, query.ticks[0]);
 		}
+	} else if ((query.written & 3u) == 3u) {
+		value = timestampDelta(query.ticks[0], query.ticks[1]);
 	}
-	vkDestroyInstance(vkstate.instance, nullptr);
+	return true;
 }
 
-GLenum glGetError(void) {
-	if (glstate.errors.empty()) {
-		return GL_NO_ERROR;
+void glGenQueries(GLsizei n, GLuint* ids) {
+	GLVK_SYNC();
+	if (n < 1) {
+		GLPUSHERROR(GL_INVALID_VALUE);
+		return;
 	}
 
-	GLenum error = glstate.errors.top();
-	glstate.errors.pop();
+	for (GLsizei i = 0; i < n; ++i) {
+		glquery_t query = {
+			.id = 0,
+			.target = 0,
+			.active = false,
+			.serial = 0,
+			.written = 0,
+			.pending = 0,
+			.ticks = { 0, 0 },
+			.frames = { 0, 0 },
+			.slots = { 0, 0 },
+		};
 
-	return error;
+		ids[i] = glstate.queries.create(query);
+		if (ids[i] == 0) {
+			GLPUSHERROR(GL_OUT_OF_MEMORY);
+			return;
+		}
+
+		glstate.queries.get(ids[i])->id = ids[i];
+	}
 }
 
-void glGenBuffers(GLsizei n, GLuint* buffers) {
-	if (n < 1) {
+void glDeleteQueries(GLsizei n, const GLuint* ids) {
+	if (commandThreaded()) {
+		if (n < 1 || ids == nullptr || static_cast<size_t>(n) * sizeof(GLuint) <= GLVK_COMMAND_DATA_LIMIT) {
+			deferCommand<glDeleteQueries>(n, static_cast<const GLuint*>(commandCopy(ids, n > 0 ? n * sizeof(GLuint) : 0)));
+			return;
+		}
+	}
+	GLVK_SYNC();
+
+	if (n < 1 || ids == nullptr) {
 		GLPUSHERROR(GL_INVALID_VALUE);
 		return;
 	}
 
+	/* timestamps still in flight for a deleted query no longer resolve and are dropped */
 	for (GLsizei i = 0; i < n; ++i) {
-		glbuffer_t buffer = {
-			.id = static_cast<GLuint>(glstate.buffers.size()) + 1,
-			.buffer = VK_NULL_HANDLE,
-			.memory = VK_NULL_HANDLE,
-			.size = 0,
-		};
-
-		glstate.buffers.push_back(buffer);
-		buffers[i] = buffer.id;
+		if (glstate.active_query == ids[i]) {
+			glstate.active_query = 0;
+		}
+		glstate.queries.destroy(ids[i]);
 	}
 }
 
-void glBindBuffer(GLenum target, GLuint buffer) {
-	if (
-		target != GL_ARRAY_BUFFER &&
-		target != GL_ELEMENT_ARRAY_BUFFER &&
-		target != GL_COPY_READ_BUFFER &&
-		target != GL_COPY_WRITE_BUFFER &&
-		target != GL_PIXEL_PACK_BUFFER &&
-		target != GL_PIXEL_UNPACK_BUFFER &&
-		target != GL_TRANSFORM_FEEDBACK_BUFFER &&
-		target != GL_UNIFORM_BUFFER &&
-		target != GL_SHADER_STORAGE_BUFFER &&
-		target != GL_TEXTURE_BUFFER
-	) {
-		GLPUSHERROR(GL_INVALID_ENUM);
+GLboolean glIsQuery(GLuint id) {
+	GLVK_SYNC();
+	/* a generated name only becomes a query object once it is begun or counted */
+	glquery_t* query = glstate.queries.get(id);
+	return (query != nullptr && query->target != 0) ? GL_TRUE : GL_FALSE;
+}
+
+void glBeginQuery(GLenum target, GLuint id) {
+	GLVK_DEFER(glBeginQuery, target, id);
+	if (!state.inited) {
 		return;
 	}
 
-	if (target == GL_ARRAY_BUFFER) {
-		glstate.bound_buffers.array = buffer;
-	} else if (target == GL_ELEMENT_ARRAY_BUFFER) {
-		glstate.bound_buffers.element_array = buffer;
-	} else if (target == GL_COPY_READ_BUFFER) {
-		glstate.bound_buffers.copy_read = buffer;
-	} else if (target == GL_COPY_WRITE_BUFFER) {
-		glstate.bound_buffers.copy_write = buffer;
-	} else if (target == GL_PIXEL_PACK_BUFFER) {
-		glstate.bound_buffers.pixel_pack = buffer;
-	} else if (target == GL_PIXEL_UNPACK_BUFFER) {
-		glstate.bound_buffers.pixel_unpack = buffer;
-	} else if (target == GL_TRANSFORM_FEEDBACK_BUFFER) {
-		glstate.bound_buffers.transform_feedback = buffer;
-	} else if (target == GL_UNIFORM_BUFFER) {
-		glstate.bound_buffers.uniform = buffer;
-	} else if (target == GL_SHADER_STORAGE_BUFFER) {
-		glstate.bound_buffers.shader_storage = buffer;
-	} else if (target == GL_TEXTURE_BUFFER) {
-		glstate.bound_buffers.texture = buffer;
-	} else {
+	if (target != GL_TIME_ELAPSED) {
+		GLVKDEBUGF(GLVK_TYPE_GLVK, GLVK_SEVERITY_WARNING, "Query target {} is not supported", target);
 		GLPUSHERROR(GL_INVALID_ENUM);
 		return;
 	}
+
+	glquery_t* query = glstate.queries.get(id);
+	if (query == nullptr || glstate.active_query != 0 || (query->target != 0 && query->target != target)) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
+	}
+
+	query->target = target;
+	query->active = true;
+	++query->serial;
+	query->written = 0;
+	query->pending = 0;
+	glstate.active_query = id;
+	queryTimestamp(*query, 0);
 }
 
-void glBufferData(GLenum target, GLsizei size, const GLvoid* data, GLenum usage) {
-	GLuint buffer = 0;
-	if (target == GL_ARRAY_BUFFER) {
-		buffer = glstate.bound_buffers.array;
-	} else if (target == GL_ELEMENT_ARRAY_BUFFER) {
-		buffer = glstate.bound_buffers.element_array;
-	} else if (target == GL_COPY_READ_BUFFER) {
-		buffer = glstate.bound_buffers.copy_read;
-	} else if (target == GL_COPY_WRITE_BUFFER) {
-		buffer = glstate.bound_buffers.copy_write;
-	} else if (target == GL_PIXEL_PACK_BUFFER) {
-		buffer = glstate.bound_buffers.pixel_pack;
-	} else if (target == GL_PIXEL_UNPACK_BUFFER) {
-		buffer = glstate.bound_buffers.pixel_unpack;
-	} else if (target == GL_TRANSFORM_FEEDBACK_BUFFER) {
-		buffer = glstate.bound_buffers.transform_feedback;
-	} else if (target == GL_UNIFORM_BUFFER) {
-		buffer = glstate.bound_buffers.uniform;
-	} else if (target == GL_SHADER_STORAGE_BUFFER) {
-		buffer = glstate.bound_buffers.shader_storage;
-	} else if (target == GL_TEXTURE_BUFFER) {
-		buffer = glstate.bound_buffers.texture;
-	} else {
+void glEndQuery(GLenum target) {
+	GLVK_DEFER(glEndQuery, target);
+	if (!state.inited) {
+		return;
+	}
+
+	if (target != GL_TIME_ELAPSED) {
 		GLPUSHERROR(GL_INVALID_ENUM);
 		return;
 	}
 
-	if (buffer == 0 || buffer > glstate.buffers.size()) {
+	glquery_t* query = glstate.queries.get(glstate.active_query);
+	if (query == nullptr) {
 		GLPUSHERROR(GL_INVALID_OPERATION);
 		return;
 	}
 
-	if (size < 0) {
-		GLPUSHERROR(GL_INVALID_VALUE);
+	query->active = false;
+	glstate.active_query = 0;
+	queryTimestamp(*query, 1);
+}
+
+void glQueryCounter(GLuint id, GLenum target) {
+	GLVK_DEFER(glQueryCounter, id, target);
+	if (!state.inited) {
 		return;
 	}
 
-	if (
-		usage != GL_STREAM_DRAW  &&
-		usage != GL_STREAM_READ  &&
-		usage != GL_STREAM_COPY  &&
-		usage != GL_STATIC_DRAW  &&
-		usage != GL_STATIC_READ  &&
-		usage != GL_STATIC_COPY  &&
-		usage != GL_DYNAMIC_DRAW &&
-		usage != GL_DYNAMIC_READ &&
-		usage != GL_DYNAMIC_COPY
-	) {
+	if (target != GL_TIMESTAMP) {
 		GLPUSHERROR(GL_INVALID_ENUM);
 		return;
 	}
 
-	glbuffer_t& glbuffer = glstate.buffers[buffer - 1];
-	if (glbuffer.buffer != VK_NULL_HANDLE) {
-		vkDestroyBuffer(vkstate.device, glbuffer.buffer, vkstate.allocator);
-		vkFreeMemory(vkstate.device, glbuffer.memory, vkstate.allocator);
+	glquery_t* query = glstate.queries.get(id);
+	if (query == nullptr || query->active || (query->target != 0 && query->target != target)) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return;
 	}
 
-	VkBufferCreateInfo buffer_create_info = {
-		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-		.size = static_cast<VkDeviceSize>(size),
-		.usage = usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-		.queueFamilyIndexCount = 0,
-		.pQueueFamilyIndices = nullptr,
-	};
+	query->target = target;
+	++query->serial;
+	query->written = 0;
+	query->pending = 0;
+	queryTimestamp(*query, 0);
+}
 
-	VkBuffer buf;
-	VkResult res = vkCreateBuffer(vkstate.device, &buffer_create_info, vkstate.allocator, &buf);
-	if (res != VK_SUCCESS) {
-		if (res == VK_ERROR_OUT_OF_HOST_MEMORY || res == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
-			GLPUSHERROR(GL_OUT_OF_MEMORY);
-		} else {
-			GLPUSHERROR(GL_INVALID_OPERATION);
-		}
+void glGetQueryiv(GLenum target, GLenum pname, GLint* params) {
+	GLVK_SYNC();
+	if (target != GL_TIME_ELAPSED && target != GL_TIMESTAMP) {
+		GLPUSHERROR(GL_INVALID_ENUM);
 		return;
 	}
 
-	VkMemoryRequirements reqs;
-	vkGetBufferMemoryRequirements(vkstate.device, buf, &reqs);
+	switch (pname) {
+		case GL_CURRENT_QUERY: *params = (target == GL_TIME_ELAPSED) ? static_cast<GLint>(glstate.active_query) : 0; return;
+		case GL_QUERY_COUNTER_BITS: *params = static_cast<GLint>(vkstate.timestamp_bits); return;
+	}
 
-	VkMemoryAllocateInfo alloc_info = {
-		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-		.pNext = nullptr,
-		.allocationSize = reqs.size,
-		.memoryTypeIndex = 0,
-	};
+	GLPUSHERROR(GL_INVALID_ENUM);
+}
 
-	bool found = false;
-	for (uint32_t i = 0; i < vkstate.physical.memory_properties.memoryTypeCount; ++i) {
-		if ((reqs.memoryTypeBits & (1 << i)) && (vkstate.physical.memory_properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && (vkstate.physical.memory_properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-			alloc_info.memoryTypeIndex = i;
-			found = true;
-			break;
-		}
+/* shared by the glGetQueryObject* variants, returns false when an error was pushed */
+static bool queryObject(GLuint id, GLenum pname, uint64_t& value) {
+	if (!state.inited) {
+		return false;
 	}
 
-	if (!found) {
-		vkDestroyBuffer(vkstate.device, buf, vkstate.allocator);
-		GLPUSHERROR(GL_OUT_OF_MEMORY);
-		return;
+	glquery_t* query = glstate.queries.get(id);
+	if (query == nullptr || query->target == 0 || query->active) {
+		GLPUSHERROR(GL_INVALID_OPERATION);
+		return false;
 	}
 
-	VkDeviceMemory mem;
-	res = vkAllocateMemory(vkstate.device, &alloc_info, vkstate.allocator, &mem);
-	if (res != VK_SUCCESS) {
-		if (res == VK_ERROR_OUT_OF_HOST_MEMORY || res == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
-			GLPUSHERROR(GL_OUT_OF_MEMORY);
-		} else {
-			GLPUSHERROR(GL_INVALID_OPERATION);
-		}
-		vkDestroyBuffer(vkstate.device, buf, vkstate.allocator);
-		return;
+	if (pname == GL_QUERY_RESULT_AVAILABLE) {
+		uint64_t result;
+		value = queryValue(*query, false, result) ? GL_TRUE : GL_FALSE;
+		return true;
 	}
 
-	void* mapped;
-	res = vkMapMemory(vkstate.device, mem, 0, size, 0, &mapped);
-	if (res != VK_SUCCESS) {
-		if (res == VK_ERROR_OUT_OF_HOST_MEMORY || res == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
-			GLPUSHERROR(GL_OUT_OF_MEMORY);
-		} else {
-			GLPUSHERROR(GL_INVALID_OPERATION);
-		}
-		vkFreeMemory(vkstate.device, mem, vkstate.allocator);
-		vkDestroyBuffer(vkstate.device, buf, vkstate.allocator);
-		return;
+	if (pname == GL_QUERY_RESULT) {
+		queryValue(*query, true, value);
+		return true;
 	}
 
-	memcpy(mapped, data, size);
-	vkUnmapMemory(vkstate.device, mem);
+	GLPUSHERROR(GL_INVALID_ENUM);
+	return false;
+}
 
-	res = vkBindBufferMemory(vkstate.device, buf, mem, 0);
-	if (res != VK_SUCCESS) {
-		if (res == VK_ERROR_OUT_OF_HOST_MEMORY || res == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
-			GLPUSHERROR(GL_OUT_OF_MEMORY);
-		} else {
-			GLPUSHERROR(GL_INVALID_OPERATION);
-		}
-		vkFreeMemory(vkstate.device, mem, vkstate.allocator);
-		vkDestroyBuffer(vkstate.device, buf, vkstate.allocator);
-		return;
+void glGetQueryObjectiv(GLuint id, GLenum pname, GLint* params) {
+	GLVK_SYNC();
+	uint64_t value;
+	if (queryObject(id, pname, value)) {
+		*params = static_cast<GLint>(std::min<uint64_t>(value, std::numeric_limits<GLint>::max()));
 	}
-
-	glbuffer.buffer = buf;
-	glbuffer.memory = mem;
-	glbuffer.size = size;
 }
 
-void glDeleteBuffers(GLsizei n, const GLuint *buffers) {
-	if (n < 1 || buffers == nullptr) {
-		GLPUSHERROR(GL_INVALID_VALUE);
-		return;
+void glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params) {
+	GLVK_SYNC();
+	uint64_t value;
+	if (queryObject(id, pname, value)) {
+		*params = static_cast<GLuint>(std::min<uint64_t>(value, std::numeric_limits<GLuint>::max()));
 	}
+}
 
-	std::vector<GLuint> pending_removal;
-	for (GLsizei i = 0; i < n; ++i) {
-		if (buffers[i] == 0 || buffers[i] > glstate.buffers.size()) {
-			GLPUSHERROR(GL_INVALID_VALUE);
-			return;
-		}
-
-		glbuffer_t& glbuffer = glstate.buffers[buffers[i] - 1];
-		if (glbuffer.buffer != VK_NULL_HANDLE) {
-			vkDestroyBuffer(vkstate.device, glbuffer.buffer, vkstate.allocator);
-			vkFreeMemory(vkstate.device, glbuffer.memory, vkstate.allocator);
-		}
-
-		pending_removal.push_back(buffers[i] - 1);
+void glGetQueryObjecti64v(GLuint id, GLenum pname, GLint64* params) {
+	GLVK_SYNC();
+	uint64_t value;
+	if (queryObject(id, pname, value)) {
+		*params = static_cast<GLint64>(std::min<uint64_t>(value, std::numeric_limits<GLint64>::max()));
 	}
+}
 
-	for (size_t i = 0; i < pending_removal.size(); ++i) {
-		GLuint buf = pending_removal[i];
-		glstate.buffers.erase(glstate.buffers.begin() + buf);
-		pending_removal.erase(pending_removal.begin() + i);
-		for (size_t j = 0; j < pending_removal.size(); ++j) {
-			if (pending_removal[j] >= buf) {
-				--pending_removal[j];
-			}
-		}
+void glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) {
+	GLVK_SYNC();
+	uint64_t value;
+	if (queryObject(id, pname, value)) {
+		*params = value;
 	}
 }
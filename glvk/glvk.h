@@ -1,6 +1,8 @@
 #ifndef KRISVERS_GLVK_H
 #define KRISVERS_GLVK_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -57,20 +59,161 @@ typedef struct {
 
 typedef void (*GLVKdebugfunc)(const char* message, GLVKmessagetype type, GLVKmessageseverity severity);
 
+#define GLVK_DEFAULT_FRAMES_IN_FLIGHT 2
+#define GLVK_MAX_FRAMES_IN_FLIGHT 8
+#define GLVK_DEFAULT_PIPELINE_CACHE_PATH "glvk_pipeline_cache.bin"
+#define GLVK_DEFAULT_SHADER_CACHE_PATH "glvk_shader_cache"
+#define GLVK_MAX_FRAME_SCOPES 32
+#define GLVK_MAX_RECORD_THREADS 16
+
+/* indexed bindings reach shaders through one bindless descriptor set and a push constant block of indices into it:
+ *   layout(push_constant) uniform glvk_bindings { uint uniform_buffers[8]; uint storage_buffers[8]; uint textures[16]; };
+ *   layout(set = 0, binding = 0) uniform glvk_uniform_block { ... } glvk_uniform_buffers[];
+ *   layout(set = 0, binding = 1) buffer glvk_storage_block { ... } glvk_storage_buffers[];
+ *   layout(set = 0, binding = 2) uniform sampler2D glvk_textures[];
+ * so the block bound to uniform buffer binding i is glvk_uniform_buffers[uniform_buffers[i]].
+ * devices without descriptor indexing get one descriptor per binding instead: uniform buffer i at binding i,
+ * storage buffer i at binding GLVK_MAX_UNIFORM_BUFFER_BINDINGS + i and texture unit i after those */
+#define GLVK_MAX_UNIFORM_BUFFER_BINDINGS 8
+#define GLVK_MAX_SHADER_STORAGE_BUFFER_BINDINGS 8
+#define GLVK_MAX_TEXTURE_UNITS 16
+#define GLVK_MAX_VERTEX_ATTRIBS 16
+#define GLVK_MAX_VERTEX_ATTRIB_STRIDE 2048
+
+/* glUniform* write the default uniform block, bound as a dynamic uniform buffer in set 1:
+ *   layout(std140, set = 1, binding = 0) uniform glvk_default_block { vec4 glvk_uniforms[GLVK_MAX_UNIFORM_LOCATIONS]; };
+ * location l is the 16 byte slot glvk_uniforms[l], array elements and matrix columns take a slot each.
+ * slots above the highest one written so far are undefined */
+#define GLVK_MAX_UNIFORM_LOCATIONS 256
+
+/* glCompileShader takes gl flavoured glsl and rewrites its declarations onto the layout above before compiling to spir-v:
+ *   layout(binding = n) uniform sampler2D s;              texture unit n (0 without a binding)
+ *   layout(binding = n) uniform/buffer block { ... } b;    uniform buffer or shader storage buffer binding n
+ *   layout(location = l) uniform vec4 v, w;                default uniform block slots l and on, for scalars, vectors and matrices
+ * gl_VertexID and gl_InstanceID become gl_VertexIndex and gl_InstanceIndex, #version is raised to 450 and GLVK_BINDLESS is
+ * defined to whether the device has descriptor indexing. declarations with a set are left alone, loose uniforms need a location
+ * and fail to compile when they are arrays, structs, non-square matrices or have initializers, samplers have to be single sampler2D
+ * declarations, and in/out variables without one are assigned in declaration order, so stages should give theirs explicitly.
+ * compiling needs glvk built with GLVK_GLSLANG (glslang's c interface), the spir-v is cached on disk by the source it came from
+ * so shaders found in the cache load without a compiler */
+
+typedef struct {
+	unsigned int block_count;
+	unsigned int dedicated_count;
+	unsigned int allocation_count;
+	unsigned long long reserved_bytes;
+	unsigned long long used_bytes;
+	unsigned long long largest_free_bytes;
+	/* 0 when all free space in blocks is contiguous, approaching 1 as it is split into small pieces */
+	float fragmentation;
+} GLVKmemorystats;
+
+typedef struct {
+	unsigned int pipeline_count;
+	unsigned long long hits;
+	unsigned long long misses;
+	/* time spent building pipelines on cache misses, in microseconds */
+	unsigned long long compile_us;
+	unsigned long long max_compile_us;
+	/* glCompileShader calls found in the shader cache, calls that compiled and the time spent compiling, in microseconds */
+	unsigned int shader_cache_hits;
+	unsigned int shader_compiles;
+	unsigned long long shader_compile_us;
+} GLVKpipelinestats;
+
+typedef struct {
+	unsigned long long draws;
+	/* pipeline, buffer, descriptor and dynamic state commands recorded for draws */
+	unsigned long long state_commands;
+	/* state left alone because nothing changed: gl calls setting the current value and binds matching what the command buffer had */
+	unsigned long long redundant_state;
+} GLVKstatestats;
+
+typedef struct {
+	const char* name;
+	/* number of scopes this one is nested in */
+	unsigned int depth;
+	unsigned long long cpu_ns;
+	/* 0 when the graphics queue has no timestamps or the frame ran out of queries */
+	unsigned long long gpu_ns;
+} GLVKscopestats;
+
+typedef struct {
+	/* number of the frame described, 0 before the first frame has finished on the gpu */
+	unsigned long long frame;
+	/* recording on the cpu, from the frame slot becoming free to submission, without the acquire wait */
+	unsigned long long cpu_ns;
+	/* waiting for the frame slot's previous frame to finish on the gpu */
+	unsigned long long fence_ns;
+	unsigned long long acquire_ns;
+	unsigned long long submit_ns;
+	unsigned long long present_ns;
+	/* from the first to the last command of the frame, 0 when the graphics queue has no timestamps */
+	unsigned long long gpu_ns;
+	/* scopes in the order they were opened, at most GLVK_MAX_FRAME_SCOPES are reported */
+	unsigned int scope_count;
+	GLVKscopestats scopes[GLVK_MAX_FRAME_SCOPES];
+} GLVKframestats;
+
 /* initializes all necessary vulkan utilities */
 int glvkInit(GLVKwindow window);
 
+/* initializes without a window, frames are rendered into width x height offscreen images instead of a swapchain */
+int glvkInitHeadless(unsigned int width, unsigned int height);
+
 /* registers debug output callback */
 void glvkRegisterDebugFunc(GLVKdebugfunc func);
 
 /* enables or disables debugging */
 void glvkSetDebug(int enabled);
 
+/* sets how many frames the cpu may record ahead of the gpu, must be called before glvkInit (clamped to 1..GLVK_MAX_FRAMES_IN_FLIGHT) */
+void glvkSetFramesInFlight(unsigned int count);
+
+/* sets how many threads record draws, must be called before glvkInit (clamped to 1..GLVK_MAX_RECORD_THREADS).
+ * with more than one, draws are collected and recorded into secondary command buffers by a pool of count - 1 workers plus the calling thread */
+void glvkSetRecordThreads(unsigned int count);
+
+/* moves all vulkan work to a worker thread, must be called before glvkInit. gl calls are then recorded into a command ring
+ * and replayed in order by the worker; calls returning state (glGetError, glGen*, glMapBufferRange, glReadPixels, glGetQuery*, ...)
+ * first wait for it to catch up. gl calls must still come from a single thread, the debug callback may run on the worker */
+void glvkSetThreaded(int enabled);
+
+/* sets the file compiled pipelines are loaded from at glvkInit and saved to at glvkDeinit, must be called before glvkInit.
+ * defaults to GLVK_DEFAULT_PIPELINE_CACHE_PATH, NULL keeps the cache in memory only */
+void glvkSetPipelineCachePath(const char* path);
+
+/* sets the directory compiled shaders are cached in, one file per distinct source, must be called before glvkInit.
+ * defaults to GLVK_DEFAULT_SHADER_CACHE_PATH, NULL disables the cache */
+void glvkSetShaderCachePath(const char* path);
+
+/* reports usage of the device memory sub-allocator */
+void glvkGetMemoryStats(GLVKmemorystats* stats);
+
+/* reports how often draws found their pipeline already built and how long building the others took */
+void glvkGetPipelineStats(GLVKpipelinestats* stats);
+
+/* reports how many state commands draws recorded and how much state was dropped as redundant, counted since glvkInit */
+void glvkGetStateStats(GLVKstatestats* stats);
+
+/* reports timings of the latest frame whose gpu work has finished, which trails glvkDraw by the frames in flight */
+void glvkGetFrameStats(GLVKframestats* stats);
+
+/* opens a named timing scope in the current frame, scopes nest and are closed at the latest by glvkDraw.
+ * name is not copied and has to stay valid until the frame is reported, e.g. a string literal */
+void glvkBeginScope(const char* name);
+void glvkEndScope(void);
+
 /* cleans up all necessary vulkan utilities*/
 void glvkDeinit(void);
 
+/* submits the gl commands recorded for the current frame and presents it */
 void glvkDraw(void);
 
+/* copies the last frame drawn by a headless context into pixels as tightly packed RGBA8 sRGB rows, top row first.
+ * waits for that frame to finish, returns non-zero when there is no headless frame to read */
+int glvkReadFrame(void* pixels);
+
 typedef unsigned int GLenum;
 typedef unsigned char GLboolean;
 typedef unsigned int GLbitfield;
@@ -86,13 +229,136 @@ typedef float GLclampf;
 typedef double GLdouble;
 typedef double GLclampd;
 typedef void GLvoid;
+typedef char GLchar;
+typedef ptrdiff_t GLintptr;
+typedef ptrdiff_t GLsizeiptr;
+typedef long long GLint64;
+typedef unsigned long long GLuint64;
 
 GLenum glGetError(void);
+void glGetFloatv(GLenum pname, GLfloat* data);
 
 void glGenBuffers(GLsizei n, GLuint* buffers);
 void glBindBuffer(GLenum target, GLuint buffer);
 void glBufferData(GLenum target, GLsizei size, const GLvoid* data, GLenum usage);
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data);
+void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+void glFlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length);
+GLboolean glUnmapBuffer(GLenum target);
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count);
+void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount);
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* pixels);
+
+void glGenQueries(GLsizei n, GLuint* ids);
+void glDeleteQueries(GLsizei n, const GLuint* ids);
+GLboolean glIsQuery(GLuint id);
+void glBeginQuery(GLenum target, GLuint id);
+void glEndQuery(GLenum target);
+void glQueryCounter(GLuint id, GLenum target);
+void glGetQueryiv(GLenum target, GLenum pname, GLint* params);
+void glGetQueryObjectiv(GLuint id, GLenum pname, GLint* params);
+void glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params);
+void glGetQueryObjecti64v(GLuint id, GLenum pname, GLint64* params);
+void glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params);
 void glDeleteBuffers(GLsizei n, const GLuint* buffers);
+GLboolean glIsBuffer(GLuint buffer);
+void glBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+void glGenVertexArrays(GLsizei n, GLuint* arrays);
+void glDeleteVertexArrays(GLsizei n, const GLuint* arrays);
+void glBindVertexArray(GLuint array);
+GLboolean glIsVertexArray(GLuint array);
+void glEnableVertexAttribArray(GLuint index);
+void glDisableVertexAttribArray(GLuint index);
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+void glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer);
+void glVertexAttribDivisor(GLuint index, GLuint divisor);
+void glGenTextures(GLsizei n, GLuint* textures);
+void glDeleteTextures(GLsizei n, const GLuint* textures);
+GLboolean glIsTexture(GLuint texture);
+void glActiveTexture(GLenum texture);
+void glBindTexture(GLenum target, GLuint texture);
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels);
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+void glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+void glGenerateMipmap(GLenum target);
+void glPixelStorei(GLenum pname, GLint param);
+void glTexParameteri(GLenum target, GLenum pname, GLint param);
+void glTexParameterf(GLenum target, GLenum pname, GLfloat param);
+void glTexParameteriv(GLenum target, GLenum pname, const GLint* params);
+void glTexParameterfv(GLenum target, GLenum pname, const GLfloat* params);
+void glGenSamplers(GLsizei count, GLuint* samplers);
+void glDeleteSamplers(GLsizei count, const GLuint* samplers);
+GLboolean glIsSampler(GLuint sampler);
+void glBindSampler(GLuint unit, GLuint sampler);
+void glSamplerParameteri(GLuint sampler, GLenum pname, GLint param);
+void glSamplerParameterf(GLuint sampler, GLenum pname, GLfloat param);
+void glSamplerParameteriv(GLuint sampler, GLenum pname, const GLint* params);
+void glSamplerParameterfv(GLuint sampler, GLenum pname, const GLfloat* params);
+GLuint glCreateShader(GLenum type);
+void glDeleteShader(GLuint shader);
+GLboolean glIsShader(GLuint shader);
+void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+void glCompileShader(GLuint shader);
+void glGetShaderiv(GLuint shader, GLenum pname, GLint* params);
+void glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+GLuint glCreateProgram(void);
+void glDeleteProgram(GLuint program);
+GLboolean glIsProgram(GLuint program);
+void glAttachShader(GLuint program, GLuint shader);
+void glDetachShader(GLuint program, GLuint shader);
+void glLinkProgram(GLuint program);
+void glUseProgram(GLuint program);
+void glGetProgramiv(GLuint program, GLenum pname, GLint* params);
+void glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+
+void glUniform1f(GLint location, GLfloat v0);
+void glUniform1i(GLint location, GLint v0);
+void glUniform1ui(GLint location, GLuint v0);
+void glUniform2f(GLint location, GLfloat v0, GLfloat v1);
+void glUniform2i(GLint location, GLint v0, GLint v1);
+void glUniform2ui(GLint location, GLuint v0, GLuint v1);
+void glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+void glUniform3i(GLint location, GLint v0, GLint v1, GLint v2);
+void glUniform3ui(GLint location, GLuint v0, GLuint v1, GLuint v2);
+void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+void glUniform4i(GLint location, GLint v0, GLint v1, GLint v2, GLint v3);
+void glUniform4ui(GLint location, GLuint v0, GLuint v1, GLuint v2, GLuint v3);
+void glUniform1fv(GLint location, GLsizei count, const GLfloat* value);
+void glUniform1iv(GLint location, GLsizei count, const GLint* value);
+void glUniform1uiv(GLint location, GLsizei count, const GLuint* value);
+void glUniform2fv(GLint location, GLsizei count, const GLfloat* value);
+void glUniform2iv(GLint location, GLsizei count, const GLint* value);
+void glUniform2uiv(GLint location, GLsizei count, const GLuint* value);
+void glUniform3fv(GLint location, GLsizei count, const GLfloat* value);
+void glUniform3iv(GLint location, GLsizei count, const GLint* value);
+void glUniform3uiv(GLint location, GLsizei count, const GLuint* value);
+void glUniform4fv(GLint location, GLsizei count, const GLfloat* value);
+void glUniform4iv(GLint location, GLsizei count, const GLint* value);
+void glUniform4uiv(GLint location, GLsizei count, const GLuint* value);
+void glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+void glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+
+void glEnable(GLenum cap);
+void glDisable(GLenum cap);
+GLboolean glIsEnabled(GLenum cap);
+void glBlendFunc(GLenum sfactor, GLenum dfactor);
+void glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+void glBlendEquation(GLenum mode);
+void glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha);
+void glBlendColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+void glCullFace(GLenum mode);
+void glFrontFace(GLenum mode);
+void glPolygonMode(GLenum face, GLenum mode);
+void glDepthFunc(GLenum func);
+void glDepthMask(GLboolean flag);
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void glScissor(GLint x, GLint y, GLsizei width, GLsizei height);
 
 #define GL_DEPTH_BUFFER_BIT 0x00000100
 #define GL_STENCIL_BUFFER_BIT 0x00000400
@@ -1273,6 +1539,8 @@ void glDeleteBuffers(GLsizei n, const GLuint* buffers);
 #define GL_IMAGE_CUBE_MAP_ARRAY 0x9054
 #define GL_INT_IMAGE_CUBE_MAP_ARRAY 0x905F
 #define GL_UNSIGNED_INT_IMAGE_CUBE_MAP_ARRAY 0x906A
+#define GL_TEXTURE_MAX_ANISOTROPY 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
 #define GL_VERSION_1_0 1
 
 #ifdef __cplusplus
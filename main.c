@@ -69,12 +69,13 @@ int main(int argc, char** argv) {
 	GLuint buffers[100];
 	glGenBuffers(100, buffers);
 	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
-	glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(float), (float[]) { -0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f }, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(float), (float[]) { 0.0f, -0.5f, 0.0f, 0.5f, 0.5f, 0.0f, -0.5f, 0.5f, 0.0f }, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, buffers[28]);
-	glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(float), (float[]) { -0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f }, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(float), (float[]) { 0.0f, -0.5f, 0.0f, 0.5f, 0.5f, 0.0f, -0.5f, 0.5f, 0.0f }, GL_STATIC_DRAW);
 	//glDeleteBuffers(100, buffers);
 
 	while (!glfwWindowShouldClose(window)) {
+		glDrawArrays(GL_TRIANGLES, 0, 3);
 		glvkDraw();
 		glfwSwapBuffers(window);
 		glfwPollEvents();